@@ -167,6 +167,7 @@ static int restore_tty;
 
 #if HAVE_THREADS
 static void free_input_threads(void);
+static void free_output_threads(void);
 #endif
 
 /* sub2video hack:
@@ -568,6 +569,10 @@ static void ffmpeg_cleanup(int ret)
 
     av_freep(&subtitle_out);
 
+#if HAVE_THREADS
+    free_output_threads();
+#endif
+
     /* close files */
     for (i = 0; i < nb_output_files; i++) {
         OutputFile *of = output_files[i];
@@ -726,6 +731,111 @@ static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream,
     }
 }
 
+#if HAVE_THREADS
+static void *mux_thread(void *arg)
+{
+    OutputFile *of = arg;
+    AVFormatContext *s = of->ctx;
+    AVPacket *pkt;
+    int ret;
+
+    while (av_thread_message_queue_recv(of->mux_queue, &pkt, 0) >= 0) {
+        ret = av_interleaved_write_frame(s, pkt);
+        av_packet_free(&pkt);
+        if (s->pb)
+            atomic_store(&of->mux_pos, avio_tell(s->pb));
+        if (ret < 0) {
+            print_error("av_interleaved_write_frame()", ret);
+            of->mux_ret = ret;
+            av_thread_message_queue_set_err_send(of->mux_queue, ret);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static void free_output_thread(int i)
+{
+    OutputFile *of = output_files[i];
+    AVPacket *pkt;
+
+    if (!of || !of->mux_queue)
+        return;
+    /* let the thread write what is queued, then stop */
+    av_thread_message_queue_set_err_recv(of->mux_queue, AVERROR_EOF);
+    pthread_join(of->mux_thread, NULL);
+    while (av_thread_message_queue_recv(of->mux_queue, &pkt, AV_THREAD_MESSAGE_NONBLOCK) >= 0)
+        av_packet_free(&pkt);
+    av_thread_message_queue_free(&of->mux_queue);
+
+    if (of->mux_ret < 0)
+        main_return_code = 1;
+}
+
+static void free_output_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_files; i++)
+        free_output_thread(i);
+}
+
+static int init_output_thread(OutputFile *of)
+{
+    int ret;
+
+    /* the SDP is built from the contexts of all the output files */
+    if (of->thread_queue_size <= 0 || want_sdp || sdp_filename)
+        return 0;
+
+    atomic_init(&of->mux_pos, of->ctx->pb ? avio_tell(of->ctx->pb) : 0);
+    ret = av_thread_message_queue_alloc(&of->mux_queue, of->thread_queue_size,
+                                        sizeof(AVPacket *));
+    if (ret < 0)
+        return ret;
+
+    if ((ret = pthread_create(&of->mux_thread, NULL, mux_thread, of))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&of->mux_queue);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+
+/* Queue a packet for the muxer thread, return the muxer error if it failed. */
+static int mux_thread_send(OutputFile *of, AVPacket *pkt)
+{
+    AVPacket *queue_pkt;
+    int ret;
+
+    ret = av_packet_make_refcounted(pkt);
+    if (ret < 0)
+        exit_program(1);
+    queue_pkt = av_packet_alloc();
+    if (!queue_pkt)
+        exit_program(1);
+    av_packet_move_ref(queue_pkt, pkt);
+
+    ret = av_thread_message_queue_send(of->mux_queue, &queue_pkt, 0);
+    if (ret < 0)
+        av_packet_free(&queue_pkt);
+    return ret;
+}
+#endif
+
+/* Number of bytes written to the output file so far. */
+static int64_t output_file_tell(OutputFile *of)
+{
+#if HAVE_THREADS
+    /* the AVIOContext belongs to the muxer thread */
+    if (of->mux_queue)
+        return atomic_load(&of->mux_pos);
+#endif
+    return avio_tell(of->ctx->pb);
+}
+
 static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
 {
     AVFormatContext *s = of->ctx;
@@ -863,9 +973,18 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
               );
     }
 
-    ret = av_interleaved_write_frame(s, pkt);
+#if HAVE_THREADS
+    if (of->mux_queue) {
+        /* errors are reported by the muxer thread */
+        ret = mux_thread_send(of, pkt);
+    } else
+#endif
+    {
+        ret = av_interleaved_write_frame(s, pkt);
+        if (ret < 0)
+            print_error("av_interleaved_write_frame()", ret);
+    }
     if (ret < 0) {
-        print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
         close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
     }
@@ -1736,9 +1855,16 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 
     oc = output_files[0]->ctx;
 
-    total_size = avio_size(oc->pb);
-    if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
-        total_size = avio_tell(oc->pb);
+#if HAVE_THREADS
+    if (output_files[0]->mux_queue)
+        total_size = output_file_tell(output_files[0]);
+    else
+#endif
+    {
+        total_size = avio_size(oc->pb);
+        if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
+            total_size = avio_tell(oc->pb);
+    }
 
     vid = 0;
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
@@ -3051,6 +3177,11 @@ static int check_init_output_file(OutputFile *of, int file_index)
     if (sdp_filename || want_sdp)
         print_sdp();
 
+#if HAVE_THREADS
+    if ((ret = init_output_thread(of)) < 0)
+        return ret;
+#endif
+
     /* flush the muxing queues */
     for (i = 0; i < of->ctx->nb_streams; i++) {
         OutputStream *ost = output_streams[of->ost_index + i];
@@ -3913,7 +4044,7 @@ static int need_output(void)
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
 
         if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+            (os->pb && output_file_tell(of) >= of->limit_filesize))
             continue;
         if (ost->frame_number >= ost->max_frames) {
             int j;
@@ -4819,6 +4950,10 @@ static int transcode(void)
     }
     flush_encoders();
 
+#if HAVE_THREADS
+    free_output_threads();
+#endif
+
     term_exit();
 
     /* write the trailer if needed and close file */
@@ -4877,6 +5012,7 @@ static int transcode(void)
  fail:
 #if HAVE_THREADS
     free_input_threads();
+    free_output_threads();
 #endif
 
     if (output_streams) {
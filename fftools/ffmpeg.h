@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
@@ -583,6 +584,14 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+#if HAVE_THREADS
+    AVThreadMessageQueue *mux_queue;
+    pthread_t mux_thread;       /* thread writing packets to this file */
+    int thread_queue_size;      /* maximum number of packets queued for the muxer */
+    int mux_ret;                /* error returned by the muxer in the thread */
+    atomic_int_least64_t mux_pos; /* bytes written so far by the muxer thread */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -631,6 +640,7 @@ extern char *videotoolbox_pixfmt;
 
 extern int filter_nbthreads;
 extern int filter_complex_nbthreads;
+extern int filter_sched_nbthreads;
 extern int vstats_version;
 extern int auto_conversion_filters;
 
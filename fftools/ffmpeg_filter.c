@@ -1030,6 +1030,7 @@ int configure_filtergraph(FilterGraph *fg)
     } else {
         fg->graph->nb_threads = filter_complex_nbthreads;
     }
+    av_opt_set_int(fg->graph, "sched_threads", filter_sched_nbthreads, 0);
 
     if ((ret = avfilter_graph_parse2(fg->graph, graph_desc, &inputs, &outputs)) < 0)
         goto fail;
@@ -420,8 +420,16 @@ typedef struct AACEncContext {
     struct {
         float *samples;
     } buffer;
+
+    FFPsyWindowInfo *windows;                    ///< window decisions of each channel for the current frame
+    int *el_bitres_alloc;                        ///< psy bit allocation of each channel element
+    int *el_random_state;                        ///< PNS noise generator state of each channel element
+    struct AACEncContext **el_ctx;               ///< context each channel element is searched in,
+                                                 ///< copies of this one when slice threading
 } AACEncContext;
 
+void ff_aac_dsp_init(AACEncContext *s);
+void ff_aac_dsp_init_aarch64(AACEncContext *s);
 void ff_aac_dsp_init_x86(AACEncContext *s);
 void ff_aac_coder_init_mips(AACEncContext *c);
 void ff_quantize_band_cost_cache_init(struct AACEncContext *s);
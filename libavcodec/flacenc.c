@@ -126,6 +126,23 @@ typedef struct FlacEncodeContext {
 
     int flushed;
     int64_t next_pts;
+
+    /* Frames are coded independently, so with slice threading a batch of
+     * nb_threads frames is analysed and coded concurrently, each frame in
+     * its own copy of this context. thread_context[0] is this context. */
+    struct FlacEncodeContext **thread_context;
+    int *thread_ret;
+    int nb_threads;
+    int nb_queued;              ///< frames waiting in thread_context[]
+    uint32_t nb_frames;         ///< frames queued since the start
+    AVPacket **out_pkts;        ///< coded frames not returned yet
+    int nb_out_pkts;
+    int out_pkt_idx;
+
+    /* state of the frame held by a thread context */
+    AVPacket *pkt;
+    int64_t pts;
+    int nb_samples;
 } FlacEncodeContext;
 
 
@@ -236,6 +253,58 @@ static av_cold void dprint_compression_options(FlacEncodeContext *s)
 }
 
 
+static av_cold int init_thread_contexts(FlacEncodeContext *s)
+{
+    AVCodecContext *avctx = s->avctx;
+    int i, ret;
+
+    s->nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ?
+                    avctx->thread_count : 1;
+
+    s->thread_context = av_calloc(s->nb_threads, sizeof(*s->thread_context));
+    s->thread_ret     = av_calloc(s->nb_threads, sizeof(*s->thread_ret));
+    s->out_pkts       = av_calloc(s->nb_threads, sizeof(*s->out_pkts));
+    if (!s->thread_context || !s->thread_ret || !s->out_pkts)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < s->nb_threads; i++) {
+        s->out_pkts[i] = av_packet_alloc();
+        if (!s->out_pkts[i])
+            return AVERROR(ENOMEM);
+    }
+
+    s->thread_context[0] = s;
+    for (i = 1; i < s->nb_threads; i++) {
+        FlacEncodeContext *t = av_memdup(s, sizeof(*s));
+        if (!t)
+            return AVERROR(ENOMEM);
+        s->thread_context[i] = t;
+
+        /* only the per-frame state is owned by the copies */
+        t->thread_context = NULL;
+        t->thread_ret     = NULL;
+        t->out_pkts       = NULL;
+        t->md5ctx         = NULL;
+        t->md5_buffer     = NULL;
+        t->pkt            = NULL;
+        memset(&t->lpc_ctx, 0, sizeof(t->lpc_ctx));
+
+        ret = ff_lpc_init(&t->lpc_ctx, avctx->frame_size,
+                          s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+    }
+
+    for (i = 0; i < s->nb_threads; i++) {
+        s->thread_context[i]->pkt = av_packet_alloc();
+        if (!s->thread_context[i]->pkt)
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+
 static av_cold int flac_encode_init(AVCodecContext *avctx)
 {
     int freq = avctx->sample_rate;
@@ -456,6 +525,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
                       s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    if (ret < 0)
+        return ret;
 
     ff_bswapdsp_init(&s->bdsp);
     ff_flacdsp_init(&s->flac_dsp, avctx->sample_fmt, channels,
@@ -463,7 +534,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     dprint_compression_options(s);
 
-    return ret;
+    return init_thread_contexts(s);
 }
 
 
@@ -1320,10 +1391,11 @@ static int write_frame(FlacEncodeContext *s, AVPacket *avpkt)
 }
 
 
-static int update_md5_sum(FlacEncodeContext *s, const void *samples)
+static int update_md5_sum(FlacEncodeContext *s, const void *samples,
+                          int nb_samples)
 {
     const uint8_t *buf;
-    int buf_size = s->frame.blocksize * s->channels *
+    int buf_size = nb_samples * s->channels *
                    ((s->avctx->bits_per_raw_sample + 7) / 8);
 
     if (s->avctx->bits_per_raw_sample > 16 || HAVE_BIGENDIAN) {
@@ -1344,7 +1416,7 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
         const int32_t *samples0 = samples;
         uint8_t *tmp            = s->md5_buffer;
 
-        for (i = 0; i < s->frame.blocksize * s->channels; i++) {
+        for (i = 0; i < nb_samples * s->channels; i++) {
             int32_t v = samples0[i] >> 8;
             AV_WL24(tmp + 3*i, v);
         }
@@ -1356,14 +1428,139 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
 }
 
 
+/**
+ * Code the frame held by a thread context into its packet.
+ */
+static int encode_frame_thread(AVCodecContext *avctx, void *arg)
+{
+    FlacEncodeContext *s = *(FlacEncodeContext **)arg;
+    int frame_bytes, out_bytes, ret;
+
+    channel_decorrelation(s);
+
+    remove_wasted_bits(s);
+
+    frame_bytes = encode_frame(s);
+
+    /* Fall back on verbatim mode if the compressed frame is larger than it
+       would be if encoded uncompressed. */
+    if (frame_bytes < 0 || frame_bytes > s->max_framesize) {
+        s->frame.verbatim_only = 1;
+        frame_bytes = encode_frame(s);
+        if (frame_bytes < 0) {
+            av_log(avctx, AV_LOG_ERROR, "Bad frame count\n");
+            return frame_bytes;
+        }
+    }
+
+    if ((ret = ff_alloc_packet2(avctx, s->pkt, frame_bytes, frame_bytes)) < 0)
+        return ret;
+
+    out_bytes = write_frame(s, s->pkt);
+    av_shrink_packet(s->pkt, out_bytes);
+
+    s->pkt->pts      = s->pts;
+    s->pkt->duration = ff_samples_to_time_base(avctx, s->nb_samples);
+
+    return 0;
+}
+
+
+/**
+ * Hand a frame to the next free thread context. Everything that depends on
+ * the previous frames is done here, in coding order.
+ */
+static int queue_frame(FlacEncodeContext *s, const AVFrame *frame)
+{
+    FlacEncodeContext *t = s->thread_context[s->nb_queued];
+    int ret;
+
+    /* maximum encoded frame size in verbatim mode, smaller for the small
+     * final frame */
+    t->max_framesize = ff_flac_get_max_frame_size(s->nb_frames ? frame->nb_samples
+                                                               : s->max_blocksize,
+                                                  s->channels,
+                                                  s->avctx->bits_per_raw_sample);
+    t->frame_count   = s->nb_frames++;
+    t->pts           = frame->pts;
+    t->nb_samples    = frame->nb_samples;
+
+    init_frame(t, frame->nb_samples);
+
+    copy_samples(t, frame->data[0]);
+
+    s->sample_count += frame->nb_samples;
+    if ((ret = update_md5_sum(s, frame->data[0], frame->nb_samples)) < 0) {
+        av_log(s->avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
+        return ret;
+    }
+
+    s->nb_queued++;
+    return 0;
+}
+
+
+static int encode_queued_frames(FlacEncodeContext *s)
+{
+    AVCodecContext *avctx = s->avctx;
+    int i;
+
+    av_assert1(s->out_pkt_idx == s->nb_out_pkts);
+
+    avctx->execute(avctx, encode_frame_thread, s->thread_context,
+                   s->thread_ret, s->nb_queued, sizeof(*s->thread_context));
+
+    for (i = 0; i < s->nb_queued; i++) {
+        AVPacket *pkt = s->thread_context[i]->pkt;
+
+        if (s->thread_ret[i] < 0)
+            return s->thread_ret[i];
+
+        if (pkt->size > s->max_encoded_framesize)
+            s->max_encoded_framesize = pkt->size;
+        if (pkt->size < s->min_framesize)
+            s->min_framesize = pkt->size;
+
+        av_packet_move_ref(s->out_pkts[i], pkt);
+    }
+
+    s->nb_out_pkts = s->nb_queued;
+    s->out_pkt_idx = 0;
+    s->nb_queued   = 0;
+
+    return 0;
+}
+
+
 static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                              const AVFrame *frame, int *got_packet_ptr)
 {
     FlacEncodeContext *s;
-    int frame_bytes, out_bytes, ret;
+    int ret;
 
     s = avctx->priv_data;
 
+    if (frame && (ret = queue_frame(s, frame)) < 0)
+        return ret;
+
+    /* code a batch once every thread context holds a frame, and whatever
+     * is left when flushing, but only after all packets of the previous
+     * batch have been returned */
+    if (s->out_pkt_idx == s->nb_out_pkts &&
+        (s->nb_queued == s->nb_threads || (!frame && s->nb_queued))) {
+        if ((ret = encode_queued_frames(s)) < 0)
+            return ret;
+    }
+
+    if (s->out_pkt_idx < s->nb_out_pkts) {
+        av_packet_move_ref(avpkt, s->out_pkts[s->out_pkt_idx++]);
+
+        s->next_pts = avpkt->pts + avpkt->duration;
+
+        *got_packet_ptr = 1;
+        return 0;
+    }
+
     /* when the last block is reached, update the header in extradata */
     if (!frame) {
         s->max_framesize = s->max_encoded_framesize;
@@ -1388,61 +1585,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
             *got_packet_ptr = 1;
             s->flushed = 1;
         }
-
-        return 0;
     }
 
-    /* change max_framesize for small final frame */
-    if (frame->nb_samples < s->frame.blocksize) {
-        s->max_framesize = ff_flac_get_max_frame_size(frame->nb_samples,
-                                                      s->channels,
-                                                      avctx->bits_per_raw_sample);
-    }
-
-    init_frame(s, frame->nb_samples);
-
-    copy_samples(s, frame->data[0]);
-
-    channel_decorrelation(s);
-
-    remove_wasted_bits(s);
-
-    frame_bytes = encode_frame(s);
-
-    /* Fall back on verbatim mode if the compressed frame is larger than it
-       would be if encoded uncompressed. */
-    if (frame_bytes < 0 || frame_bytes > s->max_framesize) {
-        s->frame.verbatim_only = 1;
-        frame_bytes = encode_frame(s);
-        if (frame_bytes < 0) {
-            av_log(avctx, AV_LOG_ERROR, "Bad frame count\n");
-            return frame_bytes;
-        }
-    }
-
-    if ((ret = ff_alloc_packet2(avctx, avpkt, frame_bytes, 0)) < 0)
-        return ret;
-
-    out_bytes = write_frame(s, avpkt);
-
-    s->frame_count++;
-    s->sample_count += frame->nb_samples;
-    if ((ret = update_md5_sum(s, frame->data[0])) < 0) {
-        av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
-        return ret;
-    }
-    if (out_bytes > s->max_encoded_framesize)
-        s->max_encoded_framesize = out_bytes;
-    if (out_bytes < s->min_framesize)
-        s->min_framesize = out_bytes;
-
-    avpkt->pts      = frame->pts;
-    avpkt->duration = ff_samples_to_time_base(avctx, frame->nb_samples);
-    avpkt->size     = out_bytes;
-
-    s->next_pts = avpkt->pts + avpkt->duration;
-
-    *got_packet_ptr = 1;
     return 0;
 }
 
@@ -1451,6 +1595,26 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
 {
     if (avctx->priv_data) {
         FlacEncodeContext *s = avctx->priv_data;
+        int i;
+
+        if (s->thread_context) {
+            for (i = 1; i < s->nb_threads; i++) {
+                FlacEncodeContext *t = s->thread_context[i];
+                if (!t)
+                    continue;
+                ff_lpc_end(&t->lpc_ctx);
+                av_packet_free(&t->pkt);
+                av_freep(&s->thread_context[i]);
+            }
+        }
+        if (s->out_pkts) {
+            for (i = 0; i < s->nb_threads; i++)
+                av_packet_free(&s->out_pkts[i]);
+        }
+        av_freep(&s->thread_context);
+        av_freep(&s->thread_ret);
+        av_freep(&s->out_pkts);
+        av_packet_free(&s->pkt);
         av_freep(&s->md5ctx);
         av_freep(&s->md5_buffer);
         ff_lpc_end(&s->lpc_ctx);
@@ -1508,9 +1672,11 @@ AVCodec ff_flac_encoder = {
     .init           = flac_encode_init,
     .encode2        = flac_encode_frame,
     .close          = flac_encode_close,
-    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16,
                                                      AV_SAMPLE_FMT_S32,
                                                      AV_SAMPLE_FMT_NONE },
     .priv_class     = &flac_encoder_class,
+    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
 };
@@ -415,22 +415,20 @@ static void sao_filter_CTB(HEVCContext *s, int x, int y)
                     left_pixels = 1;
                 }
             }
-            right_pixels = 0;
-            if (!right_edge) {
-                if (CTB(s->sao, x_ctb+1, y_ctb).type_idx[c_idx] == SAO_APPLIED) {
-                    copy_vert(dst + (width << sh),
-                              s->sao_pixel_buffer_v[c_idx] + (((2 * x_ctb + 2) * h + y0) << sh),
-                              sh, height, stride_dst, 1 << sh);
-                } else {
-                    right_pixels = 1;
-                }
-            }
+            right_pixels = !right_edge &&
+                           CTB(s->sao, x_ctb+1, y_ctb).type_idx[c_idx] != SAO_APPLIED;
 
             copy_CTB(dst - (left_pixels << sh),
                      src - (left_pixels << sh),
                      (width + left_pixels + right_pixels) << sh,
                      height, stride_dst, stride_src);
 
+            // after copy_CTB(), which may write past the width
+            if (!right_edge && !right_pixels)
+                copy_vert(dst + (width << sh),
+                          s->sao_pixel_buffer_v[c_idx] + (((2 * x_ctb + 2) * h + y0) << sh),
+                          sh, height, stride_dst, 1 << sh);
+
             copy_CTB_to_hv(s, src, stride_src, x0, y0, width, height, c_idx,
                            x_ctb, y_ctb);
             s->hevcdsp.sao_edge_filter[tab](src, dst, stride_src, sao->offset_val[c_idx],
@@ -473,14 +471,34 @@ static int get_pcm(HEVCContext *s, int x, int y)
                     (tc_offset & -2),                                   \
                     0, MAX_QP + DEFAULT_INTRA_TC_OFFSET)]
 
-static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
+/* the edges deblocking_filter_CTB() filters */
+enum {
+    DEBLOCK_ALL,
+    DEBLOCK_TILE_INTERIOR, ///< edges that leave the left and upper tile boundaries alone
+    DEBLOCK_TILE_EDGES,    ///< the others, once the tiles on the left and above are done
+};
+
+/* The vertical edges on the left tile boundary change up to 4 columns on
+ * each side, the horizontal edges crossing those columns must wait for them. */
+#define TILE_EDGE_V(x)    ((x) == tile_x)
+#define TILE_EDGE_H(x, y) ((y) == tile_y || (tile_x > 0 && (x) < tile_x + 4))
+#define SKIP_EDGE(edge)   (part != DEBLOCK_ALL && (part == DEBLOCK_TILE_EDGES) != (edge))
+
+/**
+ * @return 1 if DEBLOCK_TILE_INTERIOR skipped edges on the tile boundaries
+ */
+static int deblocking_filter_CTB(HEVCContext *s, int x0, int y0, int part)
 {
+
     uint8_t *src;
     int x, y;
     int chroma, beta;
+    int bs0, bs1;
     int32_t c_tc[2], tc[2];
     uint8_t no_p[2] = { 0 };
     uint8_t no_q[2] = { 0 };
+    int tile_x = 0, tile_y = 0;
+    int tile_edges = 0;
 
     int log2_ctb_size = s->ps.sps->log2_ctb_size;
     int x_end, x_end2, y_end;
@@ -495,7 +513,19 @@ static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
                 s->ps.sps->pcm.loop_filter_disable_flag) ||
                s->ps.pps->transquant_bypass_enable_flag;
 
-    if (x0) {
+    if (part != DEBLOCK_ALL) {
+        int tile = s->ps.pps->tile_id[s->ps.pps->ctb_addr_rs_to_ts[ctb]];
+
+        tile_x = (s->ps.pps->tile_pos_rs[tile] % s->ps.sps->ctb_width) << log2_ctb_size;
+        tile_y = (s->ps.pps->tile_pos_rs[tile] / s->ps.sps->ctb_width) << log2_ctb_size;
+    }
+
+    if (x0 && part == DEBLOCK_TILE_INTERIOR && x0 == tile_x) {
+        // the tile on the left may still be decoding, the caller made
+        // sure its offsets are the same
+        left_tc_offset   = cur_tc_offset;
+        left_beta_offset = cur_beta_offset;
+    } else if (x0) {
         left_tc_offset   = s->deblock[ctb - 1].tc_offset;
         left_beta_offset = s->deblock[ctb - 1].beta_offset;
     } else {
@@ -519,8 +549,12 @@ static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
     for (y = y0; y < y_end; y += 8) {
         // vertical filtering luma
         for (x = x0 ? x0 : 8; x < x_end; x += 8) {
-            const int bs0 = s->vertical_bs[(x +  y      * s->bs_width) >> 2];
-            const int bs1 = s->vertical_bs[(x + (y + 4) * s->bs_width) >> 2];
+            if (SKIP_EDGE(TILE_EDGE_V(x))) {
+                tile_edges = 1;
+                continue;
+            }
+            bs0 = s->vertical_bs[(x +  y      * s->bs_width) >> 2];
+            bs1 = s->vertical_bs[(x + (y + 4) * s->bs_width) >> 2];
             if (bs0 || bs1) {
                 const int qp = (get_qPy(s, x - 1, y)     + get_qPy(s, x, y)     + 1) >> 1;
 
@@ -549,8 +583,12 @@ static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
 
         // horizontal filtering luma
         for (x = x0 ? x0 - 8 : 0; x < x_end2; x += 8) {
-            const int bs0 = s->horizontal_bs[( x      + y * s->bs_width) >> 2];
-            const int bs1 = s->horizontal_bs[((x + 4) + y * s->bs_width) >> 2];
+            if (SKIP_EDGE(TILE_EDGE_H(x, y))) {
+                tile_edges = 1;
+                continue;
+            }
+            bs0 = s->horizontal_bs[( x      + y * s->bs_width) >> 2];
+            bs1 = s->horizontal_bs[((x + 4) + y * s->bs_width) >> 2];
             if (bs0 || bs1) {
                 const int qp = (get_qPy(s, x, y - 1)     + get_qPy(s, x, y)     + 1) >> 1;
 
@@ -585,8 +623,12 @@ static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
             // vertical filtering chroma
             for (y = y0; y < y_end; y += (8 * v)) {
                 for (x = x0 ? x0 : 8 * h; x < x_end; x += (8 * h)) {
-                    const int bs0 = s->vertical_bs[(x +  y            * s->bs_width) >> 2];
-                    const int bs1 = s->vertical_bs[(x + (y + (4 * v)) * s->bs_width) >> 2];
+                    if (SKIP_EDGE(TILE_EDGE_V(x))) {
+                        tile_edges = 1;
+                        continue;
+                    }
+                    bs0 = s->vertical_bs[(x +  y            * s->bs_width) >> 2];
+                    bs1 = s->vertical_bs[(x + (y + (4 * v)) * s->bs_width) >> 2];
 
                     if ((bs0 == 2) || (bs1 == 2)) {
                         const int qp0 = (get_qPy(s, x - 1, y)           + get_qPy(s, x, y)           + 1) >> 1;
@@ -619,8 +661,12 @@ static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
                 if (x_end != s->ps.sps->width)
                     x_end2 = x_end - 8 * h;
                 for (x = x0 ? x0 - 8 * h : 0; x < x_end2; x += (8 * h)) {
-                    const int bs0 = s->horizontal_bs[( x          + y * s->bs_width) >> 2];
-                    const int bs1 = s->horizontal_bs[((x + 4 * h) + y * s->bs_width) >> 2];
+                    if (SKIP_EDGE(TILE_EDGE_H(x, y))) {
+                        tile_edges = 1;
+                        continue;
+                    }
+                    bs0 = s->horizontal_bs[( x          + y * s->bs_width) >> 2];
+                    bs1 = s->horizontal_bs[((x + 4 * h) + y * s->bs_width) >> 2];
                     if ((bs0 == 2) || (bs1 == 2)) {
                         const int qp0 = bs0 == 2 ? (get_qPy(s, x,           y - 1) + get_qPy(s, x,           y) + 1) >> 1 : 0;
                         const int qp1 = bs1 == 2 ? (get_qPy(s, x + (4 * h), y - 1) + get_qPy(s, x + (4 * h), y) + 1) >> 1 : 0;
@@ -645,6 +691,8 @@ static void deblocking_filter_CTB(HEVCContext *s, int x0, int y0)
             }
         }
     }
+
+    return tile_edges;
 }
 
 static int boundary_strength(HEVCContext *s, MvField *curr, MvField *neigh,
@@ -711,15 +759,83 @@ static int boundary_strength(HEVCContext *s, MvField *curr, MvField *neigh,
     return 1;
 }
 
+static av_always_inline void upper_edge_bs(HEVCContext *s, int x0, int y0,
+                                           int width, int boundary_flags)
+{
+    MvField *tab_mvf     = s->ref->tab_mvf;
+    int log2_min_pu_size = s->ps.sps->log2_min_pu_size;
+    int log2_min_tu_size = s->ps.sps->log2_min_tb_size;
+    int min_pu_width     = s->ps.sps->min_pu_width;
+    int min_tu_width     = s->ps.sps->min_tb_width;
+    RefPicList *rpl_top  = (boundary_flags & BOUNDARY_UPPER_SLICE) ?
+                           ff_hevc_get_ref_list(s, s->ref, x0, y0 - 1) :
+                           s->ref->refPicList;
+    int yp_pu = (y0 - 1) >> log2_min_pu_size;
+    int yq_pu =  y0      >> log2_min_pu_size;
+    int yp_tu = (y0 - 1) >> log2_min_tu_size;
+    int yq_tu =  y0      >> log2_min_tu_size;
+    int i, bs;
+
+    for (i = 0; i < width; i += 4) {
+        int x_pu = (x0 + i) >> log2_min_pu_size;
+        int x_tu = (x0 + i) >> log2_min_tu_size;
+        MvField *top  = &tab_mvf[yp_pu * min_pu_width + x_pu];
+        MvField *curr = &tab_mvf[yq_pu * min_pu_width + x_pu];
+        uint8_t top_cbf_luma  = s->cbf_luma[yp_tu * min_tu_width + x_tu];
+        uint8_t curr_cbf_luma = s->cbf_luma[yq_tu * min_tu_width + x_tu];
+
+        if (curr->pred_flag == PF_INTRA || top->pred_flag == PF_INTRA)
+            bs = 2;
+        else if (curr_cbf_luma || top_cbf_luma)
+            bs = 1;
+        else
+            bs = boundary_strength(s, curr, top, rpl_top);
+        s->horizontal_bs[((x0 + i) + y0 * s->bs_width) >> 2] = bs;
+    }
+}
+
+static av_always_inline void left_edge_bs(HEVCContext *s, int x0, int y0,
+                                          int height, int boundary_flags)
+{
+    MvField *tab_mvf     = s->ref->tab_mvf;
+    int log2_min_pu_size = s->ps.sps->log2_min_pu_size;
+    int log2_min_tu_size = s->ps.sps->log2_min_tb_size;
+    int min_pu_width     = s->ps.sps->min_pu_width;
+    int min_tu_width     = s->ps.sps->min_tb_width;
+    RefPicList *rpl_left = (boundary_flags & BOUNDARY_LEFT_SLICE) ?
+                           ff_hevc_get_ref_list(s, s->ref, x0 - 1, y0) :
+                           s->ref->refPicList;
+    int xp_pu = (x0 - 1) >> log2_min_pu_size;
+    int xq_pu =  x0      >> log2_min_pu_size;
+    int xp_tu = (x0 - 1) >> log2_min_tu_size;
+    int xq_tu =  x0      >> log2_min_tu_size;
+    int i, bs;
+
+    for (i = 0; i < height; i += 4) {
+        int y_pu      = (y0 + i) >> log2_min_pu_size;
+        int y_tu      = (y0 + i) >> log2_min_tu_size;
+        MvField *left = &tab_mvf[y_pu * min_pu_width + xp_pu];
+        MvField *curr = &tab_mvf[y_pu * min_pu_width + xq_pu];
+        uint8_t left_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xp_tu];
+        uint8_t curr_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xq_tu];
+
+        if (curr->pred_flag == PF_INTRA || left->pred_flag == PF_INTRA)
+            bs = 2;
+        else if (curr_cbf_luma || left_cbf_luma)
+            bs = 1;
+        else
+            bs = boundary_strength(s, curr, left, rpl_left);
+        s->vertical_bs[(x0 + (y0 + i) * s->bs_width) >> 2] = bs;
+    }
+}
+
 void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
                                            int log2_trafo_size)
 {
     HEVCLocalContext *lc = s->HEVClc;
     MvField *tab_mvf     = s->ref->tab_mvf;
     int log2_min_pu_size = s->ps.sps->log2_min_pu_size;
-    int log2_min_tu_size = s->ps.sps->log2_min_tb_size;
     int min_pu_width     = s->ps.sps->min_pu_width;
-    int min_tu_width     = s->ps.sps->min_tb_width;
     int is_intra = tab_mvf[(y0 >> log2_min_pu_size) * min_pu_width +
                            (x0 >> log2_min_pu_size)].pred_flag == PF_INTRA;
     int boundary_upper, boundary_left;
@@ -735,32 +851,15 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
           (y0 % (1 << s->ps.sps->log2_ctb_size)) == 0)))
         boundary_upper = 0;
 
-    if (boundary_upper) {
-        RefPicList *rpl_top = (lc->boundary_flags & BOUNDARY_UPPER_SLICE) ?
-                              ff_hevc_get_ref_list(s, s->ref, x0, y0 - 1) :
-                              s->ref->refPicList;
-        int yp_pu = (y0 - 1) >> log2_min_pu_size;
-        int yq_pu =  y0      >> log2_min_pu_size;
-        int yp_tu = (y0 - 1) >> log2_min_tu_size;
-        int yq_tu =  y0      >> log2_min_tu_size;
+    // the neighbouring tile may still be decoding,
+    // ff_hevc_tile_boundary_strengths() fills this edge in later
+    if (s->enable_parallel_tiles &&
+        lc->boundary_flags & BOUNDARY_UPPER_TILE &&
+        (y0 % (1 << s->ps.sps->log2_ctb_size)) == 0)
+        boundary_upper = 0;
 
-            for (i = 0; i < (1 << log2_trafo_size); i += 4) {
-                int x_pu = (x0 + i) >> log2_min_pu_size;
-                int x_tu = (x0 + i) >> log2_min_tu_size;
-                MvField *top  = &tab_mvf[yp_pu * min_pu_width + x_pu];
-                MvField *curr = &tab_mvf[yq_pu * min_pu_width + x_pu];
-                uint8_t top_cbf_luma  = s->cbf_luma[yp_tu * min_tu_width + x_tu];
-                uint8_t curr_cbf_luma = s->cbf_luma[yq_tu * min_tu_width + x_tu];
-
-                if (curr->pred_flag == PF_INTRA || top->pred_flag == PF_INTRA)
-                    bs = 2;
-                else if (curr_cbf_luma || top_cbf_luma)
-                    bs = 1;
-                else
-                    bs = boundary_strength(s, curr, top, rpl_top);
-                s->horizontal_bs[((x0 + i) + y0 * s->bs_width) >> 2] = bs;
-            }
-    }
+    if (boundary_upper)
+        upper_edge_bs(s, x0, y0, 1 << log2_trafo_size, lc->boundary_flags);
 
     // bs for vertical TU boundaries
     boundary_left = x0 > 0 && !(x0 & 7);
@@ -773,32 +872,13 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
           (x0 % (1 << s->ps.sps->log2_ctb_size)) == 0)))
         boundary_left = 0;
 
-    if (boundary_left) {
-        RefPicList *rpl_left = (lc->boundary_flags & BOUNDARY_LEFT_SLICE) ?
-                               ff_hevc_get_ref_list(s, s->ref, x0 - 1, y0) :
-                               s->ref->refPicList;
-        int xp_pu = (x0 - 1) >> log2_min_pu_size;
-        int xq_pu =  x0      >> log2_min_pu_size;
-        int xp_tu = (x0 - 1) >> log2_min_tu_size;
-        int xq_tu =  x0      >> log2_min_tu_size;
+    if (s->enable_parallel_tiles &&
+        lc->boundary_flags & BOUNDARY_LEFT_TILE &&
+        (x0 % (1 << s->ps.sps->log2_ctb_size)) == 0)
+        boundary_left = 0;
 
-            for (i = 0; i < (1 << log2_trafo_size); i += 4) {
-                int y_pu      = (y0 + i) >> log2_min_pu_size;
-                int y_tu      = (y0 + i) >> log2_min_tu_size;
-                MvField *left = &tab_mvf[y_pu * min_pu_width + xp_pu];
-                MvField *curr = &tab_mvf[y_pu * min_pu_width + xq_pu];
-                uint8_t left_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xp_tu];
-                uint8_t curr_cbf_luma = s->cbf_luma[y_tu * min_tu_width + xq_tu];
-
-                if (curr->pred_flag == PF_INTRA || left->pred_flag == PF_INTRA)
-                    bs = 2;
-                else if (curr_cbf_luma || left_cbf_luma)
-                    bs = 1;
-                else
-                    bs = boundary_strength(s, curr, left, rpl_left);
-                s->vertical_bs[(x0 + (y0 + i) * s->bs_width) >> 2] = bs;
-            }
-    }
+    if (boundary_left)
+        left_edge_bs(s, x0, y0, 1 << log2_trafo_size, lc->boundary_flags);
 
     if (log2_trafo_size > log2_min_pu_size && !is_intra) {
         RefPicList *rpl = s->ref->refPicList;
@@ -835,6 +915,27 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
     }
 }
 
+void ff_hevc_tile_boundary_strengths(HEVCContext *s, int x_ctb, int y_ctb,
+                                     int boundary_flags)
+{
+    int ctb_size = 1 << s->ps.sps->log2_ctb_size;
+
+    if (!s->ps.pps->loop_filter_across_tiles_enabled_flag)
+        return;
+
+    if (boundary_flags & BOUNDARY_UPPER_TILE &&
+        (s->sh.slice_loop_filter_across_slices_enabled_flag ||
+         !(boundary_flags & BOUNDARY_UPPER_SLICE)))
+        upper_edge_bs(s, x_ctb, y_ctb,
+                      FFMIN(ctb_size, s->ps.sps->width - x_ctb), boundary_flags);
+
+    if (boundary_flags & BOUNDARY_LEFT_TILE &&
+        (s->sh.slice_loop_filter_across_slices_enabled_flag ||
+         !(boundary_flags & BOUNDARY_LEFT_SLICE)))
+        left_edge_bs(s, x_ctb, y_ctb,
+                     FFMIN(ctb_size, s->ps.sps->height - y_ctb), boundary_flags);
+}
+
 #undef LUMA
 #undef CB
 #undef CR
@@ -842,6 +943,9 @@ void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
 void ff_hevc_hls_filter(HEVCContext *s, int x, int y, int ctb_size)
 {
     int x_end = x >= s->ps.sps->width  - ctb_size;
+    int deblock_tile_edges = CTB(s->deblock_tile_edges,
+                                 x >> s->ps.sps->log2_ctb_size,
+                                 y >> s->ps.sps->log2_ctb_size);
     int skip = 0;
     if (s->avctx->skip_loop_filter >= AVDISCARD_ALL ||
         (s->avctx->skip_loop_filter >= AVDISCARD_NONKEY && !IS_IDR(s)) ||
@@ -853,8 +957,8 @@ void ff_hevc_hls_filter(HEVCContext *s, int x, int y, int ctb_size)
         ff_hevc_nal_is_nonref(s->nal_unit_type)))
         skip = 1;
 
-    if (!skip)
-        deblocking_filter_CTB(s, x, y);
+    if (!skip && deblock_tile_edges != 2)
+        deblocking_filter_CTB(s, x, y, deblock_tile_edges ? DEBLOCK_TILE_EDGES : DEBLOCK_ALL);
     if (s->ps.sps->sao_enabled && !skip) {
         int y_end = y >= s->ps.sps->height - ctb_size;
         if (y && x)
@@ -875,6 +979,40 @@ void ff_hevc_hls_filter(HEVCContext *s, int x, int y, int ctb_size)
         ff_thread_report_progress(&s->ref->tf, y + ctb_size - 4, 0);
 }
 
+void ff_hevc_hls_filter_tile(HEVCContext *s, int tile)
+{
+    const HEVCSPS *sps = s->ps.sps;
+    const HEVCPPS *pps = s->ps.pps;
+    int log2_ctb_size  = sps->log2_ctb_size;
+    int col            = tile % pps->num_tile_columns;
+    int row            = tile / pps->num_tile_columns;
+    int x_start        = pps->col_bd[col];
+    int x_stop         = pps->col_bd[col + 1];
+    int y_start        = pps->row_bd[row];
+    int y_stop         = pps->row_bd[row + 1];
+    // The edges left to ff_hevc_hls_filter() reach up to 16 columns and
+    // 4 rows into a tile, SAO reads one more sample around the CTB.
+    int margin_x       = (16 + (1 << log2_ctb_size)) >> log2_ctb_size;
+    int margin_y       = ( 4 + (1 << log2_ctb_size)) >> log2_ctb_size;
+    int sao_x_start    = x_start + (x_start > 0 ? margin_x : 0);
+    int sao_x_stop     = x_stop - (x_stop < sps->ctb_width  ? margin_x : 0);
+    int sao_y_start    = y_start + (y_start > 0 ? margin_y : 0);
+    int sao_y_stop     = y_stop - (y_stop < sps->ctb_height ? margin_y : 0);
+    int x, y;
+
+    for (y = y_start; y <= y_stop; y++) {
+        for (x = x_start; x < x_stop && y < y_stop; x++)
+            CTB(s->deblock_tile_edges, x, y) =
+                deblocking_filter_CTB(s, x << log2_ctb_size, y << log2_ctb_size,
+                                      DEBLOCK_TILE_INTERIOR) ? 1 : 2;
+
+        // one row behind, the deblocking of the row below changes this one
+        if (sps->sao_enabled && y - 1 >= sao_y_start && y - 1 < sao_y_stop)
+            for (x = sao_x_start; x < sao_x_stop; x++)
+                sao_filter_CTB(s, x << log2_ctb_size, (y - 1) << log2_ctb_size);
+    }
+}
+
 void ff_hevc_hls_filters(HEVCContext *s, int x_ctb, int y_ctb, int ctb_size)
 {
     int x_end = x_ctb >= s->ps.sps->width  - ctb_size;
@@ -72,6 +72,7 @@ static void pic_arrays_free(HEVCContext *s)
     av_freep(&s->qp_y_tab);
     av_freep(&s->tab_slice_address);
     av_freep(&s->filter_slice_edges);
+    av_freep(&s->deblock_tile_edges);
 
     av_freep(&s->horizontal_bs);
     av_freep(&s->vertical_bs);
@@ -115,11 +116,13 @@ static int pic_arrays_init(HEVCContext *s, const HEVCSPS *sps)
         goto fail;
 
     s->filter_slice_edges = av_mallocz(ctb_count);
+    s->deblock_tile_edges = av_mallocz(ctb_count);
     s->tab_slice_address  = av_malloc_array(pic_size_in_ctb,
                                       sizeof(*s->tab_slice_address));
     s->qp_y_tab           = av_malloc_array(pic_size_in_ctb,
                                       sizeof(*s->qp_y_tab));
-    if (!s->qp_y_tab || !s->filter_slice_edges || !s->tab_slice_address)
+    if (!s->qp_y_tab || !s->filter_slice_edges || !s->deblock_tile_edges ||
+        !s->tab_slice_address)
         goto fail;
 
     s->horizontal_bs = av_mallocz_array(s->bs_width, s->bs_height);
@@ -917,8 +920,11 @@ static int hls_slice_header(HEVCContext *s)
                 sh->entry_point_offset[i] = val + 1; // +1; // +1 to get the size
             }
             if (s->threads_number > 1 && (s->ps.pps->num_tile_rows > 1 || s->ps.pps->num_tile_columns > 1)) {
-                s->enable_parallel_tiles = 0; // TODO: you can enable tiles in parallel here
-                s->threads_number = 1;
+                if (s->ps.pps->entropy_coding_sync_enabled_flag) {
+                    s->enable_parallel_tiles = 0;
+                    s->threads_number = 1;
+                } else
+                    s->enable_parallel_tiles = 1;
             } else
                 s->enable_parallel_tiles = 0;
         } else
@@ -2603,6 +2609,169 @@ error:
     return ret;
 }
 
+/**
+ * Check whether a tile may run its in-loop filters in its own job.
+ * Deblocking a CTB uses the offsets of the CTB on its left for more than
+ * the edge between them, so on the left tile boundary they must be the
+ * same as in this slice.
+ */
+static int tile_filter_independent(HEVCContext *s, int tile, int first_tile)
+{
+    const HEVCPPS *pps = s->ps.pps;
+    const HEVCSPS *sps = s->ps.sps;
+    int col = tile % pps->num_tile_columns;
+    int row = tile / pps->num_tile_columns;
+    int y;
+
+    if (s->avctx->skip_loop_filter > AVDISCARD_DEFAULT)
+        return 0;
+    // with 16x16 CTBs, the SAO of a CTB reads chroma samples that the
+    // deblocking of the CTB two to its right changes later on
+    if (sps->sao_enabled && sps->chroma_format_idc &&
+        (8 << sps->hshift[1]) >= (1 << sps->log2_ctb_size))
+        return 0;
+    if (!col || tile - 1 >= first_tile)
+        return 1;
+
+    for (y = pps->row_bd[row]; y < pps->row_bd[row + 1]; y++) {
+        const DBParams *left = &s->deblock[y * sps->ctb_width + pps->col_bd[col] - 1];
+        if (left->beta_offset != s->sh.beta_offset ||
+            left->tc_offset   != s->sh.tc_offset)
+            return 0;
+    }
+    return 1;
+}
+
+static int hls_decode_entry_tile(AVCodecContext *avctxt, void *input_offset, int job, int self_id)
+{
+    HEVCContext *s1  = avctxt->priv_data, *s;
+    HEVCLocalContext *lc;
+    const HEVCPPS *pps = s1->ps.pps;
+    const HEVCSPS *sps = s1->ps.sps;
+    int *offset     = input_offset;
+    int more_data   = 1;
+    int tile        = pps->tile_id[pps->ctb_addr_rs_to_ts[s1->sh.slice_ctb_addr_rs]] + job;
+    int ctb_addr_rs = pps->tile_pos_rs[tile];
+    int ctb_addr_ts = pps->ctb_addr_rs_to_ts[ctb_addr_rs];
+    int ctb_addr_end, size, ret;
+
+    s = s1->sList[self_id];
+    lc = s->HEVClc;
+
+    ctb_addr_end = tile + 1 < pps->num_tile_columns * pps->num_tile_rows ?
+                   pps->ctb_addr_rs_to_ts[pps->tile_pos_rs[tile + 1]] : sps->ctb_size;
+
+    // each substream keeps its trailing byte, which holds the last CABAC bits
+    if (job < s->sh.num_entry_point_offsets)
+        size = offset[job + 1] + 1 - offset[job];
+    else
+        size = s->sh.offset[job - 1] + s->sh.size[job - 1] - offset[job];
+    ret = init_get_bits8(&lc->gb, s->data + offset[job], size);
+    if (ret < 0)
+        goto error;
+
+    lc->end_of_tiles_x = (pps->col_bd[tile % pps->num_tile_columns] +
+                          pps->column_width[tile % pps->num_tile_columns]) << sps->log2_ctb_size;
+    lc->first_qp_group = 1;
+    lc->qp_y           = s->sh.slice_qp;
+
+    while (more_data && ctb_addr_ts < ctb_addr_end) {
+        int x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+        int y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+
+        hls_decode_neighbour(s, x_ctb, y_ctb, ctb_addr_ts);
+
+        if (atomic_load(&s1->wpp_err))
+            return 0;
+
+        ret = ff_hevc_cabac_init(s, ctb_addr_ts, 0);
+        if (ret < 0)
+            goto error;
+
+        hls_sao_param(s, x_ctb >> sps->log2_ctb_size, y_ctb >> sps->log2_ctb_size);
+
+        s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
+        s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+        s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
+
+        more_data = hls_coding_quadtree(s, x_ctb, y_ctb, sps->log2_ctb_size, 0);
+        if (more_data < 0) {
+            ret = more_data;
+            goto error;
+        }
+
+        ctb_addr_ts++;
+        ctb_addr_rs = pps->ctb_addr_ts_to_rs[FFMIN(ctb_addr_ts, sps->ctb_size - 1)];
+    }
+
+    if (ctb_addr_ts < ctb_addr_end ||
+        (more_data && job == s->sh.num_entry_point_offsets && ctb_addr_end < sps->ctb_size) ||
+        (!more_data && job != s->sh.num_entry_point_offsets)) {
+        av_log(s->avctx, AV_LOG_ERROR, "Tile %d does not end at its substream boundary\n", tile);
+        ret = AVERROR_INVALIDDATA;
+        ctb_addr_rs = pps->ctb_addr_ts_to_rs[FFMIN(ctb_addr_ts, sps->ctb_size - 1)];
+        goto error;
+    }
+
+    if (tile_filter_independent(s, tile, tile - job))
+        ff_hevc_hls_filter_tile(s, tile);
+
+    return job == s->sh.num_entry_point_offsets ? ctb_addr_ts : 0;
+error:
+    s->tab_slice_address[ctb_addr_rs] = -1;
+    atomic_store(&s1->wpp_err, 1);
+    return ret;
+}
+
+/**
+ * Finish the in-loop filters of a slice segment whose tiles were decoded
+ * in parallel, visiting the CTBs in the same order as hls_decode_entry().
+ * Only the edges on tile boundaries and the SAO of the CTBs near them are
+ * left to do, unless tile_filter_independent() failed for the tile.
+ */
+static void hls_filter_tiles(HEVCContext *s, int ctb_addr_ts, int ctb_addr_end)
+{
+    const HEVCPPS *pps = s->ps.pps;
+    const HEVCSPS *sps = s->ps.sps;
+    int ctb_size = 1 << sps->log2_ctb_size;
+    int x_ctb = 0, y_ctb = 0;
+    int i;
+
+    if (!s->sh.disable_deblocking_filter_flag) {
+        for (i = ctb_addr_ts; i < ctb_addr_end; i++) {
+            int ctb_addr_rs    = pps->ctb_addr_ts_to_rs[i];
+            int boundary_flags = 0;
+
+            x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+            y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+            if (x_ctb > 0 && pps->tile_id[i] != pps->tile_id[pps->ctb_addr_rs_to_ts[ctb_addr_rs - 1]]) {
+                boundary_flags |= BOUNDARY_LEFT_TILE;
+                if (s->tab_slice_address[ctb_addr_rs] != s->tab_slice_address[ctb_addr_rs - 1])
+                    boundary_flags |= BOUNDARY_LEFT_SLICE;
+            }
+            if (y_ctb > 0 && pps->tile_id[i] != pps->tile_id[pps->ctb_addr_rs_to_ts[ctb_addr_rs - sps->ctb_width]]) {
+                boundary_flags |= BOUNDARY_UPPER_TILE;
+                if (s->tab_slice_address[ctb_addr_rs] != s->tab_slice_address[ctb_addr_rs - sps->ctb_width])
+                    boundary_flags |= BOUNDARY_UPPER_SLICE;
+            }
+            if (boundary_flags)
+                ff_hevc_tile_boundary_strengths(s, x_ctb, y_ctb, boundary_flags);
+        }
+    }
+
+    for (i = ctb_addr_ts; i < ctb_addr_end; i++) {
+        int ctb_addr_rs = pps->ctb_addr_ts_to_rs[i];
+
+        x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+        y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+        ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
+    }
+
+    if (x_ctb + ctb_size >= sps->width &&
+        y_ctb + ctb_size >= sps->height)
+        ff_hevc_hls_filter(s, x_ctb, y_ctb, ctb_size);
+}
+
 static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
 {
     const uint8_t *data = nal->data;
@@ -2620,7 +2789,8 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
         return AVERROR(ENOMEM);
     }
 
-    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * s->ps.sps->ctb_width >= s->ps.sps->ctb_width * s->ps.sps->ctb_height) {
+    if (s->ps.pps->entropy_coding_sync_enabled_flag &&
+        s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * s->ps.sps->ctb_width >= s->ps.sps->ctb_width * s->ps.sps->ctb_height) {
         av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
             s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
             s->ps.sps->ctb_width, s->ps.sps->ctb_height
@@ -2696,8 +2866,50 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
         ret[i] = 0;
     }
 
-    if (s->ps.pps->entropy_coding_sync_enabled_flag)
+    if (s->ps.pps->entropy_coding_sync_enabled_flag) {
         s->avctx->execute2(s->avctx, hls_decode_entry_wpp, arg, ret, s->sh.num_entry_point_offsets + 1);
+    } else if (s->enable_parallel_tiles) {
+        const HEVCPPS *pps = s->ps.pps;
+        int ctb_addr_ts    = pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+        int tile           = pps->tile_id[ctb_addr_ts];
+        int ctb_addr_end;
+
+        if (tile + s->sh.num_entry_point_offsets >= pps->num_tile_columns * pps->num_tile_rows ||
+            s->sh.slice_ctb_addr_rs != pps->tile_pos_rs[tile]) {
+            av_log(s->avctx, AV_LOG_ERROR, "Tile entry points are wrong (%d %d)\n",
+                   s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets);
+            res = AVERROR_INVALIDDATA;
+            goto error;
+        }
+        if (s->sh.dependent_slice_segment_flag &&
+            (!ctb_addr_ts || s->tab_slice_address[pps->ctb_addr_ts_to_rs[ctb_addr_ts - 1]] != s->sh.slice_addr)) {
+            av_log(s->avctx, AV_LOG_ERROR, "Previous slice segment missing\n");
+            res = AVERROR_INVALIDDATA;
+            goto error;
+        }
+
+        tile += s->sh.num_entry_point_offsets + 1;
+        ctb_addr_end = tile < pps->num_tile_columns * pps->num_tile_rows ?
+                       pps->ctb_addr_rs_to_ts[pps->tile_pos_rs[tile]] : s->ps.sps->ctb_size;
+
+        // the slice boundary checks of every tile look at its neighbours
+        for (i = ctb_addr_ts; i < ctb_addr_end; i++)
+            s->tab_slice_address[pps->ctb_addr_ts_to_rs[i]] = s->sh.slice_addr;
+
+        arg[0] = lc->gb.index >> 3;
+        for (i = 1; i <= s->sh.num_entry_point_offsets; i++)
+            arg[i] = s->sh.offset[i - 1];
+
+        s->avctx->execute2(s->avctx, hls_decode_entry_tile, arg, ret, s->sh.num_entry_point_offsets + 1);
+
+        for (i = 0; i <= s->sh.num_entry_point_offsets; i++) {
+            if (ret[i] < 0) {
+                res = ret[i];
+                goto error;
+            }
+        }
+        hls_filter_tiles(s, ctb_addr_ts, ctb_addr_end);
+    }
 
     for (i = 0; i <= s->sh.num_entry_point_offsets; i++)
         res += ret[i];
@@ -2906,6 +3118,7 @@ static int hevc_frame_start(HEVCContext *s)
     memset(s->cbf_luma,      0, s->ps.sps->min_tb_width * s->ps.sps->min_tb_height);
     memset(s->is_pcm,        0, (s->ps.sps->min_pu_width + 1) * (s->ps.sps->min_pu_height + 1));
     memset(s->tab_slice_address, -1, pic_size_in_ctb * sizeof(*s->tab_slice_address));
+    memset(s->deblock_tile_edges, 0, s->ps.sps->ctb_size);
 
     s->is_decoded        = 0;
     s->first_nal_type    = s->nal_unit_type;
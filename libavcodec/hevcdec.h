@@ -542,6 +542,7 @@ typedef struct HEVCContext {
 
     // CTB-level flags affecting loop filter operation
     uint8_t *filter_slice_edges;
+    uint8_t *deblock_tile_edges; ///< 1: only the tile edges are left to deblock, 2: nothing is
 
     /** used on BE to byteswap the lines for checksumming */
     uint8_t *checksum_buf;
@@ -675,12 +676,22 @@ void ff_hevc_set_qPy(HEVCContext *s, int xBase, int yBase,
                      int log2_cb_size);
 void ff_hevc_deblocking_boundary_strengths(HEVCContext *s, int x0, int y0,
                                            int log2_trafo_size);
+void ff_hevc_tile_boundary_strengths(HEVCContext *s, int x_ctb, int y_ctb,
+                                     int boundary_flags);
 int ff_hevc_cu_qp_delta_sign_flag(HEVCContext *s);
 int ff_hevc_cu_qp_delta_abs(HEVCContext *s);
 int ff_hevc_cu_chroma_qp_offset_flag(HEVCContext *s);
 int ff_hevc_cu_chroma_qp_offset_idx(HEVCContext *s);
 void ff_hevc_hls_filter(HEVCContext *s, int x, int y, int ctb_size);
 void ff_hevc_hls_filters(HEVCContext *s, int x_ctb, int y_ctb, int ctb_size);
+
+/**
+ * Deblock a tile while the tiles around it may still be decoding, and run
+ * SAO on the CTBs far enough from them. The edges on the left and upper
+ * tile boundaries are left to ff_hevc_hls_filter().
+ */
+void ff_hevc_hls_filter_tile(HEVCContext *s, int tile);
+
 void ff_hevc_hls_residual_coding(HEVCContext *s, int x0, int y0,
                                  int log2_trafo_size, enum ScanType scan_idx,
                                  int c_idx);
@@ -92,6 +92,15 @@ typedef struct Jpeg2000Tile {
     int coord[2][2];                    // border coordinates {{x0, x1}, {y0, y1}}
 } Jpeg2000Tile;
 
+/* a code-block to decode, with what its dequantization needs */
+typedef struct Jpeg2000CblkJob {
+    Jpeg2000Component   *comp;
+    Jpeg2000CodingStyle *codsty;
+    Jpeg2000Band        *band;
+    Jpeg2000Cblk        *cblk;
+    int                 bandpos;
+} Jpeg2000CblkJob;
+
 typedef struct Jpeg2000DecoderContext {
     AVClass         *class;
     AVCodecContext  *avctx;
@@ -134,6 +143,20 @@ typedef struct Jpeg2000DecoderContext {
     Jpeg2000Tile    *tile;
     Jpeg2000DSPContext dsp;
 
+    /* work shared out to the slice threads */
+    int             nb_slices;
+    Jpeg2000T1Context *t1;              // one per slice thread
+    Jpeg2000CblkJob *cblk_jobs;
+    unsigned        cblk_jobs_size;
+    int             nb_cblk_jobs;
+    Jpeg2000Component **dwt_comps;      // components that need an inverse DWT
+    unsigned        dwt_comps_size;
+    int             nb_dwt_comps;
+    int             dwt_pass;
+    uint8_t         *dwt_linebufs;      // one line buffer per slice thread
+    unsigned        dwt_linebufs_size;
+    int             dwt_linebuf_size;
+
     /*options parameters*/
     int             reduction_factor;
 } Jpeg2000DecoderContext;
@@ -1896,32 +1919,44 @@ static void dequantization_int_97(int x, int y, Jpeg2000Cblk *cblk,
     }
 }
 
-static inline void mct_decode(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
+static inline void mct_decode(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile,
+                              int jobnr, int nb_jobs)
 {
-    int i, csize = 1;
+    int i, csize = 1, start, end;
     void *src[3];
 
     for (i = 1; i < 3; i++) {
         if (tile->codsty[0].transform != tile->codsty[i].transform) {
-            av_log(s->avctx, AV_LOG_ERROR, "Transforms mismatch, MCT not supported\n");
+            if (!jobnr)
+                av_log(s->avctx, AV_LOG_ERROR, "Transforms mismatch, MCT not supported\n");
             return;
         }
         if (memcmp(tile->comp[0].coord, tile->comp[i].coord, sizeof(tile->comp[0].coord))) {
-            av_log(s->avctx, AV_LOG_ERROR, "Coords mismatch, MCT not supported\n");
+            if (!jobnr)
+                av_log(s->avctx, AV_LOG_ERROR, "Coords mismatch, MCT not supported\n");
             return;
         }
     }
 
+    for (i = 0; i < 2; i++)
+        csize *= tile->comp[0].coord[i][1] - tile->comp[0].coord[i][0];
+
+    /* The SIMD versions work on whole vectors, so every slice
+     * but the last must span a multiple of their size. */
+    start = ((int64_t)csize *  jobnr      / nb_jobs) & ~15;
+    end   = ((int64_t)csize * (jobnr + 1) / nb_jobs) & ~15;
+    if (jobnr == nb_jobs - 1)
+        end = csize;
+    if (start >= end)
+        return;
+
     for (i = 0; i < 3; i++)
         if (tile->codsty[0].transform == FF_DWT97)
-            src[i] = tile->comp[i].f_data;
+            src[i] = tile->comp[i].f_data + start;
         else
-            src[i] = tile->comp[i].i_data;
+            src[i] = tile->comp[i].i_data + start;
 
-    for (i = 0; i < 2; i++)
-        csize *= tile->comp[0].coord[i][1] - tile->comp[0].coord[i][0];
-
-    s->dsp.mct_decode[tile->codsty[0].transform](src[0], src[1], src[2], csize);
+    s->dsp.mct_decode[tile->codsty[0].transform](src[0], src[1], src[2], end - start);
 }
 
 static inline void roi_scale_cblk(Jpeg2000Cblk *cblk,
@@ -1937,10 +1972,9 @@ static inline void roi_scale_cblk(Jpeg2000Cblk *cblk,
     }
 }
 
-static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
+/* List the code-blocks with data and the components they belong to. */
+static int tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile)
 {
-    Jpeg2000T1Context t1;
-
     int compno, reslevelno, bandno;
 
     /* Loop on tile components */
@@ -1949,8 +1983,6 @@ static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile
         Jpeg2000CodingStyle *codsty = tile->codsty + compno;
         int coded = 0;
 
-        t1.stride = (1<<codsty->log2_cblk_width) + 2;
-
         /* Loop on resolution levels */
         for (reslevelno = 0; reslevelno < codsty->nreslevels2decode; reslevelno++) {
             Jpeg2000ResLevel *rlevel = comp->reslevel + reslevelno;
@@ -1975,42 +2007,97 @@ static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile
                     for (cblkno = 0;
                          cblkno < prec->nb_codeblocks_width * prec->nb_codeblocks_height;
                          cblkno++) {
-                        int x, y;
                         Jpeg2000Cblk *cblk = prec->cblk + cblkno;
-                        int ret = decode_cblk(s, codsty, &t1, cblk,
-                                    cblk->coord[0][1] - cblk->coord[0][0],
-                                    cblk->coord[1][1] - cblk->coord[1][0],
-                                    bandpos, comp->roi_shift);
-                        if (ret)
-                            coded = 1;
-                        else
+                        Jpeg2000CblkJob *job;
+
+                        /* If code-block contains no compressed data: nothing to do. */
+                        if (!cblk->length)
                             continue;
-                        x = cblk->coord[0][0] - band->coord[0][0];
-                        y = cblk->coord[1][0] - band->coord[1][0];
-
-                        if (comp->roi_shift)
-                            roi_scale_cblk(cblk, comp, &t1);
-                        if (codsty->transform == FF_DWT97)
-                            dequantization_float(x, y, cblk, comp, &t1, band);
-                        else if (codsty->transform == FF_DWT97_INT)
-                            dequantization_int_97(x, y, cblk, comp, &t1, band);
-                        else
-                            dequantization_int(x, y, cblk, comp, &t1, band);
+                        coded = 1;
+
+                        job = av_fast_realloc(s->cblk_jobs, &s->cblk_jobs_size,
+                                              (s->nb_cblk_jobs + 1) * sizeof(*s->cblk_jobs));
+                        if (!job)
+                            return AVERROR(ENOMEM);
+                        s->cblk_jobs = job;
+                        job += s->nb_cblk_jobs++;
+
+                        job->comp    = comp;
+                        job->codsty  = codsty;
+                        job->band    = band;
+                        job->cblk    = cblk;
+                        job->bandpos = bandpos;
                    } /* end cblk */
                 } /*end prec */
             } /* end band */
         } /* end reslevel */
 
-        /* inverse DWT */
-        if (coded)
-            ff_dwt_decode(&comp->dwt, codsty->transform == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data);
-
+        if (coded) {
+            Jpeg2000Component **comps = av_fast_realloc(s->dwt_comps, &s->dwt_comps_size,
+                                                        (s->nb_dwt_comps + 1) * sizeof(*comps));
+            if (!comps)
+                return AVERROR(ENOMEM);
+            s->dwt_comps = comps;
+            s->dwt_comps[s->nb_dwt_comps++] = comp;
+            s->dwt_linebuf_size = FFMAX(s->dwt_linebuf_size, comp->dwt.linebuf_size);
+        }
     } /*end comp */
+
+    return 0;
+}
+
+static int jpeg2000_decode_cblk(AVCodecContext *avctx, void *td,
+                                int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000CblkJob *job      = s->cblk_jobs + jobnr;
+    Jpeg2000Component *comp   = job->comp;
+    Jpeg2000CodingStyle *codsty = job->codsty;
+    Jpeg2000Band *band        = job->band;
+    Jpeg2000Cblk *cblk        = job->cblk;
+    Jpeg2000T1Context *t1     = s->t1 + threadnr;
+    int x, y;
+
+    t1->stride = (1<<codsty->log2_cblk_width) + 2;
+
+    decode_cblk(s, codsty, t1, cblk,
+                cblk->coord[0][1] - cblk->coord[0][0],
+                cblk->coord[1][1] - cblk->coord[1][0],
+                job->bandpos, comp->roi_shift);
+
+    x = cblk->coord[0][0] - band->coord[0][0];
+    y = cblk->coord[1][0] - band->coord[1][0];
+
+    if (comp->roi_shift)
+        roi_scale_cblk(cblk, comp, t1);
+    if (codsty->transform == FF_DWT97)
+        dequantization_float(x, y, cblk, comp, t1, band);
+    else if (codsty->transform == FF_DWT97_INT)
+        dequantization_int_97(x, y, cblk, comp, t1, band);
+    else
+        dequantization_int(x, y, cblk, comp, t1, band);
+
+    return 0;
+}
+
+static int jpeg2000_dwt_slice(AVCodecContext *avctx, void *td,
+                              int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    Jpeg2000Component *comp   = s->dwt_comps[jobnr / s->nb_slices];
+
+    /* inverse DWT */
+    ff_dwt_decode_slice(&comp->dwt,
+                        comp->dwt.type == FF_DWT97 ? (void*)comp->f_data : (void*)comp->i_data,
+                        s->dwt_pass, jobnr % s->nb_slices, s->nb_slices,
+                        s->dwt_linebufs + threadnr * s->dwt_linebuf_size);
+    return 0;
 }
 
 #define WRITE_FRAME(D, PIXEL)                                                                     \
     static inline void write_frame_ ## D(Jpeg2000DecoderContext * s, Jpeg2000Tile * tile,         \
-                                         AVFrame * picture, int precision)                        \
+                                         AVFrame * picture, int precision,                        \
+                                         int jobnr, int nb_jobs)                                  \
     {                                                                                             \
         const AVPixFmtDescriptor *pixdesc = av_pix_fmt_desc_get(s->avctx->pix_fmt);               \
         int planar    = !!(pixdesc->flags & AV_PIX_FMT_FLAG_PLANAR);                              \
@@ -2031,14 +2118,21 @@ static inline void tile_codeblocks(Jpeg2000DecoderContext *s, Jpeg2000Tile *tile
             int h            = tile->comp[compno].coord[1][1] -                                   \
                                ff_jpeg2000_ceildiv(s->image_offset_y, s->cdy[compno]);            \
             int plane        = 0;                                                                 \
+            int y0, y1;                                                                           \
                                                                                                   \
             if (planar)                                                                           \
                 plane = s->cdef[compno] ? s->cdef[compno]-1 : (s->ncomponents-1);                 \
                                                                                                   \
             y    = tile->comp[compno].coord[1][0] -                                               \
                    ff_jpeg2000_ceildiv(s->image_offset_y, s->cdy[compno]);                        \
-            line = (PIXEL *)picture->data[plane] + y * (picture->linesize[plane] / sizeof(PIXEL));\
-            for (; y < h; y++) {                                                                  \
+            y0   = y + (int64_t)(h - y) *  jobnr      / nb_jobs;                                  \
+            y1   = y + (int64_t)(h - y) * (jobnr + 1) / nb_jobs;                                  \
+            if (y0 >= y1)                                                                         \
+                continue;                                                                         \
+            datap   += (y0 - y) * (comp->coord[0][1] - comp->coord[0][0]);                        \
+            i_datap += (y0 - y) * (comp->coord[0][1] - comp->coord[0][0]);                        \
+            line = (PIXEL *)picture->data[plane] + y0 * (picture->linesize[plane] / sizeof(PIXEL));\
+            for (y = y0; y < y1; y++) {                                                           \
                 PIXEL *dst;                                                                       \
                                                                                                   \
                 x   = tile->comp[compno].coord[0][0] -                                            \
@@ -2075,45 +2169,99 @@ WRITE_FRAME(16, uint16_t)
 
 #undef WRITE_FRAME
 
-static int jpeg2000_decode_tile(AVCodecContext *avctx, void *td,
-                                int jobnr, int threadnr)
+static int jpeg2000_mct_slice(AVCodecContext *avctx, void *td,
+                              int jobnr, int threadnr)
 {
     Jpeg2000DecoderContext *s = avctx->priv_data;
-    AVFrame *picture = td;
-    Jpeg2000Tile *tile = s->tile + jobnr;
-    int x;
-
-    tile_codeblocks(s, tile);
+    Jpeg2000Tile *tile = s->tile + jobnr / s->nb_slices;
 
     /* inverse MCT transformation */
     if (tile->codsty[0].mct)
-        mct_decode(s, tile);
+        mct_decode(s, tile, jobnr % s->nb_slices, s->nb_slices);
 
-    for (x = 0; x < s->ncomponents; x++) {
-        if (s->cdef[x] < 0) {
-            for (x = 0; x < s->ncomponents; x++) {
-                s->cdef[x] = x + 1;
-            }
-            if ((s->ncomponents & 1) == 0)
-                s->cdef[s->ncomponents-1] = 0;
-            break;
-        }
-    }
+    return 0;
+}
+
+static int jpeg2000_write_slice(AVCodecContext *avctx, void *td,
+                                int jobnr, int threadnr)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+    AVFrame *picture = td;
+    Jpeg2000Tile *tile = s->tile + jobnr / s->nb_slices;
+    int slice = jobnr % s->nb_slices;
 
     if (s->precision <= 8) {
-        write_frame_8(s, tile, picture, 8);
+        write_frame_8(s, tile, picture, 8, slice, s->nb_slices);
     } else {
         int precision = picture->format == AV_PIX_FMT_XYZ12 ||
                         picture->format == AV_PIX_FMT_RGB48 ||
                         picture->format == AV_PIX_FMT_RGBA64 ||
                         picture->format == AV_PIX_FMT_GRAY16 ? 16 : s->precision;
 
-        write_frame_16(s, tile, picture, precision);
+        write_frame_16(s, tile, picture, precision, slice, s->nb_slices);
     }
 
     return 0;
 }
 
+/* Decode all tiles in stages, each of which is split into many jobs so that
+ * slice threads are kept busy even if the image is a single tile:
+ * tier-1 decoding of every code-block, the inverse DWT of each component
+ * one pass at a time, the inverse MCT and the output of each tile. */
+static int jpeg2000_decode_tiles(Jpeg2000DecoderContext *s, AVFrame *picture)
+{
+    AVCodecContext *avctx = s->avctx;
+    int nb_tiles = s->numXtiles * s->numYtiles;
+    int nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+    int tileno, i, ret, nb_passes = 0;
+
+    if (!s->t1) {
+        s->t1 = av_malloc_array(nb_threads, sizeof(*s->t1));
+        if (!s->t1)
+            return AVERROR(ENOMEM);
+    }
+    s->nb_slices = nb_threads;
+
+    s->nb_cblk_jobs     = 0;
+    s->nb_dwt_comps     = 0;
+    s->dwt_linebuf_size = 0;
+    for (tileno = 0; tileno < nb_tiles; tileno++)
+        if ((ret = tile_codeblocks(s, s->tile + tileno)) < 0)
+            return ret;
+
+    if (s->nb_dwt_comps) {
+        av_fast_malloc(&s->dwt_linebufs, &s->dwt_linebufs_size,
+                       (size_t)nb_threads * s->dwt_linebuf_size);
+        if (!s->dwt_linebufs)
+            return AVERROR(ENOMEM);
+    }
+
+    avctx->execute2(avctx, jpeg2000_decode_cblk, NULL, NULL, s->nb_cblk_jobs);
+
+    for (i = 0; i < s->nb_dwt_comps; i++)
+        nb_passes = FFMAX(nb_passes, ff_dwt_decode_passes(&s->dwt_comps[i]->dwt));
+    for (s->dwt_pass = 0; s->dwt_pass < nb_passes; s->dwt_pass++)
+        avctx->execute2(avctx, jpeg2000_dwt_slice, NULL, NULL,
+                        s->nb_dwt_comps * s->nb_slices);
+
+    avctx->execute2(avctx, jpeg2000_mct_slice, NULL, NULL, nb_tiles * s->nb_slices);
+
+    for (i = 0; i < s->ncomponents; i++) {
+        if (s->cdef[i] < 0) {
+            for (i = 0; i < s->ncomponents; i++) {
+                s->cdef[i] = i + 1;
+            }
+            if ((s->ncomponents & 1) == 0)
+                s->cdef[s->ncomponents-1] = 0;
+            break;
+        }
+    }
+
+    avctx->execute2(avctx, jpeg2000_write_slice, picture, NULL, nb_tiles * s->nb_slices);
+
+    return 0;
+}
+
 static void jpeg2000_dec_cleanup(Jpeg2000DecoderContext *s)
 {
     int tileno, compno;
@@ -2490,6 +2638,21 @@ static av_cold int jpeg2000_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+static av_cold int jpeg2000_decode_close(AVCodecContext *avctx)
+{
+    Jpeg2000DecoderContext *s = avctx->priv_data;
+
+    av_freep(&s->t1);
+    av_freep(&s->cblk_jobs);
+    s->cblk_jobs_size = 0;
+    av_freep(&s->dwt_comps);
+    s->dwt_comps_size = 0;
+    av_freep(&s->dwt_linebufs);
+    s->dwt_linebufs_size = 0;
+
+    return 0;
+}
+
 static int jpeg2000_decode_frame(AVCodecContext *avctx, void *data,
                                  int *got_frame, AVPacket *avpkt)
 {
@@ -2543,7 +2706,8 @@ static int jpeg2000_decode_frame(AVCodecContext *avctx, void *data,
     if (ret = jpeg2000_read_bitstream_packets(s))
         goto end;
 
-    avctx->execute2(avctx, jpeg2000_decode_tile, picture, NULL, s->numXtiles * s->numYtiles);
+    if ((ret = jpeg2000_decode_tiles(s, picture)) < 0)
+        goto end;
 
     jpeg2000_dec_cleanup(s);
 
@@ -2587,6 +2751,7 @@ AVCodec ff_jpeg2000_decoder = {
     .priv_data_size   = sizeof(Jpeg2000DecoderContext),
     .init             = jpeg2000_decode_init,
     .decode           = jpeg2000_decode_frame,
+    .close            = jpeg2000_decode_close,
     .priv_class       = &jpeg2000_class,
     .max_lowres       = 5,
     .profiles         = NULL_IF_CONFIG_SMALL(ff_jpeg2000_profiles)
@@ -323,24 +323,89 @@ static void sr_1d53(unsigned *p, int i0, int i1)
         p[2 * i + 1] += (int)(p[2 * i] + p[2 * i + 2]) >> 1;
 }
 
-static void dwt_decode53(DWTContext *s, int *t)
+/* The vertical passes filter DWT_COLS columns at once, stored interleaved
+ * in the line buffer, so that each row of the tile is read and written
+ * DWT_COLS samples at a time instead of one sample per cache line. The
+ * arithmetic done on every sample is the same as in the single line
+ * functions. */
+#define DWT_COLS 8
+#define COL(p, i) ((p) + (i) * DWT_COLS)
+
+static av_always_inline void extend_cols(void *p, int i0, int i1,
+                                         int n, int nc)
 {
-    int lev;
-    int w     = s->linelen[s->ndeclevels - 1][0];
-    int32_t *line = s->i_linebuf;
-    line += 3;
+    uint8_t *b = p;
+    const int row = DWT_COLS * sizeof(int32_t);
+    int i;
 
-    for (lev = 0; lev < s->ndeclevels; lev++) {
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        int *l;
+    for (i = 1; i <= n; i++) {
+        memcpy(b + (i0 - i) * row,     b + (i0 + i) * row,     nc * sizeof(int32_t));
+        memcpy(b + (i1 + i - 1) * row, b + (i1 - i - 1) * row, nc * sizeof(int32_t));
+    }
+}
+
+static av_always_inline void sr_1d53_cols(unsigned *p, int i0, int i1, int nc)
+{
+    int i, c;
+
+    if (i1 <= i0 + 1) {
+        if (i0 == 1)
+            for (c = 0; c < nc; c++)
+                COL(p, 1)[c] = (int)COL(p, 1)[c] >> 1;
+        return;
+    }
 
+    /* extend53() reaches two samples out on each side */
+    extend_cols(p, i0, i1, 2, nc);
+
+    for (i = (i0 >> 1); i < (i1 >> 1) + 1; i++) {
+        unsigned *q = COL(p, 2 * i);
+        for (c = 0; c < nc; c++)
+            q[c] -= (int)(q[c - DWT_COLS] + q[c + DWT_COLS] + 2) >> 2;
+    }
+    for (i = (i0 >> 1); i < (i1 >> 1); i++) {
+        unsigned *q = COL(p, 2 * i + 1);
+        for (c = 0; c < nc; c++)
+            q[c] += (int)(q[c - DWT_COLS] + q[c + DWT_COLS]) >> 1;
+    }
+}
+
+static av_always_inline void ver_sd53(int32_t *line, int *t, int w,
+                                      int lv, int mv, int nc)
+{
+    int32_t *l = COL(line, mv);
+    int i, j = 0, c;
+
+    // copy with interleaving
+    for (i = mv; i < lv; i += 2, j++)
+        for (c = 0; c < nc; c++)
+            COL(l, i)[c] = t[w * j + c];
+    for (i = 1 - mv; i < lv; i += 2, j++)
+        for (c = 0; c < nc; c++)
+            COL(l, i)[c] = t[w * j + c];
+
+    sr_1d53_cols(line, mv, mv + lv, nc);
+
+    for (i = 0; i < lv; i++)
+        for (c = 0; c < nc; c++)
+            t[w * i + c] = COL(l, i)[c];
+}
+
+static void dwt_decode53(DWTContext *s, int *t, int lev, int vertical,
+                         int start, int end, int32_t *linebuf)
+{
+    int w   = s->linelen[s->ndeclevels - 1][0];
+    int lh  = s->linelen[lev][0],
+        lv  = s->linelen[lev][1],
+        mh  = s->mod[lev][0],
+        mv  = s->mod[lev][1],
+        lp;
+
+    if (!vertical) {
         // HOR_SD
-        l = line + mh;
-        for (lp = 0; lp < lv; lp++) {
+        int32_t *line = linebuf + 3;
+        int *l = line + mh;
+        for (lp = start; lp < end; lp++) {
             int i, j = 0;
             // copy with interleaving
             for (i = mh; i < lh; i += 2, j++)
@@ -353,21 +418,14 @@ static void dwt_decode53(DWTContext *s, int *t)
             for (i = 0; i < lh; i++)
                 t[w * lp + i] = l[i];
         }
-
+    } else {
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
-            // copy with interleaving
-            for (i = mv; i < lv; i += 2, j++)
-                l[i] = t[w * j + lp];
-            for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = t[w * j + lp];
-
-            sr_1d53(line, mv, mv + lv);
-
-            for (i = 0; i < lv; i++)
-                t[w * i + lp] = l[i];
+        int32_t *line = COL(linebuf, 3);
+        for (lp = start; lp < end; lp += DWT_COLS) {
+            if (end - lp >= DWT_COLS)
+                ver_sd53(line, t + lp, w, lv, mv, DWT_COLS);
+            else
+                ver_sd53(line, t + lp, w, lv, mv, end - lp);
         }
     }
 }
@@ -399,25 +457,85 @@ static void sr_1d97_float(float *p, int i0, int i1)
         p[2 * i + 1] += F_LFTG_ALPHA * (p[2 * i]     + p[2 * i + 2]);
 }
 
-static void dwt_decode97_float(DWTContext *s, float *t)
+static av_always_inline void sr_1d97_float_cols(float *p, int i0, int i1, int nc)
+{
+    int i, c;
+
+    if (i1 <= i0 + 1) {
+        if (i0 == 1)
+            for (c = 0; c < nc; c++)
+                COL(p, 1)[c] *= F_LFTG_K/2;
+        else
+            for (c = 0; c < nc; c++)
+                COL(p, 0)[c] *= F_LFTG_X;
+        return;
+    }
+
+    extend_cols(p, i0, i1, 4, nc);
+
+    for (i = (i0 >> 1) - 1; i < (i1 >> 1) + 2; i++) {
+        float *q = COL(p, 2 * i);
+        for (c = 0; c < nc; c++)
+            q[c] -= F_LFTG_DELTA * (q[c - DWT_COLS] + q[c + DWT_COLS]);
+    }
+    /* step 4 */
+    for (i = (i0 >> 1) - 1; i < (i1 >> 1) + 1; i++) {
+        float *q = COL(p, 2 * i + 1);
+        for (c = 0; c < nc; c++)
+            q[c] -= F_LFTG_GAMMA * (q[c - DWT_COLS] + q[c + DWT_COLS]);
+    }
+    /*step 5*/
+    for (i = (i0 >> 1); i < (i1 >> 1) + 1; i++) {
+        float *q = COL(p, 2 * i);
+        for (c = 0; c < nc; c++)
+            q[c] += F_LFTG_BETA  * (q[c - DWT_COLS] + q[c + DWT_COLS]);
+    }
+    /* step 6 */
+    for (i = (i0 >> 1); i < (i1 >> 1); i++) {
+        float *q = COL(p, 2 * i + 1);
+        for (c = 0; c < nc; c++)
+            q[c] += F_LFTG_ALPHA * (q[c - DWT_COLS] + q[c + DWT_COLS]);
+    }
+}
+
+static av_always_inline void ver_sd97_float(float *line, float *data, int w,
+                                            int lv, int mv, int nc)
+{
+    float *l = COL(line, mv);
+    int i, j = 0, c;
+
+    // copy with interleaving
+    for (i = mv; i < lv; i += 2, j++)
+        for (c = 0; c < nc; c++)
+            COL(l, i)[c] = data[w * j + c];
+    for (i = 1 - mv; i < lv; i += 2, j++)
+        for (c = 0; c < nc; c++)
+            COL(l, i)[c] = data[w * j + c];
+
+    sr_1d97_float_cols(line, mv, mv + lv, nc);
+
+    for (i = 0; i < lv; i++)
+        for (c = 0; c < nc; c++)
+            data[w * i + c] = COL(l, i)[c];
+}
+
+static void dwt_decode97_float(DWTContext *s, float *t, int lev, int vertical,
+                               int start, int end, float *linebuf)
 {
-    int lev;
     int w       = s->linelen[s->ndeclevels - 1][0];
-    float *line = s->f_linebuf;
+    int lh      = s->linelen[lev][0],
+        lv      = s->linelen[lev][1],
+        mh      = s->mod[lev][0],
+        mv      = s->mod[lev][1],
+        lp;
     float *data = t;
-    /* position at index O of line range [0-5,w+5] cf. extend function */
-    line += 5;
 
-    for (lev = 0; lev < s->ndeclevels; lev++) {
-        int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        float *l;
+    if (!vertical) {
+        /* position at index O of line range [0-5,w+5] cf. extend function */
+        float *line = linebuf + 5;
+        float *l    = line + mh;
         // HOR_SD
-        l = line + mh;
-        for (lp = 0; lp < lv; lp++) {
+        for (lp = start; lp < end; lp++) {
             int i, j = 0;
             // copy with interleaving
             for (i = mh; i < lh; i += 2, j++)
@@ -430,21 +548,14 @@ static void dwt_decode97_float(DWTContext *s, float *t)
             for (i = 0; i < lh; i++)
                 data[w * lp + i] = l[i];
         }
-
+    } else {
+        float *line = COL(linebuf, 5);
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
-            // copy with interleaving
-            for (i = mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp];
-            for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp];
-
-            sr_1d97_float(line, mv, mv + lv);
-
-            for (i = 0; i < lv; i++)
-                data[w * i + lp] = l[i];
+        for (lp = start; lp < end; lp += DWT_COLS) {
+            if (end - lp >= DWT_COLS)
+                ver_sd97_float(line, data + lp, w, lv, mv, DWT_COLS);
+            else
+                ver_sd97_float(line, data + lp, w, lv, mv, end - lp);
         }
     }
 }
@@ -476,31 +587,92 @@ static void sr_1d97_int(int32_t *p, int i0, int i1)
         p[2 * i + 1] += (I_LFTG_ALPHA * (p[2 * i]     + (int64_t)p[2 * i + 2]) + (1 << 15)) >> 16;
 }
 
-static void dwt_decode97_int(DWTContext *s, int32_t *t)
+static av_always_inline void sr_1d97_int_cols(int32_t *p, int i0, int i1, int nc)
 {
-    int lev;
-    int w       = s->linelen[s->ndeclevels - 1][0];
-    int h       = s->linelen[s->ndeclevels - 1][1];
-    int i;
-    int32_t *line = s->i_linebuf;
-    int32_t *data = t;
-    /* position at index O of line range [0-5,w+5] cf. extend function */
-    line += 5;
+    int i, c;
 
-    for (i = 0; i < w * h; i++)
-        data[i] *= 1LL << I_PRESHIFT;
+    if (i1 <= i0 + 1) {
+        if (i0 == 1)
+            for (c = 0; c < nc; c++)
+                COL(p, 1)[c] = (COL(p, 1)[c] * I_LFTG_K + (1<<16)) >> 17;
+        else
+            for (c = 0; c < nc; c++)
+                COL(p, 0)[c] = (COL(p, 0)[c] * I_LFTG_X + (1<<15)) >> 16;
+        return;
+    }
 
-    for (lev = 0; lev < s->ndeclevels; lev++) {
+    extend_cols(p, i0, i1, 4, nc);
+
+    for (i = (i0 >> 1) - 1; i < (i1 >> 1) + 2; i++) {
+        int32_t *q = COL(p, 2 * i);
+        for (c = 0; c < nc; c++)
+            q[c] -= (I_LFTG_DELTA * (q[c - DWT_COLS] + (int64_t)q[c + DWT_COLS]) + (1 << 15)) >> 16;
+    }
+    /* step 4 */
+    for (i = (i0 >> 1) - 1; i < (i1 >> 1) + 1; i++) {
+        int32_t *q = COL(p, 2 * i + 1);
+        for (c = 0; c < nc; c++)
+            q[c] -= (I_LFTG_GAMMA * (q[c - DWT_COLS] + (int64_t)q[c + DWT_COLS]) + (1 << 15)) >> 16;
+    }
+    /*step 5*/
+    for (i = (i0 >> 1); i < (i1 >> 1) + 1; i++) {
+        int32_t *q = COL(p, 2 * i);
+        for (c = 0; c < nc; c++)
+            q[c] += (I_LFTG_BETA  * (q[c - DWT_COLS] + (int64_t)q[c + DWT_COLS]) + (1 << 15)) >> 16;
+    }
+    /* step 6 */
+    for (i = (i0 >> 1); i < (i1 >> 1); i++) {
+        int32_t *q = COL(p, 2 * i + 1);
+        for (c = 0; c < nc; c++)
+            q[c] += (I_LFTG_ALPHA * (q[c - DWT_COLS] + (int64_t)q[c + DWT_COLS]) + (1 << 15)) >> 16;
+    }
+}
+
+static av_always_inline void ver_sd97_int(int32_t *line, int32_t *data, int w,
+                                          int lv, int mv, int nc)
+{
+    int32_t *l = COL(line, mv);
+    int i, j = 0, c;
+
+    // rescale with interleaving
+    for (i = mv; i < lv; i += 2, j++)
+        for (c = 0; c < nc; c++)
+            COL(l, i)[c] = ((data[w * j + c] * I_LFTG_K) + (1 << 15)) >> 16;
+    for (i = 1 - mv; i < lv; i += 2, j++)
+        for (c = 0; c < nc; c++)
+            COL(l, i)[c] = data[w * j + c];
+
+    sr_1d97_int_cols(line, mv, mv + lv, nc);
+
+    for (i = 0; i < lv; i++)
+        for (c = 0; c < nc; c++)
+            data[w * i + c] = COL(l, i)[c];
+}
+
+/* lev is -1 for the scaling before the lifting
+ * and ndeclevels for the scaling after it. */
+static void dwt_decode97_int(DWTContext *s, int32_t *t, int lev, int vertical,
+                             int start, int end, int32_t *linebuf)
+{
+    int w         = s->linelen[s->ndeclevels - 1][0];
+    int32_t *data = t;
+    int i, lp;
+
+    if (lev < 0) {
+        for (i = w * start; i < w * end; i++)
+            data[i] *= 1LL << I_PRESHIFT;
+    } else if (lev == s->ndeclevels) {
+        for (i = w * start; i < w * end; i++)
+            data[i] = (data[i] + ((1LL<<I_PRESHIFT)>>1)) >> I_PRESHIFT;
+    } else if (!vertical) {
         int lh = s->linelen[lev][0],
-            lv = s->linelen[lev][1],
-            mh = s->mod[lev][0],
-            mv = s->mod[lev][1],
-            lp;
-        int32_t *l;
+            mh = s->mod[lev][0];
+        /* position at index O of line range [0-5,w+5] cf. extend function */
+        int32_t *line = linebuf + 5;
+        int32_t *l    = line + mh;
         // HOR_SD
-        l = line + mh;
-        for (lp = 0; lp < lv; lp++) {
-            int i, j = 0;
+        for (lp = start; lp < end; lp++) {
+            int j = 0;
             // rescale with interleaving
             for (i = mh; i < lh; i += 2, j++)
                 l[i] = ((data[w * lp + j] * I_LFTG_K) + (1 << 15)) >> 16;
@@ -512,26 +684,18 @@ static void dwt_decode97_int(DWTContext *s, int32_t *t)
             for (i = 0; i < lh; i++)
                 data[w * lp + i] = l[i];
         }
-
+    } else {
+        int lv = s->linelen[lev][1],
+            mv = s->mod[lev][1];
+        int32_t *line = COL(linebuf, 5);
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
-            // rescale with interleaving
-            for (i = mv; i < lv; i += 2, j++)
-                l[i] = ((data[w * j + lp] * I_LFTG_K) + (1 << 15)) >> 16;
-            for (i = 1 - mv; i < lv; i += 2, j++)
-                l[i] = data[w * j + lp];
-
-            sr_1d97_int(line, mv, mv + lv);
-
-            for (i = 0; i < lv; i++)
-                data[w * i + lp] = l[i];
+        for (lp = start; lp < end; lp += DWT_COLS) {
+            if (end - lp >= DWT_COLS)
+                ver_sd97_int(line, data + lp, w, lv, mv, DWT_COLS);
+            else
+                ver_sd97_int(line, data + lp, w, lv, mv, end - lp);
         }
     }
-
-    for (i = 0; i < w * h; i++)
-        data[i] = (data[i] + ((1LL<<I_PRESHIFT)>>1)) >> I_PRESHIFT;
 }
 
 int ff_jpeg2000_dwt_init(DWTContext *s, int border[2][2],
@@ -556,19 +720,16 @@ int ff_jpeg2000_dwt_init(DWTContext *s, int border[2][2],
             for (j = 0; j < 2; j++)
                 b[i][j] = (b[i][j] + 1) >> 1;
         }
+    s->linebuf_size = (maxlen + 12) * DWT_COLS * sizeof(int32_t);
     switch (type) {
     case FF_DWT97:
-        s->f_linebuf = av_malloc_array((maxlen + 12), sizeof(*s->f_linebuf));
+        s->f_linebuf = av_malloc(s->linebuf_size);
         if (!s->f_linebuf)
             return AVERROR(ENOMEM);
         break;
-     case FF_DWT97_INT:
-        s->i_linebuf = av_malloc_array((maxlen + 12), sizeof(*s->i_linebuf));
-        if (!s->i_linebuf)
-            return AVERROR(ENOMEM);
-        break;
+    case FF_DWT97_INT:
     case FF_DWT53:
-        s->i_linebuf = av_malloc_array((maxlen +  6), sizeof(*s->i_linebuf));
+        s->i_linebuf = av_malloc(s->linebuf_size);
         if (!s->i_linebuf)
             return AVERROR(ENOMEM);
         break;
@@ -596,20 +757,54 @@ int ff_dwt_encode(DWTContext *s, void *t)
     return 0;
 }
 
-int ff_dwt_decode(DWTContext *s, void *t)
+int ff_dwt_decode_passes(DWTContext *s)
 {
     if (s->ndeclevels == 0)
         return 0;
 
+    return 2 * s->ndeclevels + 2 * (s->type == FF_DWT97_INT);
+}
+
+int ff_dwt_decode_slice(DWTContext *s, void *t, int pass,
+                        int jobnr, int nb_jobs, void *linebuf)
+{
+    int lev, vertical, n, start, end;
+
+    if (pass < 0 || pass >= ff_dwt_decode_passes(s))
+        return 0;
+
+    if (s->type == FF_DWT97_INT)
+        pass--;
+    lev      = pass >> 1;
+    vertical = pass & 1 && lev >= 0 && lev < s->ndeclevels;
+
+    /* the horizontal passes and the scaling are split by rows,
+     * the vertical passes by blocks of DWT_COLS columns */
+    if (vertical)
+        n = (s->linelen[lev][0] + DWT_COLS - 1) / DWT_COLS;
+    else if (lev >= 0 && lev < s->ndeclevels)
+        n = s->linelen[lev][1];
+    else
+        n = s->linelen[s->ndeclevels - 1][1];
+
+    start = (int64_t)n *  jobnr      / nb_jobs;
+    end   = (int64_t)n * (jobnr + 1) / nb_jobs;
+    if (vertical) {
+        start *= DWT_COLS;
+        end    = FFMIN(end * DWT_COLS, s->linelen[lev][0]);
+    }
+    if (start >= end)
+        return 0;
+
     switch (s->type) {
     case FF_DWT97:
-        dwt_decode97_float(s, t);
+        dwt_decode97_float(s, t, lev, vertical, start, end, linebuf);
         break;
     case FF_DWT97_INT:
-        dwt_decode97_int(s, t);
+        dwt_decode97_int(s, t, lev, vertical, start, end, linebuf);
         break;
     case FF_DWT53:
-        dwt_decode53(s, t);
+        dwt_decode53(s, t, lev, vertical, start, end, linebuf);
         break;
     default:
         return -1;
@@ -617,6 +812,17 @@ int ff_dwt_decode(DWTContext *s, void *t)
     return 0;
 }
 
+int ff_dwt_decode(DWTContext *s, void *t)
+{
+    void *linebuf = s->type == FF_DWT97 ? (void *)s->f_linebuf : (void *)s->i_linebuf;
+    int pass, ret;
+
+    for (pass = 0; pass < ff_dwt_decode_passes(s); pass++)
+        if ((ret = ff_dwt_decode_slice(s, t, pass, 0, 1, linebuf)) < 0)
+            return ret;
+    return 0;
+}
+
 void ff_dwt_destroy(DWTContext *s)
 {
     av_freep(&s->f_linebuf);
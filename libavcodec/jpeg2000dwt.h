@@ -48,6 +48,7 @@ typedef struct DWTContext {
     uint8_t type;                        ///< 0 for 9/7; 1 for 5/3
     int32_t *i_linebuf;                  ///< int buffer used by transform
     float   *f_linebuf;                  ///< float buffer used by transform
+    int linebuf_size;                    ///< size in bytes of the line buffer
 } DWTContext;
 
 /**
@@ -63,6 +64,20 @@ int ff_jpeg2000_dwt_init(DWTContext *s, int border[2][2],
 int ff_dwt_encode(DWTContext *s, void *t);
 int ff_dwt_decode(DWTContext *s, void *t);
 
+/**
+ * Number of passes of the inverse DWT. The passes must be run in order,
+ * but each of them can be split into slices that may run concurrently.
+ */
+int ff_dwt_decode_passes(DWTContext *s);
+
+/**
+ * Run slice jobnr of nb_jobs of one pass of the inverse DWT.
+ * @param linebuf           scratch buffer of s->linebuf_size bytes,
+ *                          which must not be shared with concurrent slices
+ */
+int ff_dwt_decode_slice(DWTContext *s, void *t, int pass,
+                        int jobnr, int nb_jobs, void *linebuf);
+
 void ff_dwt_destroy(DWTContext *s);
 
 #endif /* AVCODEC_JPEG2000DWT_H */
@@ -183,6 +183,9 @@ double ff_lpc_calc_ref_coefs_f(LPCContext *s, const float *samples, int len,
         s->windowed_samples[i] = weight*samples[i];
         s->windowed_samples[len-1-i] = weight*samples[len-1-i];
     }
+    /* the autocorrelation reads one sample past the end for even orders,
+     * don't let it pick up what a longer previous call left there */
+    s->windowed_samples[len] = 0.0;
 
     s->lpc_compute_autocorr(s->windowed_samples, len, order, autoc);
     signal = autoc[0];
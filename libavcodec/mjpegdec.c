@@ -1412,28 +1412,21 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
-static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
-                             int Al, const uint8_t *mb_bitmask,
-                             int mb_bitmask_size,
-                             const AVFrame *reference)
+/**
+ * Decode the MCUs mcu_start to mcu_end - 1 (in raster order) of a
+ * sequential or progressive DC scan, starting at the current position of s->gb.
+ */
+static int mjpeg_decode_scan_mcus(MJpegDecodeContext *s, int nb_components,
+                                  int Ah, int Al, GetBitContext *mb_bitmask_gb,
+                                  const AVFrame *reference,
+                                  int mcu_start, int mcu_end)
 {
-    int i, mb_x, mb_y, chroma_h_shift, chroma_v_shift, chroma_width, chroma_height;
+    int i, mcu, chroma_h_shift, chroma_v_shift, chroma_width, chroma_height;
     uint8_t *data[MAX_COMPONENTS];
     const uint8_t *reference_data[MAX_COMPONENTS];
     int linesize[MAX_COMPONENTS];
-    GetBitContext mb_bitmask_gb = {0}; // initialize to silence gcc warning
     int bytes_per_pixel = 1 + (s->bits > 8);
 
-    if (mb_bitmask) {
-        if (mb_bitmask_size != (s->mb_width * s->mb_height + 7)>>3) {
-            av_log(s->avctx, AV_LOG_ERROR, "mb_bitmask_size mismatches\n");
-            return AVERROR_INVALIDDATA;
-        }
-        init_get_bits(&mb_bitmask_gb, mb_bitmask, s->mb_width * s->mb_height);
-    }
-
-    s->restart_count = 0;
-
     av_pix_fmt_get_chroma_sub_sample(s->avctx->pix_fmt, &chroma_h_shift,
                                      &chroma_v_shift);
     chroma_width  = AV_CEIL_RSHIFT(s->width,  chroma_h_shift);
@@ -1444,95 +1437,238 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         data[c] = s->picture_ptr->data[c];
         reference_data[c] = reference ? reference->data[c] : NULL;
         linesize[c] = s->linesize[c];
-        s->coefs_finished[c] |= 1;
     }
 
-    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
-            const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
+    for (mcu = mcu_start; mcu < mcu_end; mcu++) {
+        const int mb_x    = mcu % s->mb_width;
+        const int mb_y    = mcu / s->mb_width;
+        const int copy_mb = mb_bitmask_gb && !get_bits1(mb_bitmask_gb);
 
-            if (s->restart_interval && !s->restart_count)
-                s->restart_count = s->restart_interval;
+        if (s->restart_interval && !s->restart_count)
+            s->restart_count = s->restart_interval;
 
-            if (get_bits_left(&s->gb) < 0) {
-                av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
-                       -get_bits_left(&s->gb));
-                return AVERROR_INVALIDDATA;
-            }
-            for (i = 0; i < nb_components; i++) {
-                uint8_t *ptr;
-                int n, h, v, x, y, c, j;
-                int block_offset;
-                n = s->nb_blocks[i];
-                c = s->comp_index[i];
-                h = s->h_scount[i];
-                v = s->v_scount[i];
-                x = 0;
-                y = 0;
-                for (j = 0; j < n; j++) {
-                    block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
-                                     (h * mb_x + x) * 8 * bytes_per_pixel) >> s->avctx->lowres);
-
-                    if (s->interlaced && s->bottom_field)
-                        block_offset += linesize[c] >> 1;
-                    if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? chroma_width  : s->width)
-                        && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? chroma_height : s->height)) {
-                        ptr = data[c] + block_offset;
-                    } else
-                        ptr = NULL;
-                    if (!s->progressive) {
-                        if (copy_mb) {
-                            if (ptr)
-                                mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
-                                                linesize[c], s->avctx->lowres);
+        if (get_bits_left(&s->gb) < 0) {
+            av_log(s->avctx, AV_LOG_ERROR, "overread %d\n",
+                   -get_bits_left(&s->gb));
+            return AVERROR_INVALIDDATA;
+        }
+        for (i = 0; i < nb_components; i++) {
+            uint8_t *ptr;
+            int n, h, v, x, y, c, j;
+            int block_offset;
+            n = s->nb_blocks[i];
+            c = s->comp_index[i];
+            h = s->h_scount[i];
+            v = s->v_scount[i];
+            x = 0;
+            y = 0;
+            for (j = 0; j < n; j++) {
+                block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
+                                 (h * mb_x + x) * 8 * bytes_per_pixel) >> s->avctx->lowres);
+
+                if (s->interlaced && s->bottom_field)
+                    block_offset += linesize[c] >> 1;
+                if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? chroma_width  : s->width)
+                    && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? chroma_height : s->height)) {
+                    ptr = data[c] + block_offset;
+                } else
+                    ptr = NULL;
+                if (!s->progressive) {
+                    if (copy_mb) {
+                        if (ptr)
+                            mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
+                                            linesize[c], s->avctx->lowres);
 
-                        } else {
-                            s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_sindex[i]]) < 0) {
-                                av_log(s->avctx, AV_LOG_ERROR,
-                                       "error y=%d x=%d\n", mb_y, mb_x);
-                                return AVERROR_INVALIDDATA;
-                            }
-                            if (ptr) {
-                                s->idsp.idct_put(ptr, linesize[c], s->block);
-                                if (s->bits & 7)
-                                    shift_output(s, ptr, linesize[c]);
-                            }
-                        }
                     } else {
-                        int block_idx  = s->block_stride[c] * (v * mb_y + y) +
-                                         (h * mb_x + x);
-                        int16_t *block = s->blocks[c][block_idx];
-                        if (Ah)
-                            block[0] += get_bits1(&s->gb) *
-                                        s->quant_matrixes[s->quant_sindex[i]][0] << Al;
-                        else if (decode_dc_progressive(s, block, i, s->dc_index[i],
-                                                       s->quant_matrixes[s->quant_sindex[i]],
-                                                       Al) < 0) {
+                        s->bdsp.clear_block(s->block);
+                        if (decode_block(s, s->block, i,
+                                         s->dc_index[i], s->ac_index[i],
+                                         s->quant_matrixes[s->quant_sindex[i]]) < 0) {
                             av_log(s->avctx, AV_LOG_ERROR,
                                    "error y=%d x=%d\n", mb_y, mb_x);
                             return AVERROR_INVALIDDATA;
                         }
+                        if (ptr) {
+                            s->idsp.idct_put(ptr, linesize[c], s->block);
+                            if (s->bits & 7)
+                                shift_output(s, ptr, linesize[c]);
+                        }
                     }
-                    ff_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
-                    ff_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
-                            mb_x, mb_y, x, y, c, s->bottom_field,
-                            (v * mb_y + y) * 8, (h * mb_x + x) * 8);
-                    if (++x == h) {
-                        x = 0;
-                        y++;
+                } else {
+                    int block_idx  = s->block_stride[c] * (v * mb_y + y) +
+                                     (h * mb_x + x);
+                    int16_t *block = s->blocks[c][block_idx];
+                    if (Ah)
+                        block[0] += get_bits1(&s->gb) *
+                                    s->quant_matrixes[s->quant_sindex[i]][0] << Al;
+                    else if (decode_dc_progressive(s, block, i, s->dc_index[i],
+                                                   s->quant_matrixes[s->quant_sindex[i]],
+                                                   Al) < 0) {
+                        av_log(s->avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
                     }
                 }
+                ff_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
+                ff_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
+                        mb_x, mb_y, x, y, c, s->bottom_field,
+                        (v * mb_y + y) * 8, (h * mb_x + x) * 8);
+                if (++x == h) {
+                    x = 0;
+                    y++;
+                }
             }
-
-            handle_rstn(s, nb_components);
         }
+
+        handle_rstn(s, nb_components);
     }
     return 0;
 }
 
+typedef struct MJpegScanSegments {
+    int nb_components, Ah, Al;
+    int scan_start;     ///< offset of the entropy-coded data in the SOS buffer
+    int scan_end;       ///< end of the SOS buffer
+    int first_rst;      ///< index of the marker ending the first restart interval
+    int nb_segments;
+} MJpegScanSegments;
+
+static int decode_scan_segment(AVCodecContext *avctx, void *arg,
+                               int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s0  = avctx->priv_data;
+    MJpegDecodeContext *s   = &s0->slice_ctx[threadnr];
+    const MJpegScanSegments *seg = arg;
+    int rst       = seg->first_rst + jobnr;
+    int start     = jobnr ? s0->rst_offsets[rst - 1] + 2 : seg->scan_start;
+    int end       = rst < s0->nb_rst ? s0->rst_offsets[rst] : seg->scan_end;
+    int mcu_start = jobnr * s->restart_interval;
+    int mcu_end   = FFMIN(mcu_start + s->restart_interval,
+                          s->mb_width * s->mb_height);
+    int i, ret;
+
+    if (end < start)
+        return AVERROR_INVALIDDATA;
+
+    ret = init_get_bits8(&s->gb, s0->buffer + start, end - start);
+    if (ret < 0)
+        return ret;
+
+    for (i = 0; i < seg->nb_components; i++)
+        s->last_dc[i] = (4 << s->bits);
+    s->restart_count = 0;
+
+    return mjpeg_decode_scan_mcus(s, seg->nb_components, seg->Ah, seg->Al,
+                                  NULL, NULL, mcu_start, mcu_end);
+}
+
+/**
+ * Decode a sequential scan by running its restart intervals in parallel.
+ * Every interval starts byte-aligned with reset DC predictors, so it can be
+ * decoded independently once the RSTn markers are located.
+ *
+ * @return 1 if the scan was decoded, 0 if it cannot be split, or a negative
+ *         error code
+ */
+static int mjpeg_decode_scan_threaded(MJpegDecodeContext *s, int nb_components,
+                                      int Ah, int Al)
+{
+    AVCodecContext *avctx = s->avctx;
+    MJpegScanSegments seg;
+    int i, ret, bits_start;
+
+    if (!(avctx->active_thread_type & FF_THREAD_SLICE) ||
+        avctx->thread_count <= 1 || s->progressive ||
+        avctx->codec_id == AV_CODEC_ID_THP || s->restart_interval <= 0 ||
+        s->gb.buffer != s->buffer)
+        return 0;
+
+    bits_start = get_bits_count(&s->gb);
+    if (bits_start & 7)
+        return 0;
+
+    seg.nb_components = nb_components;
+    seg.Ah            = Ah;
+    seg.Al            = Al;
+    seg.scan_start    = bits_start >> 3;
+    seg.scan_end      = s->gb.size_in_bits >> 3;
+    seg.nb_segments   = (s->mb_width * s->mb_height + s->restart_interval - 1) /
+                        s->restart_interval;
+
+    for (seg.first_rst = 0; seg.first_rst < s->nb_rst; seg.first_rst++)
+        if (s->rst_offsets[seg.first_rst] >= seg.scan_start)
+            break;
+
+    /* missing markers, leave the resynchronization to the serial decoder */
+    if (seg.nb_segments <= 1 || s->nb_rst - seg.first_rst < seg.nb_segments - 1)
+        return 0;
+
+    if (!s->slice_ctx) {
+        s->slice_ctx = av_malloc_array(avctx->thread_count, sizeof(*s->slice_ctx));
+        if (!s->slice_ctx)
+            return AVERROR(ENOMEM);
+    }
+    av_fast_malloc(&s->slice_rets, &s->slice_rets_size,
+                   seg.nb_segments * sizeof(*s->slice_rets));
+    if (!s->slice_rets)
+        return AVERROR(ENOMEM);
+
+    /* The copies only differ in the bit reader, the DC predictors, the
+     * restart counter and the block buffer. */
+    for (i = 0; i < avctx->thread_count; i++)
+        memcpy(&s->slice_ctx[i], s, sizeof(*s));
+
+    avctx->execute2(avctx, decode_scan_segment, &seg, s->slice_rets,
+                    seg.nb_segments);
+
+    /* leave the reader after the last interval, where the serial decoder
+     * would have stopped */
+    i = seg.first_rst + seg.nb_segments - 1;
+    skip_bits_long(&s->gb, ((i < s->nb_rst ? s->rst_offsets[i] : seg.scan_end) -
+                            seg.scan_start) * 8);
+
+    for (i = 0; i < seg.nb_segments; i++) {
+        if ((ret = s->slice_rets[i]) < 0) {
+            av_log(avctx, AV_LOG_ERROR, "error in restart interval %d\n", i);
+            return ret;
+        }
+    }
+
+    return 1;
+}
+
+static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
+                             int Al, const uint8_t *mb_bitmask,
+                             int mb_bitmask_size,
+                             const AVFrame *reference)
+{
+    GetBitContext mb_bitmask_gb = {0}; // initialize to silence gcc warning
+    int i, ret;
+
+    if (mb_bitmask) {
+        if (mb_bitmask_size != (s->mb_width * s->mb_height + 7)>>3) {
+            av_log(s->avctx, AV_LOG_ERROR, "mb_bitmask_size mismatches\n");
+            return AVERROR_INVALIDDATA;
+        }
+        init_get_bits(&mb_bitmask_gb, mb_bitmask, s->mb_width * s->mb_height);
+    }
+
+    s->restart_count = 0;
+
+    for (i = 0; i < nb_components; i++)
+        s->coefs_finished[s->comp_index[i]] |= 1;
+
+    if (!mb_bitmask && !reference) {
+        ret = mjpeg_decode_scan_threaded(s, nb_components, Ah, Al);
+        if (ret)
+            return FFMIN(ret, 0);
+    }
+
+    return mjpeg_decode_scan_mcus(s, nb_components, Ah, Al,
+                                  mb_bitmask ? &mb_bitmask_gb : NULL, reference,
+                                  0, s->mb_width * s->mb_height);
+}
+
 static int mjpeg_decode_scan_progressive_ac(MJpegDecodeContext *s, int ss,
                                             int se, int Ah, int Al)
 {
@@ -2204,11 +2340,14 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
     if (!s->buffer)
         return AVERROR(ENOMEM);
 
+    s->nb_rst = 0;
+
     /* unescape buffer of SOS, use special treatment for JPEG-LS */
     if (start_code == SOS && !s->ls) {
         const uint8_t *src = *buf_ptr;
         const uint8_t *ptr = src;
         uint8_t *dst = s->buffer;
+        int record_rst = !!(s->avctx->active_thread_type & FF_THREAD_SLICE);
 
         #define copy_data_segment(skip) do {       \
             ptrdiff_t length = (ptr - src) - (skip);  \
@@ -2247,6 +2386,19 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                         copy_data_segment(1);
                         if (x)
                             break;
+                    } else if (record_rst) {
+                        /* the marker is kept, its 0xFF is the last byte
+                         * written or the one before x still to be copied */
+                        int *offsets = av_fast_realloc(s->rst_offsets,
+                                                       &s->rst_offsets_size,
+                                                       (s->nb_rst + 1) * sizeof(*offsets));
+                        if (offsets) {
+                            s->rst_offsets = offsets;
+                            s->rst_offsets[s->nb_rst++] = (dst - s->buffer) + (ptr - src) - 2;
+                        } else {
+                            s->nb_rst   = 0;
+                            record_rst = 0;
+                        }
                     }
                 }
             }
@@ -2917,6 +3069,12 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
 
     av_freep(&s->hwaccel_picture_private);
 
+    av_freep(&s->rst_offsets);
+    s->rst_offsets_size = 0;
+    av_freep(&s->slice_ctx);
+    av_freep(&s->slice_rets);
+    s->slice_rets_size = 0;
+
     return 0;
 }
 
@@ -2955,7 +3113,7 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .receive_frame  = ff_mjpeg_receive_frame,
     .flush          = decode_flush,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .priv_class     = &mjpegdec_class,
     .profiles       = NULL_IF_CONFIG_SMALL(ff_mjpeg_profiles),
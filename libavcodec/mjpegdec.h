@@ -159,6 +159,14 @@ typedef struct MJpegDecodeContext {
     enum AVPixelFormat hwaccel_sw_pix_fmt;
     enum AVPixelFormat hwaccel_pix_fmt;
     void *hwaccel_picture_private;
+
+    // Slice threading over restart intervals.
+    int *rst_offsets;                       ///< offsets of the RSTn markers in the unescaped SOS buffer
+    unsigned int rst_offsets_size;
+    int nb_rst;
+    struct MJpegDecodeContext *slice_ctx;   ///< per-thread copies of the context used to decode restart intervals
+    int *slice_rets;
+    unsigned int slice_rets_size;
 } MJpegDecodeContext;
 
 int ff_mjpeg_build_vlc(VLC *vlc, const uint8_t *bits_table,
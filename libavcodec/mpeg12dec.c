@@ -73,6 +73,7 @@ typedef struct Mpeg1Context {
     int tmpgexs;
     int first_slice;
     int extradata_decoded;
+    int second_field_follows;   /* the second field is in the same packet */
 } Mpeg1Context;
 
 #define MB_TYPE_ZERO_MV   0x20000000
@@ -1080,17 +1081,51 @@ static int mpeg_decode_update_thread_context(AVCodecContext *avctx,
     MpegEncContext *s = &ctx->mpeg_enc_ctx, *s1 = &ctx_from->mpeg_enc_ctx;
     int err;
 
+    /* Nothing to take over before the source decoded a picture; the
+     * scratch buffers could not even be sized yet. */
     if (avctx == avctx_from               ||
         !ctx_from->mpeg_enc_ctx_allocated ||
-        !s1->context_initialized)
+        !s1->context_initialized          ||
+        !s1->linesize)
         return 0;
 
     err = ff_mpeg_update_thread_context(avctx, avctx_from);
     if (err)
         return err;
 
-    if (!ctx->mpeg_enc_ctx_allocated)
-        memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
+    // copy all the necessary fields explicitly
+    ctx->mpeg_enc_ctx_allocated = ctx_from->mpeg_enc_ctx_allocated;
+    ctx->pan_scan               = ctx_from->pan_scan;
+    ctx->save_aspect            = ctx_from->save_aspect;
+    ctx->save_width             = ctx_from->save_width;
+    ctx->save_height            = ctx_from->save_height;
+    ctx->save_progressive_seq   = ctx_from->save_progressive_seq;
+    ctx->rc_buffer_size         = ctx_from->rc_buffer_size;
+    ctx->frame_rate_ext         = ctx_from->frame_rate_ext;
+    ctx->sync                   = ctx_from->sync;
+    ctx->tmpgexs                = ctx_from->tmpgexs;
+    ctx->extradata_decoded      = ctx_from->extradata_decoded;
+
+    // sequence, GOP and quantiser matrix headers may be in any packet
+    s->aspect_ratio_info = s1->aspect_ratio_info;
+    s->frame_rate_index  = s1->frame_rate_index;
+    s->bit_rate          = s1->bit_rate;
+    s->closed_gop        = s1->closed_gop;
+    memcpy(s->intra_matrix,        s1->intra_matrix,        sizeof(s->intra_matrix));
+    memcpy(s->inter_matrix,        s1->inter_matrix,        sizeof(s->inter_matrix));
+    memcpy(s->chroma_intra_matrix, s1->chroma_intra_matrix, sizeof(s->chroma_intra_matrix));
+    memcpy(s->chroma_inter_matrix, s1->chroma_inter_matrix, sizeof(s->chroma_inter_matrix));
+
+    /* The source finished its setup on the first field of a pair whose
+     * second field it decodes itself; the next packet starts a new frame. */
+    if (s1->picture_structure != PICT_FRAME && ctx_from->second_field_follows)
+        s->first_field = 0;
+
+    /* The GOP timecode goes to the next output frame, which is the
+     * source's if it outputs one. */
+    if (s1->current_picture.f->pict_type == AV_PICTURE_TYPE_B ||
+        s1->low_delay || s1->last_picture_ptr)
+        s->timecode_frame_start = -1;
 
     if (!(s->pict_type == AV_PICTURE_TYPE_B || s->low_delay))
         s->picture_number++;
@@ -1657,7 +1692,10 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
             s1->has_afd = 0;
         }
 
-        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+        /* A second field in the next packet must be decoded in this
+         * context, so the setup then lasts until the end of the packet. */
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+            (s->picture_structure == PICT_FRAME || s1->second_field_follows))
             ff_thread_finish_setup(avctx);
     } else { // second field
         int i;
@@ -2462,6 +2500,21 @@ FF_ENABLE_DEPRECATION_WARNINGS
     }
 }
 
+/**
+ * Check whether another picture starts between buf and buf_end.
+ */
+static int find_picture_start(const uint8_t *buf, const uint8_t *buf_end)
+{
+    uint32_t start_code = -1;
+
+    while (buf < buf_end) {
+        buf = avpriv_find_start_code(buf, buf_end, &start_code);
+        if (start_code == PICTURE_START_CODE)
+            return 1;
+    }
+    return 0;
+}
+
 static int decode_chunks(AVCodecContext *avctx, AVFrame *picture,
                          int *got_output, const uint8_t *buf, int buf_size)
 {
@@ -2734,6 +2787,10 @@ static int decode_chunks(AVCodecContext *avctx, AVFrame *picture,
                 if (s->first_slice) {
                     skip_frame     = 0;
                     s->first_slice = 0;
+                    if (s2->picture_structure == PICT_FRAME)
+                        s->second_field_follows = 0;
+                    else if (s2->first_field)
+                        s->second_field_follows = find_picture_start(buf_ptr, buf_end);
                     if ((ret = mpeg_field_start(s2, buf, buf_size)) < 0)
                         return ret;
                 }
@@ -2896,9 +2953,10 @@ AVCodec ff_mpeg1video_decoder = {
     .decode                = mpeg_decode_frame,
     .capabilities          = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 |
                              AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY |
-                             AV_CODEC_CAP_SLICE_THREADS,
+                             AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal         = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_INIT_CLEANUP |
-                             FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+                             FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS,
     .flush                 = flush,
     .max_lowres            = 3,
     .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context),
@@ -2930,12 +2988,14 @@ AVCodec ff_mpeg2video_decoder = {
     .decode         = mpeg_decode_frame,
     .capabilities   = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 |
                       AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_SLICE_THREADS,
+                      AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_INIT_CLEANUP |
-                      FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+                      FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                      FF_CODEC_CAP_ALLOCATE_PROGRESS,
     .flush          = flush,
     .max_lowres     = 3,
     .profiles       = NULL_IF_CONFIG_SMALL(ff_mpeg2_video_profiles),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context),
     .hw_configs     = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_MPEG2_DXVA2_HWACCEL
                         HWACCEL_DXVA2(mpeg2),
@@ -1844,7 +1844,7 @@ static inline void MPV_motion_lowres(MpegEncContext *s,
 static int lowest_referenced_row(MpegEncContext *s, int dir)
 {
     int my_max = INT_MIN, my_min = INT_MAX, qpel_shift = !s->quarter_sample;
-    int my, off, i, mvs;
+    int my, off, i, mvs, field = 0;
 
     if (s->picture_structure != PICT_FRAME || s->mcsel)
         goto unhandled;
@@ -1859,6 +1859,14 @@ static int lowest_referenced_row(MpegEncContext *s, int dir)
         case MV_TYPE_8X8:
             mvs = 4;
             break;
+        case MV_TYPE_FIELD:
+            mvs   = 2;
+            field = 1;
+            break;
+        case MV_TYPE_DMV:
+            mvs   = 4;
+            field = 1;
+            break;
         default:
             goto unhandled;
     }
@@ -1869,7 +1877,9 @@ static int lowest_referenced_row(MpegEncContext *s, int dir)
         my_min = FFMIN(my_min, my);
     }
 
-    off = ((FFMAX(-my_min, my_max)<<qpel_shift) + 63) >> 6;
+    /* Field vectors are in field lines: they move twice as far in the frame,
+     * and the bottom field and the interpolation add up to 2 more lines. */
+    off = ((FFMAX(-my_min, my_max) << (qpel_shift + field)) + 8 * field + 63) >> 6;
 
     return av_clip(s->mb_y + off, 0, s->mb_height - 1);
 unhandled:
@@ -2034,7 +2044,9 @@ void mpv_reconstruct_mb_internal(MpegEncContext *s, int16_t block[12][64],
             if(!s->encoding){
 
                 if(HAVE_THREADS && s->avctx->active_thread_type&FF_THREAD_FRAME) {
-                    if (s->mv_dir & MV_DIR_FORWARD) {
+                    /* The second field of an I frame may be predicted
+                     * from the first field alone. */
+                    if (s->mv_dir & MV_DIR_FORWARD && s->last_picture_ptr) {
                         ff_thread_await_progress(&s->last_picture_ptr->tf,
                                                  lowest_referenced_row(s, 0),
                                                  0);
@@ -2349,6 +2361,13 @@ void ff_set_qscale(MpegEncContext * s, int qscale)
 
 void ff_mpv_report_decode_progress(MpegEncContext *s)
 {
-    if (s->pict_type != AV_PICTURE_TYPE_B && !s->partitioned_frame && !s->er.error_occurred)
+    if (s->pict_type == AV_PICTURE_TYPE_B || s->partitioned_frame || s->er.error_occurred)
+        return;
+
+    if (s->picture_structure == PICT_FRAME)
         ff_thread_report_progress(&s->current_picture_ptr->tf, s->mb_y, 0);
+    /* In field pictures mb_y counts frame rows, and a row of the second
+     * field completes the pair of frame rows it covers. */
+    else if (!s->first_field)
+        ff_thread_report_progress(&s->current_picture_ptr->tf, s->mb_y | 1, 0);
 }
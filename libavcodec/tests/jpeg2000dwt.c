@@ -26,6 +26,33 @@
 
 #define MAX_W 256
 
+static int coefs[MAX_W * MAX_W];
+
+/* Decode the coefficients again, split into slices run in reverse order,
+ * which must give the same result as ff_dwt_decode(). */
+static int test_slices(DWTContext *s, const void *array, void *sliced, int nb_jobs)
+{
+    uint8_t *linebufs = av_malloc_array(nb_jobs, s->linebuf_size);
+    int pass, job, ret = 0;
+
+    if (!linebufs)
+        return 1;
+    for (pass = 0; pass < ff_dwt_decode_passes(s) && !ret; pass++)
+        for (job = nb_jobs - 1; job >= 0 && !ret; job--)
+            ret = ff_dwt_decode_slice(s, sliced, pass, job, nb_jobs,
+                                      linebufs + job * s->linebuf_size);
+    av_free(linebufs);
+    if (ret < 0) {
+        fprintf(stderr, "ff_dwt_decode_slice failed\n");
+        return 1;
+    }
+    if (memcmp(array, sliced, sizeof(coefs))) {
+        fprintf(stderr, "sliced decode mismatch with %d slices\n", nb_jobs);
+        return 2;
+    }
+    return 0;
+}
+
 static int test_dwt(int *array, int *ref, int border[2][2], int decomp_levels, int type, int max_diff) {
     int ret, j;
     DWTContext s1={{{0}}}, *s= &s1;
@@ -41,11 +68,15 @@ static int test_dwt(int *array, int *ref, int border[2][2], int decomp_levels, i
         fprintf(stderr, "ff_dwt_encode failed\n");
         return 1;
     }
+    memcpy(coefs, array, sizeof(coefs));
     ret = ff_dwt_decode(s, array);
     if (ret < 0) {
         fprintf(stderr, "ff_dwt_encode failed\n");
         return 1;
     }
+    ret = test_slices(s, array, coefs, 1 + (border[0][0] + border[1][1]) % 7);
+    if (ret)
+        return ret;
     for (j = 0; j<MAX_W * MAX_W; j++) {
         if (FFABS(array[j] - ref[j]) > max_diff) {
             fprintf(stderr, "missmatch at %d (%d != %d) decomp:%d border %d %d %d %d\n",
@@ -80,11 +111,15 @@ static int test_dwtf(float *array, float *ref, int border[2][2], int decomp_leve
         fprintf(stderr, "ff_dwt_encode failed\n");
         return 1;
     }
+    memcpy(coefs, array, sizeof(coefs));
     ret = ff_dwt_decode(s, array);
     if (ret < 0) {
         fprintf(stderr, "ff_dwt_encode failed\n");
         return 1;
     }
+    ret = test_slices(s, array, coefs, 1 + (border[0][0] + border[1][1]) % 7);
+    if (ret)
+        return ret;
     for (j = 0; j<MAX_W * MAX_W; j++) {
         if (FFABS(array[j] - ref[j]) > max_diff) {
             fprintf(stderr, "missmatch at %d (%f != %f) decomp:%d border %d %d %d %d\n",
@@ -32,6 +32,9 @@
 
 #include <stdatomic.h>
 
+#include "libavutil/hwcontext.h"
+#include "libavutil/hwcontext_drm.h"
+
 #include "v4l2-common.h"
 #include <dirent.h>
 
@@ -67,11 +70,24 @@ static const int desired_video_buffers = 256;
  */
 #define V4L_TS_CONVERT_READY V4L_TS_DEFAULT
 
+/**
+ * Formats which can be exported as DMA-BUFs. V4L2 and DRM use the same
+ * fourcc for all of them.
+ */
+static const uint32_t dmabuf_formats[] = {
+    V4L2_PIX_FMT_YUV420,
+    V4L2_PIX_FMT_YVU420,
+    V4L2_PIX_FMT_YUYV,
+    V4L2_PIX_FMT_UYVY,
+    V4L2_PIX_FMT_NV12,
+};
+
 struct video_data {
     AVClass *class;
     int fd;
     int pixelformat; /* V4L2_PIX_FMT_* */
     int width, height;
+    int bytesperline;
     int frame_size;
     int interlaced;
     int top_field_first;
@@ -83,6 +99,7 @@ struct video_data {
     atomic_int buffers_queued;
     void **buf_start;
     unsigned int *buf_len;
+    int *buf_fd;        /**< DMA-BUF fds, only when exporting */
     char *standard;
     v4l2_std_id std_id;
     int channel;
@@ -90,6 +107,15 @@ struct video_data {
     int list_format;    /**< Set by a private option. */
     int list_standard;  /**< Set by a private option. */
     char *framerate;    /**< Set by a private option. */
+    int max_buffers;    /**< Set by a private option. */
+    int export_dmabuf;  /**< Set by a private option. */
+
+    /* DRM PRIME output */
+    AVBufferRef *hw_device_ref;
+    AVBufferRef *hw_frames_ref;
+    int drm_nb_planes;
+    ptrdiff_t drm_offset[AV_DRM_MAX_PLANES];
+    ptrdiff_t drm_pitch[AV_DRM_MAX_PLANES];
 
     int use_libv4l2;
     int (*open_f)(const char *file, int oflag, ...);
@@ -108,6 +134,7 @@ struct video_data {
 struct buff_data {
     struct video_data *s;
     int index;
+    AVDRMFrameDescriptor desc;  /**< only used when exporting DMA-BUFs */
 };
 
 static int device_open(AVFormatContext *ctx, const char* device_path)
@@ -213,6 +240,7 @@ static int device_init(AVFormatContext *ctx, int *width, int *height,
         *width = fmt.fmt.pix.width;
         *height = fmt.fmt.pix.height;
     }
+    s->bytesperline = fmt.fmt.pix.bytesperline;
 
     if (pixelformat != fmt.fmt.pix.pixelformat) {
         av_log(ctx, AV_LOG_DEBUG,
@@ -334,6 +362,88 @@ static void list_standards(AVFormatContext *ctx)
     }
 }
 
+static int mmap_alloc_arrays(struct video_data *s, int nb_buffers)
+{
+    void **buf_start;
+    unsigned int *buf_len;
+    int *buf_fd;
+
+    buf_start = av_realloc_array(s->buf_start, nb_buffers, sizeof(*buf_start));
+    if (!buf_start)
+        return AVERROR(ENOMEM);
+    s->buf_start = buf_start;
+
+    buf_len = av_realloc_array(s->buf_len, nb_buffers, sizeof(*buf_len));
+    if (!buf_len)
+        return AVERROR(ENOMEM);
+    s->buf_len = buf_len;
+
+    buf_fd = av_realloc_array(s->buf_fd, nb_buffers, sizeof(*buf_fd));
+    if (!buf_fd)
+        return AVERROR(ENOMEM);
+    s->buf_fd = buf_fd;
+
+    return 0;
+}
+
+static int mmap_buffer(AVFormatContext *ctx, int index)
+{
+    struct video_data *s = ctx->priv_data;
+    struct v4l2_buffer buf = {
+        .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .index  = index,
+        .memory = V4L2_MEMORY_MMAP
+    };
+    int res;
+
+    s->buf_fd[index] = -1;
+
+    if (v4l2_ioctl(s->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+        res = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_QUERYBUF): %s\n", av_err2str(res));
+        return res;
+    }
+
+    s->buf_len[index] = buf.length;
+    if (s->frame_size > 0 && s->buf_len[index] < s->frame_size) {
+        av_log(ctx, AV_LOG_ERROR,
+               "buf_len[%d] = %d < expected frame size %d\n",
+               index, s->buf_len[index], s->frame_size);
+        return AVERROR(ENOMEM);
+    }
+    s->buf_start[index] = v4l2_mmap(NULL, buf.length,
+                                    PROT_READ | PROT_WRITE, MAP_SHARED,
+                                    s->fd, buf.m.offset);
+
+    if (s->buf_start[index] == MAP_FAILED) {
+        res = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "mmap: %s\n", av_err2str(res));
+        return res;
+    }
+
+    if (s->export_dmabuf) {
+        struct v4l2_exportbuffer expbuf = {
+            .type  = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+            .index = index,
+            .flags = O_RDONLY,
+        };
+
+#ifdef O_CLOEXEC
+        expbuf.flags |= O_CLOEXEC;
+#endif
+
+        if (v4l2_ioctl(s->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+            res = AVERROR(errno);
+            av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_EXPBUF): %s\n", av_err2str(res));
+            v4l2_munmap(s->buf_start[index], s->buf_len[index]);
+            return res;
+        }
+        s->buf_fd[index] = expbuf.fd;
+    }
+
+    return 0;
+}
+
 static int mmap_init(AVFormatContext *ctx)
 {
     int i, res;
@@ -354,47 +464,15 @@ static int mmap_init(AVFormatContext *ctx)
         av_log(ctx, AV_LOG_ERROR, "Insufficient buffer memory\n");
         return AVERROR(ENOMEM);
     }
-    s->buffers = req.count;
-    s->buf_start = av_malloc_array(s->buffers, sizeof(void *));
-    if (!s->buf_start) {
+    if ((res = mmap_alloc_arrays(s, req.count)) < 0) {
         av_log(ctx, AV_LOG_ERROR, "Cannot allocate buffer pointers\n");
-        return AVERROR(ENOMEM);
-    }
-    s->buf_len = av_malloc_array(s->buffers, sizeof(unsigned int));
-    if (!s->buf_len) {
-        av_log(ctx, AV_LOG_ERROR, "Cannot allocate buffer sizes\n");
-        av_freep(&s->buf_start);
-        return AVERROR(ENOMEM);
+        return res;
     }
 
     for (i = 0; i < req.count; i++) {
-        struct v4l2_buffer buf = {
-            .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-            .index  = i,
-            .memory = V4L2_MEMORY_MMAP
-        };
-        if (v4l2_ioctl(s->fd, VIDIOC_QUERYBUF, &buf) < 0) {
-            res = AVERROR(errno);
-            av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_QUERYBUF): %s\n", av_err2str(res));
-            return res;
-        }
-
-        s->buf_len[i] = buf.length;
-        if (s->frame_size > 0 && s->buf_len[i] < s->frame_size) {
-            av_log(ctx, AV_LOG_ERROR,
-                   "buf_len[%d] = %d < expected frame size %d\n",
-                   i, s->buf_len[i], s->frame_size);
-            return AVERROR(ENOMEM);
-        }
-        s->buf_start[i] = v4l2_mmap(NULL, buf.length,
-                               PROT_READ | PROT_WRITE, MAP_SHARED,
-                               s->fd, buf.m.offset);
-
-        if (s->buf_start[i] == MAP_FAILED) {
-            res = AVERROR(errno);
-            av_log(ctx, AV_LOG_ERROR, "mmap: %s\n", av_err2str(res));
+        if ((res = mmap_buffer(ctx, i)) < 0)
             return res;
-        }
+        s->buffers = i + 1;
     }
 
     return 0;
@@ -414,6 +492,59 @@ static int enqueue_buffer(struct video_data *s, struct v4l2_buffer *buf)
     return res;
 }
 
+/**
+ * Add buffers to the capture ring while streaming, so that a caller holding
+ * on to packets does not force us to copy or drop frames.
+ */
+static int mmap_grow(AVFormatContext *ctx)
+{
+    struct video_data *s = ctx->priv_data;
+    struct v4l2_create_buffers create = {
+        .count  = FFMIN(FFMAX(s->buffers / 4, 1), s->max_buffers - s->buffers),
+        .memory = V4L2_MEMORY_MMAP,
+        .format = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE },
+    };
+    int i, nb_buffers, res;
+
+    if (v4l2_ioctl(s->fd, VIDIOC_G_FMT, &create.format) < 0 ||
+        v4l2_ioctl(s->fd, VIDIOC_CREATE_BUFS, &create) < 0) {
+        res = AVERROR(errno);
+        av_log(ctx, AV_LOG_WARNING, "Cannot add capture buffers: %s\n",
+               av_err2str(res));
+        goto fail;
+    }
+    if (!create.count || create.index != s->buffers) {
+        res = AVERROR(ENOBUFS);
+        goto fail;
+    }
+
+    nb_buffers = s->buffers + create.count;
+    if ((res = mmap_alloc_arrays(s, nb_buffers)) < 0)
+        goto fail;
+
+    for (i = s->buffers; i < nb_buffers; i++) {
+        struct v4l2_buffer buf = {
+            .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+            .index  = i,
+            .memory = V4L2_MEMORY_MMAP
+        };
+
+        if ((res = mmap_buffer(ctx, i)) < 0)
+            goto fail;
+        s->buffers = i + 1;
+        if ((res = enqueue_buffer(s, &buf)) < 0)
+            goto fail;
+    }
+
+    av_log(ctx, AV_LOG_VERBOSE, "Capture ring grown to %d buffers\n", s->buffers);
+    return 0;
+
+fail:
+    /* do not retry on every frame */
+    s->max_buffers = s->buffers;
+    return res;
+}
+
 static void mmap_release_buffer(void *opaque, uint8_t *data)
 {
     struct v4l2_buffer buf = { 0 };
@@ -489,6 +620,81 @@ static int convert_timestamp(AVFormatContext *ctx, int64_t *ts)
     return 0;
 }
 
+static void dmabuf_free_frame(void *opaque, uint8_t *data)
+{
+    AVFrame *frame = (AVFrame *)data;
+
+    av_frame_free(&frame);
+}
+
+/**
+ * Wrap the dequeued buffer in a DRM PRIME frame. The buffer is requeued
+ * once the last reference to the frame is gone. buf_descriptor is owned
+ * by the frame on success and freed on failure, in which case the caller
+ * still has to requeue the buffer.
+ */
+static int dmabuf_wrap_frame(AVFormatContext *ctx, AVPacket *pkt,
+                             struct buff_data *buf_descriptor)
+{
+    struct video_data *s = ctx->priv_data;
+    AVDRMFrameDescriptor *desc = &buf_descriptor->desc;
+    AVDRMLayerDescriptor *layer = &desc->layers[0];
+    AVFrame *frame;
+    int i;
+
+    memset(desc, 0, sizeof(*desc));
+    desc->nb_objects                 = 1;
+    desc->objects[0].fd              = s->buf_fd[buf_descriptor->index];
+    desc->objects[0].size            = s->buf_len[buf_descriptor->index];
+    desc->objects[0].format_modifier = 0; /* DRM_FORMAT_MOD_LINEAR */
+    desc->nb_layers                  = 1;
+    layer->format                    = s->pixelformat;
+    layer->nb_planes                 = s->drm_nb_planes;
+    for (i = 0; i < s->drm_nb_planes; i++) {
+        layer->planes[i].object_index = 0;
+        layer->planes[i].offset       = s->drm_offset[i];
+        layer->planes[i].pitch        = s->drm_pitch[i];
+    }
+
+    frame = av_frame_alloc();
+    if (!frame)
+        goto fail;
+
+    frame->hw_frames_ctx = av_buffer_ref(s->hw_frames_ref);
+    if (!frame->hw_frames_ctx)
+        goto fail;
+
+    pkt->buf = av_buffer_create((uint8_t *)frame, sizeof(*frame),
+                                dmabuf_free_frame, NULL, 0);
+    if (!pkt->buf)
+        goto fail;
+
+    /* from here on the frame is owned by the packet */
+    frame->buf[0] = av_buffer_create((uint8_t *)desc, sizeof(*desc),
+                                     mmap_release_buffer, buf_descriptor, 0);
+    if (!frame->buf[0]) {
+        av_buffer_unref(&pkt->buf);
+        av_free(buf_descriptor);
+        return AVERROR(ENOMEM);
+    }
+
+    frame->data[0] = (uint8_t *)desc;
+    frame->format  = AV_PIX_FMT_DRM_PRIME;
+    frame->width   = s->width;
+    frame->height  = s->height;
+
+    pkt->data   = (uint8_t *)frame;
+    pkt->size   = sizeof(*frame);
+    pkt->flags |= AV_PKT_FLAG_TRUSTED;
+
+    return 0;
+
+fail:
+    av_frame_free(&frame);
+    av_free(buf_descriptor);
+    return AVERROR(ENOMEM);
+}
+
 static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
 {
     struct video_data *s = ctx->priv_data;
@@ -546,7 +752,19 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
     }
 
     /* Image is at s->buff_start[buf.index] */
-    if (atomic_load(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+    if (atomic_load(&s->buffers_queued) <= FFMAX(s->buffers / 8, 1) &&
+        s->buffers < s->max_buffers)
+        mmap_grow(ctx);
+
+    if (atomic_load(&s->buffers_queued) <= FFMAX(s->buffers / 8, 1)) {
+        if (s->export_dmabuf) {
+            /* a DMA-BUF cannot be copied into a packet, drop the frame instead */
+            av_log(ctx, AV_LOG_WARNING, "Only %d capture buffers left queued, "
+                   "dropping a frame\n", atomic_load(&s->buffers_queued));
+            res = enqueue_buffer(s, &buf);
+            return res < 0 ? res : AVERROR(EAGAIN);
+        }
+
         /* when we start getting low on queued buffers, fall back on copying data */
         res = av_new_packet(pkt, buf.bytesused);
         if (res < 0) {
@@ -580,13 +798,21 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
         buf_descriptor->index = buf.index;
         buf_descriptor->s     = s;
 
-        pkt->buf = av_buffer_create(pkt->data, pkt->size, mmap_release_buffer,
-                                    buf_descriptor, 0);
-        if (!pkt->buf) {
-            av_log(ctx, AV_LOG_ERROR, "Failed to create a buffer\n");
-            enqueue_buffer(s, &buf);
-            av_freep(&buf_descriptor);
-            return AVERROR(ENOMEM);
+        if (s->export_dmabuf) {
+            res = dmabuf_wrap_frame(ctx, pkt, buf_descriptor);
+            if (res < 0) {
+                enqueue_buffer(s, &buf);
+                return res;
+            }
+        } else {
+            pkt->buf = av_buffer_create(pkt->data, pkt->size, mmap_release_buffer,
+                                        buf_descriptor, 0);
+            if (!pkt->buf) {
+                av_log(ctx, AV_LOG_ERROR, "Failed to create a buffer\n");
+                enqueue_buffer(s, &buf);
+                av_freep(&buf_descriptor);
+                return AVERROR(ENOMEM);
+            }
         }
     }
     pkt->pts = buf_ts.tv_sec * INT64_C(1000000) + buf_ts.tv_usec;
@@ -640,9 +866,12 @@ static void mmap_close(struct video_data *s)
     v4l2_ioctl(s->fd, VIDIOC_STREAMOFF, &type);
     for (i = 0; i < s->buffers; i++) {
         v4l2_munmap(s->buf_start[i], s->buf_len[i]);
+        if (s->buf_fd[i] >= 0)
+            close(s->buf_fd[i]);
     }
     av_freep(&s->buf_start);
     av_freep(&s->buf_len);
+    av_freep(&s->buf_fd);
 }
 
 static int v4l2_set_parameters(AVFormatContext *ctx)
@@ -816,6 +1045,75 @@ static int device_try_init(AVFormatContext *ctx,
     return ret;
 }
 
+static int dmabuf_init(AVFormatContext *ctx, enum AVPixelFormat pix_fmt)
+{
+    struct video_data *s = ctx->priv_data;
+    AVHWFramesContext *frames;
+    AVDRMDeviceContext *hwctx;
+    ptrdiff_t linesizes[4];
+    size_t sizes[4];
+    int tight[4];
+    int i, res;
+
+    if (s->use_libv4l2) {
+        av_log(ctx, AV_LOG_ERROR, "DMA-BUF export cannot be used with libv4l2.\n");
+        return AVERROR(EINVAL);
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(dmabuf_formats); i++)
+        if (dmabuf_formats[i] == s->pixelformat)
+            break;
+    if (i == FF_ARRAY_ELEMS(dmabuf_formats) || pix_fmt == AV_PIX_FMT_NONE) {
+        av_log(ctx, AV_LOG_ERROR, "The capture format cannot be exported "
+               "as a DMA-BUF.\n");
+        return AVERROR(ENOSYS);
+    }
+
+    /* V4L2 pads the chroma planes in proportion to the luma one */
+    if ((res = av_image_fill_linesizes(tight, pix_fmt, s->width)) < 0)
+        return res;
+    for (i = 0; i < 4; i++)
+        linesizes[i] = s->bytesperline > 0 ?
+                       (int64_t)tight[i] * s->bytesperline / tight[0] : tight[i];
+    if ((res = av_image_fill_plane_sizes(sizes, pix_fmt, s->height, linesizes)) < 0)
+        return res;
+
+    s->drm_nb_planes = av_pix_fmt_count_planes(pix_fmt);
+    for (i = 0; i < s->drm_nb_planes; i++) {
+        s->drm_pitch[i]  = linesizes[i];
+        s->drm_offset[i] = i ? s->drm_offset[i - 1] + sizes[i - 1] : 0;
+    }
+
+    /* DMA-BUFs do not need an open DRM device, only the frames context */
+    s->hw_device_ref = av_hwdevice_ctx_alloc(AV_HWDEVICE_TYPE_DRM);
+    if (!s->hw_device_ref) {
+        av_log(ctx, AV_LOG_ERROR, "Cannot create a DRM device context, "
+               "libavutil may have been built without libdrm.\n");
+        return AVERROR(ENOSYS);
+    }
+    hwctx = ((AVHWDeviceContext *)s->hw_device_ref->data)->hwctx;
+    hwctx->fd = -1;
+    if ((res = av_hwdevice_ctx_init(s->hw_device_ref)) < 0)
+        return res;
+
+    s->hw_frames_ref = av_hwframe_ctx_alloc(s->hw_device_ref);
+    if (!s->hw_frames_ref)
+        return AVERROR(ENOMEM);
+    frames = (AVHWFramesContext *)s->hw_frames_ref->data;
+    frames->format    = AV_PIX_FMT_DRM_PRIME;
+    frames->sw_format = pix_fmt;
+    frames->width     = s->width;
+    frames->height    = s->height;
+
+    if ((res = av_hwframe_ctx_init(s->hw_frames_ref)) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to initialise the hardware frames "
+               "context: %s\n", av_err2str(res));
+        return res;
+    }
+
+    return 0;
+}
+
 static int v4l2_read_probe(const AVProbeData *p)
 {
     if (av_strstart(p->filename, "/dev/video", NULL))
@@ -949,6 +1247,10 @@ static int v4l2_read_header(AVFormatContext *ctx)
         s->frame_size = av_image_get_buffer_size(st->codecpar->format,
                                                  s->width, s->height, 1);
 
+    if (s->export_dmabuf &&
+        (res = dmabuf_init(ctx, st->codecpar->format)) < 0)
+        goto fail;
+
     if ((res = mmap_init(ctx)) ||
         (res = mmap_start(ctx)) < 0)
             goto fail;
@@ -972,9 +1274,17 @@ static int v4l2_read_header(AVFormatContext *ctx)
     if (st->avg_frame_rate.den)
         st->codecpar->bit_rate = s->frame_size * av_q2d(st->avg_frame_rate) * 8;
 
+    if (s->export_dmabuf) {
+        st->codecpar->codec_id  = AV_CODEC_ID_WRAPPED_AVFRAME;
+        st->codecpar->codec_tag = 0;
+        st->codecpar->format    = AV_PIX_FMT_DRM_PRIME;
+    }
+
     return 0;
 
 fail:
+    av_buffer_unref(&s->hw_frames_ref);
+    av_buffer_unref(&s->hw_device_ref);
     v4l2_close(s->fd);
     return res;
 }
@@ -1015,6 +1325,9 @@ static int v4l2_read_close(AVFormatContext *ctx)
 
     mmap_close(s);
 
+    av_buffer_unref(&s->hw_frames_ref);
+    av_buffer_unref(&s->hw_device_ref);
+
     v4l2_close(s->fd);
     return 0;
 }
@@ -1121,6 +1434,8 @@ static const AVOption options[] = {
     { "abs",          "use absolute timestamps (wall clock)",                     OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_ABS      }, 0, 2, DEC, "timestamps" },
     { "mono2abs",     "force conversion from monotonic to absolute timestamps",   OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_MONO2ABS }, 0, 2, DEC, "timestamps" },
     { "use_libv4l2",  "use libv4l2 (v4l-utils) conversion functions",             OFFSET(use_libv4l2),  AV_OPT_TYPE_BOOL,   {.i64 = 0}, 0, 1, DEC },
+    { "max_buffers",  "grow the capture ring up to this many buffers instead of copying frames", OFFSET(max_buffers), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, DEC },
+    { "export_dmabuf", "output DRM PRIME frames referencing the capture buffers", OFFSET(export_dmabuf), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC },
     { NULL },
 };
 
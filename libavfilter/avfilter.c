@@ -190,9 +190,27 @@ int avfilter_link_get_channels(AVFilterLink *link)
 }
 #endif
 
+/**
+ * While filters are activated concurrently, guard the state that two
+ * filters sharing a neighbour can both modify.
+ */
+static void graph_state_lock(AVFilterGraph *graph)
+{
+    if (graph && graph->internal->sched_running)
+        ff_mutex_lock(&graph->internal->state_lock);
+}
+
+static void graph_state_unlock(AVFilterGraph *graph)
+{
+    if (graph && graph->internal->sched_running)
+        ff_mutex_unlock(&graph->internal->state_lock);
+}
+
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
+    graph_state_lock(filter->graph);
     filter->ready = FFMAX(filter->ready, priority);
+    graph_state_unlock(filter->graph);
 }
 
 /**
@@ -203,8 +221,10 @@ static void filter_unblock(AVFilterContext *filter)
 {
     unsigned i;
 
+    graph_state_lock(filter->graph);
     for (i = 0; i < filter->nb_outputs; i++)
         filter->outputs[i]->frame_blocked_in = 0;
+    graph_state_unlock(filter->graph);
 }
 
 
@@ -528,13 +548,18 @@ static int set_enable_expr(AVFilterContext *ctx, const char *expr)
 
 void ff_update_link_current_pts(AVFilterLink *link, int64_t pts)
 {
+    AVFilterGraph *graph = link->age_index >= 0 ? link->graph : NULL;
+
     if (pts == AV_NOPTS_VALUE)
         return;
+    /* the sink links heap compares the pts of all sink links */
+    graph_state_lock(graph);
     link->current_pts = pts;
     link->current_pts_us = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
     /* TODO use duration */
-    if (link->graph && link->age_index >= 0)
-        ff_avfilter_graph_update_heap(link->graph, link);
+    if (graph)
+        ff_avfilter_graph_update_heap(graph, link);
+    graph_state_unlock(graph);
 }
 
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags)
@@ -1628,7 +1653,9 @@ void ff_inlink_set_status(AVFilterLink *link, int status)
     if (link->status_out)
         return;
     link->frame_wanted_out = 0;
+    graph_state_lock(link->graph);
     link->frame_blocked_in = 0;
+    graph_state_unlock(link->graph);
     ff_avfilter_link_set_out_status(link, status, AV_NOPTS_VALUE);
     while (ff_framequeue_queued_frames(&link->fifo)) {
            AVFrame *frame = ff_framequeue_take(&link->fifo);
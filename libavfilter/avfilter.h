@@ -917,6 +917,16 @@ typedef struct AVFilterGraph {
     int sink_links_count;
 
     unsigned disable_auto_convert;
+
+    /**
+     * Maximum number of filters of this graph activated concurrently.
+     * Filters that are ready and not linked to each other are run on a pool
+     * of this many threads. 0 picks a number automatically, 1 (the default)
+     * activates one filter at a time on the calling thread.
+     * A custom AVFilterGraph.execute callback must be thread-safe when this
+     * is enabled. Access ONLY through AVOptions.
+     */
+    int nb_sched_threads;
 } AVFilterGraph;
 
 /**
@@ -52,6 +52,8 @@ static const AVOption filtergraph_options[] = {
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|V|A },
+    { "sched_threads", "Maximum number of filters activated concurrently", OFFSET(nb_sched_threads),
+        AV_OPT_TYPE_INT,   { .i64 = 1 }, 0, INT_MAX, F|V|A },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
@@ -78,6 +80,16 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+void ff_graph_sched_free(AVFilterGraph *graph)
+{
+}
+
+int ff_graph_sched_init(AVFilterGraph *graph)
+{
+    graph->nb_sched_threads = 1;
+    return 0;
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -95,6 +107,7 @@ AVFilterGraph *avfilter_graph_alloc(void)
     ret->av_class = &filtergraph_class;
     av_opt_set_defaults(ret);
     ff_framequeue_global_init(&ret->internal->frame_queues);
+    ff_mutex_init(&ret->internal->state_lock, NULL);
 
     return ret;
 }
@@ -126,6 +139,8 @@ void avfilter_graph_free(AVFilterGraph **graph)
         avfilter_free((*graph)->filters[0]);
 
     ff_graph_thread_free(*graph);
+    ff_graph_sched_free(*graph);
+    ff_mutex_destroy(&(*graph)->internal->state_lock);
 
     av_freep(&(*graph)->sink_links);
 
@@ -1230,6 +1245,13 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
 
+    if (!graphctx->internal->sched_activate &&
+        (ret = ff_graph_sched_init(graphctx)) < 0) {
+        av_log(log_ctx, AV_LOG_ERROR, "Error initializing the filter scheduler: %s.\n",
+               av_err2str(ret));
+        return ret;
+    }
+
     return 0;
 }
 
@@ -1388,6 +1410,49 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
+static int filters_linked(const AVFilterContext *a, const AVFilterContext *b)
+{
+    unsigned i;
+
+    for (i = 0; i < a->nb_inputs; i++)
+        if (a->inputs[i] && a->inputs[i]->src == b)
+            return 1;
+    for (i = 0; i < a->nb_outputs; i++)
+        if (a->outputs[i] && a->outputs[i]->dst == b)
+            return 1;
+    return 0;
+}
+
+/**
+ * Activate the given filter along with other ready filters, up to
+ * nb_sched_threads of them at once. A filter only touches the links it is
+ * connected to, so filters which are not directly linked to each other can
+ * run concurrently; what they may share through a common neighbour is
+ * protected by the graph state lock.
+ */
+static int run_ready_filters(AVFilterGraph *graph, AVFilterContext *first)
+{
+    AVFilterContext **batch = graph->internal->sched_batch;
+    int nb_batch = 1, i, j;
+
+    batch[0] = first;
+    for (i = 0; i < graph->nb_filters && nb_batch < graph->nb_sched_threads; i++) {
+        AVFilterContext *filter = graph->filters[i];
+
+        if (!filter->ready || filter == first)
+            continue;
+        for (j = 0; j < nb_batch; j++)
+            if (filters_linked(filter, batch[j]))
+                break;
+        if (j == nb_batch)
+            batch[nb_batch++] = filter;
+    }
+
+    if (nb_batch == 1)
+        return ff_filter_activate(first);
+    return graph->internal->sched_activate(graph, batch, nb_batch);
+}
+
 int ff_filter_graph_run_once(AVFilterGraph *graph)
 {
     AVFilterContext *filter;
@@ -1400,5 +1465,7 @@ int ff_filter_graph_run_once(AVFilterGraph *graph)
             filter = graph->filters[i];
     if (!filter->ready)
         return AVERROR(EAGAIN);
+    if (graph->internal->sched_activate)
+        return run_ready_filters(graph, filter);
     return ff_filter_activate(filter);
 }
@@ -25,6 +25,7 @@
  */
 
 #include "libavutil/internal.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "framepool.h"
@@ -130,6 +131,14 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /* Parallel activation of independent filters */
+    void *sched;
+    int (*sched_activate)(AVFilterGraph *graph, AVFilterContext **filters,
+                          int nb_filters);
+    AVFilterContext **sched_batch; ///< nb_sched_threads entries
+    int sched_running;             ///< filters are being activated concurrently
+    AVMutex state_lock;            ///< protects the state shared between neighbours while sched_running
 };
 
 struct AVFilterInternal {
@@ -37,6 +37,7 @@ typedef struct ThreadContext {
     AVFilterGraph *graph;
     AVSliceThread *thread;
     avfilter_action_func *func;
+    AVMutex execute_lock;
 
     /* per-execute parameters */
     AVFilterContext *ctx;
@@ -44,6 +45,12 @@ typedef struct ThreadContext {
     int   *rets;
 } ThreadContext;
 
+typedef struct SchedContext {
+    AVSliceThread *thread;
+    AVFilterContext **filters;
+    int *rets;
+} SchedContext;
+
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
 {
     ThreadContext *c = priv;
@@ -55,6 +62,7 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
 static void slice_thread_uninit(ThreadContext *c)
 {
     avpriv_slicethread_free(&c->thread);
+    ff_mutex_destroy(&c->execute_lock);
 }
 
 static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
@@ -64,12 +72,16 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
 
     if (nb_jobs <= 0)
         return 0;
+
+    /* filters activated concurrently share the pool */
+    ff_mutex_lock(&c->execute_lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    ff_mutex_unlock(&c->execute_lock);
     return 0;
 }
 
@@ -103,6 +115,7 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     }
     graph->nb_threads = ret;
 
+    ff_mutex_init(&((ThreadContext *)graph->internal->thread)->execute_lock, NULL);
     graph->internal->thread_execute = thread_execute;
 
     return 0;
@@ -114,3 +127,73 @@ void ff_graph_thread_free(AVFilterGraph *graph)
         slice_thread_uninit(graph->internal->thread);
     av_freep(&graph->internal->thread);
 }
+
+static void sched_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    SchedContext *c = priv;
+    c->rets[jobnr] = ff_filter_activate(c->filters[jobnr]);
+}
+
+static int sched_activate(AVFilterGraph *graph, AVFilterContext **filters,
+                          int nb_filters)
+{
+    SchedContext *c = graph->internal->sched;
+    int i;
+
+    c->filters = filters;
+    graph->internal->sched_running = 1;
+    avpriv_slicethread_execute(c->thread, nb_filters, 0);
+    graph->internal->sched_running = 0;
+
+    for (i = 0; i < nb_filters; i++)
+        if (c->rets[i] < 0)
+            return c->rets[i];
+    return 0;
+}
+
+int ff_graph_sched_init(AVFilterGraph *graph)
+{
+    SchedContext *c;
+    int ret;
+
+    if (graph->nb_sched_threads == 1)
+        return 0;
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+    graph->internal->sched = c;
+
+    ret = avpriv_slicethread_create(&c->thread, c, sched_worker_func, NULL,
+                                    graph->nb_sched_threads);
+    if (ret <= 1) {
+        ff_graph_sched_free(graph);
+        graph->nb_sched_threads = 1;
+        return (ret < 0) ? ret : 0;
+    }
+
+    c->rets                      = av_malloc_array(ret, sizeof(*c->rets));
+    graph->internal->sched_batch = av_malloc_array(ret, sizeof(*c->filters));
+    if (!c->rets || !graph->internal->sched_batch) {
+        ff_graph_sched_free(graph);
+        return AVERROR(ENOMEM);
+    }
+
+    graph->nb_sched_threads         = ret;
+    graph->internal->sched_activate = sched_activate;
+
+    return 0;
+}
+
+void ff_graph_sched_free(AVFilterGraph *graph)
+{
+    SchedContext *c = graph->internal->sched;
+
+    if (c) {
+        avpriv_slicethread_free(&c->thread);
+        av_freep(&c->rets);
+    }
+    av_freep(&graph->internal->sched);
+    av_freep(&graph->internal->sched_batch);
+    graph->internal->sched_activate = NULL;
+}
@@ -25,4 +25,12 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Set up the pool used to activate independent filters concurrently,
+ * according to AVFilterGraph.nb_sched_threads.
+ */
+int ff_graph_sched_init(AVFilterGraph *graph);
+
+void ff_graph_sched_free(AVFilterGraph *graph);
+
 #endif /* AVFILTER_THREAD_H */
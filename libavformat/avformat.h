@@ -1861,6 +1861,18 @@ typedef struct AVFormatContext {
      * - decoding: set by user
      */
     int max_probe_packets;
+
+    /**
+     * Path of a sidecar keyframe index, for inputs whose demuxer has no
+     * seeking support of its own (MPEG-TS, MPEG-PS, raw video, ...).
+     * If it can be loaded, seeks go straight to the indexed keyframes instead
+     * of searching the file. Otherwise it is built while the input is read
+     * and written when the input is closed, provided it was read to the end
+     * without seeking. It is opened with io_open().
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    char *seek_index;
 } AVFormatContext;
 
 #if FF_API_FORMAT_GET_SET
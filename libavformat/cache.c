@@ -23,7 +23,6 @@
 
 /**
  * @TODO
- *      support keeping files
  *      support filling with a background thread
  */
 
@@ -31,8 +30,13 @@
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/random_seed.h"
+#include "libavutil/sha.h"
 #include "libavutil/tree.h"
 #include "avformat.h"
+#if HAVE_DIRENT_H
+#include <dirent.h>
+#endif
 #include <fcntl.h>
 #if HAVE_IO_H
 #include <io.h>
@@ -40,11 +44,20 @@
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if HAVE_FLOCK
+#include <sys/file.h>
+#endif
 #include <sys/stat.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include "internal.h"
 #include "os_support.h"
 #include "url.h"
 
+#define CONFIG_PERSISTENT_CACHE (HAVE_FLOCK && HAVE_DIRENT_H)
+
+#define CACHE_KEY_SIZE (2 * 32)
+
 typedef struct CacheEntry {
     int64_t logical_pos;
     int64_t physical_pos;
@@ -64,6 +77,11 @@ typedef struct Context {
     URLContext *inner;
     int64_t cache_hit, cache_miss;
     int read_ahead_limit;
+    char *cache_dir;
+    int64_t cache_max_size;
+    char key[CACHE_KEY_SIZE + 1];   ///< name of the persistent entry, empty if none
+    char *data_path;
+    char *index_path;
 } Context;
 
 static int cmp(const void *key, const void *node)
@@ -71,6 +89,376 @@ static int cmp(const void *key, const void *node)
     return FFDIFFSIGN(*(const int64_t *)key, ((const CacheEntry *) node)->logical_pos);
 }
 
+static int enu_free(void *opaque, void *elem)
+{
+    av_free(elem);
+    return 0;
+}
+
+#if CONFIG_PERSISTENT_CACHE
+/*
+ * A persistent cache directory holds one entry per resource, named by the
+ * SHA-256 of its URL and validator (see compute_key()):
+ *   <key>.data   the cached bytes at their offsets in the resource, as a
+ *                sparse file
+ *   <key>.index  the byte ranges of the data file that are valid
+ * The data file is shared-locked while an entry is in use; eviction takes an
+ * exclusive lock, so that it only removes entries nobody has open. The index
+ * is replaced atomically by renaming, while holding an exclusive lock on
+ * index.lock in the directory, so that concurrent updates are not lost.
+ */
+
+typedef struct CacheRange {
+    int64_t start, end;
+} CacheRange;
+
+typedef struct CacheRanges {
+    CacheRange *ranges;
+    int nb_ranges;
+} CacheRanges;
+
+typedef struct CacheFile {
+    char key[CACHE_KEY_SIZE + 1];
+    int64_t size;
+    time_t mtime;
+} CacheFile;
+
+static int add_range(CacheRanges *r, int64_t start, int64_t end)
+{
+    CacheRange range = { start, end };
+    if (!av_dynarray2_add((void **)&r->ranges, &r->nb_ranges, sizeof(range),
+                          (const uint8_t *)&range))
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+static int cmp_range(const void *a, const void *b)
+{
+    return FFDIFFSIGN(((const CacheRange *)a)->start, ((const CacheRange *)b)->start);
+}
+
+/* Sort the ranges and merge the ones that overlap or touch. */
+static void merge_ranges(CacheRanges *r)
+{
+    int i, nb = 0;
+
+    qsort(r->ranges, r->nb_ranges, sizeof(*r->ranges), cmp_range);
+    for (i = 0; i < r->nb_ranges; i++) {
+        if (nb && r->ranges[i].start <= r->ranges[nb - 1].end)
+            r->ranges[nb - 1].end = FFMAX(r->ranges[nb - 1].end, r->ranges[i].end);
+        else
+            r->ranges[nb++] = r->ranges[i];
+    }
+    r->nb_ranges = nb;
+}
+
+/**
+ * Read the index of the entry.
+ *
+ * @param size set to the size of the resource, or -1 if unknown
+ */
+static int read_index(URLContext *h, CacheRanges *r, int64_t *size)
+{
+    Context *c = h->priv_data;
+    char line[128];
+    int64_t start, end;
+    int ret = 0;
+    FILE *f;
+
+    *size = -1;
+    f = fopen(c->index_path, "r");
+    if (!f)
+        return 0;
+
+    if (!fgets(line, sizeof(line), f) || strcmp(line, "ffcache 1\n") ||
+        !fgets(line, sizeof(line), f) || sscanf(line, "size %"SCNd64, size) != 1) {
+        av_log(h, AV_LOG_WARNING, "Ignoring invalid cache index %s\n", c->index_path);
+        *size = -1;
+        goto end;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%"SCNd64" %"SCNd64, &start, &end) != 2 ||
+            start < 0 || end <= start)
+            continue;
+        if ((ret = add_range(r, start, end)) < 0)
+            break;
+    }
+end:
+    fclose(f);
+    return ret;
+}
+
+static int collect_range(void *opaque, void *elem)
+{
+    const CacheEntry *entry = elem;
+    return add_range(opaque, entry->logical_pos, entry->logical_pos + entry->size);
+}
+
+/* Merge what this instance cached into the index on disk. */
+static int write_index(URLContext *h)
+{
+    Context *c = h->priv_data;
+    CacheRanges r = { 0 };
+    char *tmp = NULL, *lock_path;
+    int64_t size;
+    FILE *f = NULL;
+    int i, ret, lock_fd;
+
+    lock_path = av_asprintf("%s/index.lock", c->cache_dir);
+    if (!lock_path)
+        return AVERROR(ENOMEM);
+    lock_fd = avpriv_open(lock_path, O_RDWR | O_CREAT, 0666);
+    av_free(lock_path);
+    if (lock_fd < 0)
+        return AVERROR(errno);
+    if (flock(lock_fd, LOCK_EX) < 0) {
+        ret = AVERROR(errno);
+        goto end;
+    }
+
+    if ((ret = read_index(h, &r, &size)) < 0)
+        goto end;
+    av_tree_enumerate(c->root, &r, NULL, collect_range);
+    merge_ranges(&r);
+    if (c->is_true_eof)
+        size = c->end;
+
+    tmp = av_asprintf("%s.%08"PRIx32, c->index_path, av_get_random_seed());
+    if (!tmp) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    f = fopen(tmp, "w");
+    if (!f) {
+        ret = AVERROR(errno);
+        goto end;
+    }
+    fprintf(f, "ffcache 1\nsize %"PRId64"\n", size);
+    for (i = 0; i < r.nb_ranges; i++)
+        fprintf(f, "%"PRId64" %"PRId64"\n", r.ranges[i].start, r.ranges[i].end);
+    ret = fclose(f);
+    f = NULL;
+    if (ret || rename(tmp, c->index_path) < 0) {
+        ret = AVERROR(errno);
+        unlink(tmp);
+    }
+
+end:
+    if (f) {
+        fclose(f);
+        unlink(tmp);
+    }
+    /* closing releases the lock */
+    close(lock_fd);
+    av_free(tmp);
+    av_free(r.ranges);
+    return ret;
+}
+
+/**
+ * Name the entry after the URL and a validator of the resource, so that a
+ * changed resource does not get served from an entry of its old version.
+ * Resources without an entity tag, a modification date or, for local files,
+ * a modification time are not kept.
+ */
+static int compute_key(URLContext *h, const char *url)
+{
+    Context *c = h->priv_data;
+    uint8_t *validator = NULL, digest[32];
+    struct AVSHA *sha;
+    struct stat st;
+    int i, fd;
+
+    av_opt_get(c->inner, "etag", AV_OPT_SEARCH_CHILDREN, &validator);
+    if (!validator || !*validator) {
+        av_freep(&validator);
+        av_opt_get(c->inner, "last_modified", AV_OPT_SEARCH_CHILDREN, &validator);
+    }
+    if (!validator || !*validator) {
+        av_freep(&validator);
+        fd = ffurl_get_file_handle(c->inner);
+        if (fd >= 0 && !fstat(fd, &st) && S_ISREG(st.st_mode))
+            validator = av_asprintf("mtime %"PRId64" size %"PRId64,
+                                    (int64_t)st.st_mtime, (int64_t)st.st_size);
+    }
+    if (!validator || !*validator) {
+        av_free(validator);
+        av_log(h, AV_LOG_VERBOSE, "No entity tag or modification time for %s\n", url);
+        return AVERROR(ENOSYS);
+    }
+
+    sha = av_sha_alloc();
+    if (!sha || av_sha_init(sha, 256) < 0) {
+        av_free(sha);
+        av_free(validator);
+        return AVERROR(ENOMEM);
+    }
+    av_sha_update(sha, url, strlen(url) + 1);
+    av_sha_update(sha, validator, strlen(validator));
+    av_sha_final(sha, digest);
+    av_free(sha);
+    av_free(validator);
+
+    for (i = 0; i < sizeof(digest); i++)
+        snprintf(c->key + 2 * i, 3, "%02x", digest[i]);
+    return 0;
+}
+
+static int persistent_open(URLContext *h, const char *url)
+{
+    Context *c = h->priv_data;
+    CacheRanges r = { 0 };
+    struct stat st, st_path;
+    int64_t size;
+    int i, ret, tries = 0;
+
+    if ((ret = compute_key(h, url)) < 0)
+        return ret;
+    if (ff_mkdir_p(c->cache_dir) < 0 && errno != EEXIST)
+        return AVERROR(errno);
+    c->data_path  = av_asprintf("%s/%s.data",  c->cache_dir, c->key);
+    c->index_path = av_asprintf("%s/%s.index", c->cache_dir, c->key);
+    if (!c->data_path || !c->index_path)
+        return AVERROR(ENOMEM);
+
+    for (;;) {
+        c->fd = avpriv_open(c->data_path, O_RDWR | O_CREAT, 0666);
+        if (c->fd < 0)
+            return AVERROR(errno);
+        if (flock(c->fd, LOCK_SH) < 0) {
+            ret = AVERROR(errno);
+            goto fail;
+        }
+        if (fstat(c->fd, &st) < 0) {
+            ret = AVERROR(errno);
+            goto fail;
+        }
+        /* The entry may have been evicted between opening and locking. */
+        if (!stat(c->data_path, &st_path) &&
+            st.st_dev == st_path.st_dev && st.st_ino == st_path.st_ino)
+            break;
+        close(c->fd);
+        c->fd = -1;
+        if (++tries == 3)
+            return AVERROR(EAGAIN);
+    }
+
+    if ((ret = read_index(h, &r, &size)) < 0)
+        goto fail;
+    for (i = 0; i < r.nb_ranges; i++) {
+        int64_t pos = r.ranges[i].start, end = FFMIN(r.ranges[i].end, st.st_size);
+
+        while (pos < end) {
+            CacheEntry *entry = av_malloc(sizeof(*entry));
+            struct AVTreeNode *node = av_tree_node_alloc();
+            if (!entry || !node) {
+                av_free(entry);
+                av_free(node);
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            entry->logical_pos  = pos;
+            entry->physical_pos = pos;
+            entry->size         = FFMIN(end - pos, 1 << 30);
+            av_tree_insert(&c->root, entry, cmp, &node);
+            pos   += entry->size;
+            c->end = FFMAX(c->end, pos);
+        }
+    }
+    if (size >= 0) {
+        c->end         = size;
+        c->is_true_eof = 1;
+    }
+    av_free(r.ranges);
+    av_log(h, AV_LOG_VERBOSE, "Using cache entry %s\n", c->key);
+    return 0;
+
+fail:
+    av_free(r.ranges);
+    av_tree_enumerate(c->root, NULL, NULL, enu_free);
+    av_tree_destroy(c->root);
+    c->root = NULL;
+    c->end  = 0;
+    close(c->fd);
+    c->fd = -1;
+    return ret;
+}
+
+static int cmp_file_age(const void *a, const void *b)
+{
+    return FFDIFFSIGN(((const CacheFile *)a)->mtime, ((const CacheFile *)b)->mtime);
+}
+
+/* Remove the least recently used entries until the cache fits its size. */
+static void evict_entries(URLContext *h)
+{
+    Context *c = h->priv_data;
+    CacheFile *files = NULL;
+    int nb_files = 0, i;
+    int64_t total = 0;
+    struct dirent *de;
+    DIR *dir;
+
+    dir = opendir(c->cache_dir);
+    if (!dir)
+        return;
+    while ((de = readdir(dir))) {
+        CacheFile file = { { 0 } };
+        struct stat st;
+        char *path;
+
+        if (strlen(de->d_name) != CACHE_KEY_SIZE + 5 ||
+            strcmp(de->d_name + CACHE_KEY_SIZE, ".data"))
+            continue;
+        av_strlcpy(file.key, de->d_name, sizeof(file.key));
+        path = av_asprintf("%s/%s.data", c->cache_dir, file.key);
+        if (!path || stat(path, &st) < 0) {
+            av_free(path);
+            continue;
+        }
+        /* the data files are sparse, count the allocated size */
+        file.size  = (int64_t)st.st_blocks * 512;
+        file.mtime = st.st_mtime;
+        av_free(path);
+        path = av_asprintf("%s/%s.index", c->cache_dir, file.key);
+        if (path && !stat(path, &st))
+            file.mtime = FFMAX(file.mtime, st.st_mtime);
+        av_free(path);
+
+        total += file.size;
+        if (!av_dynarray2_add((void **)&files, &nb_files, sizeof(file),
+                              (const uint8_t *)&file))
+            break;
+    }
+    closedir(dir);
+
+    qsort(files, nb_files, sizeof(*files), cmp_file_age);
+    for (i = 0; i < nb_files && total > c->cache_max_size; i++) {
+        char *data_path, *index_path;
+        int fd;
+
+        if (!strcmp(files[i].key, c->key))
+            continue;
+        data_path  = av_asprintf("%s/%s.data",  c->cache_dir, files[i].key);
+        index_path = av_asprintf("%s/%s.index", c->cache_dir, files[i].key);
+        if (data_path && index_path &&
+            (fd = avpriv_open(data_path, O_RDWR)) >= 0) {
+            /* Entries open in other instances are locked and skipped. */
+            if (!flock(fd, LOCK_EX | LOCK_NB)) {
+                unlink(index_path);
+                unlink(data_path);
+                total -= files[i].size;
+                av_log(h, AV_LOG_VERBOSE, "Evicted cache entry %s\n", files[i].key);
+            }
+            close(fd);
+        }
+        av_free(data_path);
+        av_free(index_path);
+    }
+    av_free(files);
+}
+#endif /* CONFIG_PERSISTENT_CACHE */
+
 static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
 {
     int ret;
@@ -79,9 +467,32 @@ static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **
 
     av_strstart(arg, "cache:", &arg);
 
+    c->fd = -1;
+    ret = ffurl_open_whitelist(&c->inner, arg, flags, &h->interrupt_callback,
+                               options, h->protocol_whitelist, h->protocol_blacklist, h);
+    if (ret < 0)
+        return ret;
+
+    if (c->cache_dir) {
+#if CONFIG_PERSISTENT_CACHE
+        ret = persistent_open(h, arg);
+#else
+        ret = AVERROR(ENOSYS);
+#endif
+        if (ret >= 0)
+            return 0;
+        av_log(h, AV_LOG_WARNING, "Not using cache directory %s: %s\n",
+               c->cache_dir, av_err2str(ret));
+        c->key[0] = 0;
+        av_freep(&c->data_path);
+        av_freep(&c->index_path);
+    }
+
     c->fd = avpriv_tempfile("ffcache", &buffername, 0, h);
     if (c->fd < 0){
         av_log(h, AV_LOG_ERROR, "Failed to create tempfile\n");
+        /* url_close is not called when opening fails */
+        ffurl_closep(&c->inner);
         return c->fd;
     }
 
@@ -92,8 +503,7 @@ static int cache_open(URLContext *h, const char *arg, int flags, AVDictionary **
     else
         c->filename = buffername;
 
-    return ffurl_open_whitelist(&c->inner, arg, flags, &h->interrupt_callback,
-                                options, h->protocol_whitelist, h->protocol_blacklist, h);
+    return 0;
 }
 
 static int add_entry(URLContext *h, const unsigned char *buf, int size)
@@ -106,7 +516,10 @@ static int add_entry(URLContext *h, const unsigned char *buf, int size)
     struct AVTreeNode *node = NULL;
 
     //FIXME avoid lseek
-    pos = lseek(c->fd, 0, SEEK_END);
+    if (c->key[0])
+        pos = lseek(c->fd, c->logical_pos, SEEK_SET);
+    else
+        pos = lseek(c->fd, 0, SEEK_END);
     if (pos < 0) {
         ret = AVERROR(errno);
         av_log(h, AV_LOG_ERROR, "seek in cache failed\n");
@@ -129,7 +542,8 @@ static int add_entry(URLContext *h, const unsigned char *buf, int size)
 
     if (!entry ||
         entry->logical_pos  + entry->size != c->logical_pos ||
-        entry->physical_pos + entry->size != pos
+        entry->physical_pos + entry->size != pos ||
+        entry->size > INT_MAX - ret
     ) {
         entry = av_malloc(sizeof(*entry));
         node = av_tree_node_alloc();
@@ -197,6 +611,9 @@ static int cache_read(URLContext *h, unsigned char *buf, int size)
 
     // Cache miss or some kind of fault with the cache
 
+    if (c->is_true_eof && c->logical_pos >= c->end)
+        return AVERROR_EOF;
+
     if (c->logical_pos != c->inner_pos) {
         r = ffurl_seek(c->inner, c->logical_pos, SEEK_SET);
         if (r<0) {
@@ -289,12 +706,6 @@ resolve_eof:
     return ret;
 }
 
-static int enu_free(void *opaque, void *elem)
-{
-    av_free(elem);
-    return 0;
-}
-
 static int cache_close(URLContext *h)
 {
     Context *c= h->priv_data;
@@ -303,7 +714,22 @@ static int cache_close(URLContext *h)
     av_log(h, AV_LOG_INFO, "Statistics, cache hits:%"PRId64" cache misses:%"PRId64"\n",
            c->cache_hit, c->cache_miss);
 
-    close(c->fd);
+#if CONFIG_PERSISTENT_CACHE
+    if (c->key[0]) {
+        ret = write_index(h);
+        if (ret < 0)
+            av_log(h, AV_LOG_ERROR, "Could not write cache index %s: %s\n",
+                   c->index_path, av_err2str(ret));
+    }
+#endif
+    if (c->fd >= 0)
+        close(c->fd);
+#if CONFIG_PERSISTENT_CACHE
+    if (c->key[0] && c->cache_max_size > 0)
+        evict_entries(h);
+#endif
+    av_freep(&c->data_path);
+    av_freep(&c->index_path);
     if (c->filename) {
         ret = unlink(c->filename);
         if (ret < 0)
@@ -322,6 +748,8 @@ static int cache_close(URLContext *h)
 
 static const AVOption options[] = {
     { "read_ahead_limit", "Amount in bytes that may be read ahead when seeking isn't supported, -1 for unlimited", OFFSET(read_ahead_limit), AV_OPT_TYPE_INT, { .i64 = 65536 }, -1, INT_MAX, D },
+    { "cache_dir", "Directory to keep cached data in across instances", OFFSET(cache_dir), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, D },
+    { "cache_max_size", "Maximum size in bytes of the cache directory, 0 for unlimited", OFFSET(cache_max_size), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D },
     {NULL},
 };
 
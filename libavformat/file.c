@@ -35,6 +35,7 @@
 #endif
 #include <sys/stat.h>
 #include <stdlib.h>
+#include "fileaio.h"
 #include "os_support.h"
 #include "url.h"
 
@@ -74,6 +75,10 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int aio;
+    int aio_depth;
+    int aio_block_size;
+    FileAIO *aio_ctx;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
@@ -84,6 +89,13 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "aio", "Use asynchronous I/O for regular files", offsetof(FileContext, aio), AV_OPT_TYPE_INT, { .i64 = FILE_AIO_NONE }, FILE_AIO_NONE, FILE_AIO_THREAD, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, "aio" },
+        { "none",     "Synchronous I/O",                    0, AV_OPT_TYPE_CONST, { .i64 = FILE_AIO_NONE   }, 0, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, "aio" },
+        { "auto",     "io_uring if available, else threads", 0, AV_OPT_TYPE_CONST, { .i64 = FILE_AIO_AUTO   }, 0, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, "aio" },
+        { "io_uring", "Linux io_uring",                     0, AV_OPT_TYPE_CONST, { .i64 = FILE_AIO_URING  }, 0, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, "aio" },
+        { "thread",   "Pool of I/O threads",                0, AV_OPT_TYPE_CONST, { .i64 = FILE_AIO_THREAD }, 0, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM, "aio" },
+    { "aio_depth", "Number of asynchronous requests in flight", offsetof(FileContext, aio_depth), AV_OPT_TYPE_INT, { .i64 = 4 }, 1, 64, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "aio_block_size", "Size of asynchronous requests", offsetof(FileContext, aio_block_size), AV_OPT_TYPE_INT, { .i64 = 1 << 20 }, 4096, 64 << 20, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
     { NULL }
 };
 
@@ -111,6 +123,8 @@ static int file_read(URLContext *h, unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (CONFIG_FILE_PROTOCOL && c->aio_ctx)
+        return ff_file_aio_read(c->aio_ctx, buf, size);
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -124,6 +138,8 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (CONFIG_FILE_PROTOCOL && c->aio_ctx)
+        return ff_file_aio_write(c->aio_ctx, buf, size);
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
@@ -243,6 +259,21 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+    /* Requests are issued at explicit offsets, which only works for regular
+     * files that are either read or written. */
+    if (c->aio != FILE_AIO_NONE && !c->follow &&
+        !fstat(fd, &st) && S_ISREG(st.st_mode) &&
+        (flags & AVIO_FLAG_READ_WRITE) != AVIO_FLAG_READ_WRITE) {
+        int ret = ff_file_aio_init(&c->aio_ctx, h, fd, flags & AVIO_FLAG_WRITE,
+                                   c->aio, c->aio_depth, c->aio_block_size, 0);
+        if (ret < 0) {
+            av_log(h, AV_LOG_ERROR, "Failed to set up asynchronous I/O: %s\n",
+                   av_err2str(ret));
+            close(fd);
+            return ret;
+        }
+    }
+
     return 0;
 }
 
@@ -252,6 +283,9 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+    if (c->aio_ctx)
+        return ff_file_aio_seek(c->aio_ctx, pos, whence);
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
@@ -266,7 +300,10 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    return close(c->fd);
+    int ret = ff_file_aio_close(&c->aio_ctx);
+    if (close(c->fd) < 0 && !ret)
+        ret = AVERROR(errno);
+    return ret;
 }
 
 static int file_open_dir(URLContext *h)
@@ -0,0 +1,752 @@
+/*
+ * Asynchronous file I/O
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Asynchronous file I/O with an io_uring backend and a thread pool fallback
+ */
+
+#define _DEFAULT_SOURCE /* Needed for syscall() and MAP_POPULATE */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if HAVE_LINUX_IO_URING_H
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+#include "avio.h"
+#include "fileaio.h"
+
+#if HAVE_LINUX_IO_URING_H && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define CONFIG_URING 1
+#else
+#define CONFIG_URING 0
+#endif
+#define CONFIG_THREAD_POOL (HAVE_PTHREADS && HAVE_UNISTD_H)
+
+enum BlockState {
+    BLOCK_IDLE,
+    BLOCK_PENDING,
+    BLOCK_RUNNING,
+    BLOCK_DONE,
+};
+
+typedef struct FileAIOBlock {
+    uint8_t *buf;
+    int64_t pos;            ///< file offset of buf
+    int len;                ///< size of the request
+    int done;               ///< bytes transferred so far
+    int result;             ///< bytes transferred or AVERROR code, once done
+    enum BlockState state;
+    unsigned seq;           ///< submission order
+#if CONFIG_URING
+    struct iovec iov;
+#endif
+} FileAIOBlock;
+
+struct FileAIO {
+    void *logctx;
+    int fd;
+    int write;
+    int depth;
+    int block_size;
+    enum FileAIOBackend backend;
+
+    FileAIOBlock *blocks;
+    int head;               ///< block holding the current position
+    int active;             ///< blocks[head] is set up for the current position
+    int64_t pos;            ///< current position
+    int64_t end;            ///< end of the data written so far
+    int error;              ///< first error of a background write
+
+#if CONFIG_THREAD_POOL
+    pthread_t *threads;
+    int nb_threads;
+    pthread_mutex_t lock;
+    pthread_cond_t submit_cond;
+    pthread_cond_t done_cond;
+    unsigned next_seq;
+    int exit;
+#endif
+
+#if CONFIG_URING
+    int ring_fd;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    int ring_error;         ///< requests could not be cancelled, the ring is unusable
+#endif
+};
+
+/**
+ * Account for the outcome of one read or write call on a block.
+ *
+ * @return 1 if the block is complete, 0 if the rest must be resubmitted
+ */
+static int block_update(FileAIO *a, FileAIOBlock *b, int res)
+{
+    if (res == AVERROR(EINTR) || res == AVERROR(EAGAIN))
+        return 0;
+    if (res < 0 || (!res && a->write)) {
+        b->result = res < 0 ? res : AVERROR(EIO);
+        return 1;
+    }
+    b->done += res;
+    if (!res || b->done == b->len) {
+        b->result = b->done;
+        return 1;
+    }
+    return 0;
+}
+
+#if CONFIG_THREAD_POOL
+static void *thread_worker(void *arg)
+{
+    FileAIO *a = arg;
+
+    pthread_mutex_lock(&a->lock);
+    for (;;) {
+        FileAIOBlock *b = NULL;
+        int i, res;
+
+        for (i = 0; i < a->depth; i++) {
+            FileAIOBlock *c = &a->blocks[i];
+            if (c->state == BLOCK_PENDING && (!b || (int)(c->seq - b->seq) < 0))
+                b = c;
+        }
+        if (!b) {
+            if (a->exit)
+                break;
+            pthread_cond_wait(&a->submit_cond, &a->lock);
+            continue;
+        }
+        b->state = BLOCK_RUNNING;
+        pthread_mutex_unlock(&a->lock);
+
+        do {
+            if (a->write)
+                res = pwrite(a->fd, b->buf + b->done, b->len - b->done, b->pos + b->done);
+            else
+                res = pread(a->fd, b->buf + b->done, b->len - b->done, b->pos + b->done);
+            if (res < 0)
+                res = AVERROR(errno);
+        } while (!block_update(a, b, res));
+
+        pthread_mutex_lock(&a->lock);
+        b->state = BLOCK_DONE;
+        pthread_cond_broadcast(&a->done_cond);
+    }
+    pthread_mutex_unlock(&a->lock);
+    return NULL;
+}
+
+static int thread_init(FileAIO *a)
+{
+    int ret;
+
+    a->threads = av_calloc(a->depth, sizeof(*a->threads));
+    if (!a->threads)
+        return AVERROR(ENOMEM);
+    if ((ret = pthread_mutex_init(&a->lock, NULL))) {
+        av_freep(&a->threads);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&a->submit_cond, NULL))) {
+        pthread_mutex_destroy(&a->lock);
+        av_freep(&a->threads);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&a->done_cond, NULL))) {
+        pthread_cond_destroy(&a->submit_cond);
+        pthread_mutex_destroy(&a->lock);
+        av_freep(&a->threads);
+        return AVERROR(ret);
+    }
+    a->backend = FILE_AIO_THREAD;
+    for (; a->nb_threads < a->depth; a->nb_threads++) {
+        if ((ret = pthread_create(&a->threads[a->nb_threads], NULL,
+                                  thread_worker, a)))
+            return AVERROR(ret);
+    }
+    return 0;
+}
+
+static void thread_uninit(FileAIO *a)
+{
+    int i;
+
+    if (!a->threads)
+        return;
+    pthread_mutex_lock(&a->lock);
+    a->exit = 1;
+    pthread_cond_broadcast(&a->submit_cond);
+    pthread_mutex_unlock(&a->lock);
+    for (i = 0; i < a->nb_threads; i++)
+        pthread_join(a->threads[i], NULL);
+    pthread_cond_destroy(&a->done_cond);
+    pthread_cond_destroy(&a->submit_cond);
+    pthread_mutex_destroy(&a->lock);
+    av_freep(&a->threads);
+}
+
+static void thread_submit(FileAIO *a, FileAIOBlock *b)
+{
+    pthread_mutex_lock(&a->lock);
+    b->state = BLOCK_PENDING;
+    b->seq   = a->next_seq++;
+    pthread_cond_signal(&a->submit_cond);
+    pthread_mutex_unlock(&a->lock);
+}
+
+static void thread_wait(FileAIO *a, FileAIOBlock *b)
+{
+    pthread_mutex_lock(&a->lock);
+    while (b->state != BLOCK_DONE)
+        pthread_cond_wait(&a->done_cond, &a->lock);
+    pthread_mutex_unlock(&a->lock);
+}
+#endif /* CONFIG_THREAD_POOL */
+
+#if CONFIG_URING
+static int uring_enter(FileAIO *a, unsigned to_submit, unsigned min_complete)
+{
+    int ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, a->ring_fd, to_submit, min_complete,
+                      min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY));
+    return ret < 0 ? AVERROR(errno) : ret;
+}
+
+static int uring_init(FileAIO *a)
+{
+    struct io_uring_params p = { 0 };
+    int fd;
+
+    fd = syscall(__NR_io_uring_setup, a->depth, &p);
+    if (fd < 0)
+        return AVERROR(errno);
+    a->ring_fd = fd;
+
+    a->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    a->cq_size = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        a->sq_size = a->cq_size = FFMAX(a->sq_size, a->cq_size);
+
+    a->sq_ptr = mmap(NULL, a->sq_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (a->sq_ptr == MAP_FAILED)
+        goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        a->cq_ptr = a->sq_ptr;
+    } else {
+        a->cq_ptr = mmap(NULL, a->cq_size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (a->cq_ptr == MAP_FAILED)
+            goto fail;
+    }
+    a->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    a->sqes = mmap(NULL, a->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (a->sqes == MAP_FAILED)
+        goto fail;
+
+    a->sq_head  = (unsigned *)((uint8_t *)a->sq_ptr + p.sq_off.head);
+    a->sq_tail  = (unsigned *)((uint8_t *)a->sq_ptr + p.sq_off.tail);
+    a->sq_mask  = (unsigned *)((uint8_t *)a->sq_ptr + p.sq_off.ring_mask);
+    a->sq_array = (unsigned *)((uint8_t *)a->sq_ptr + p.sq_off.array);
+    a->cq_head  = (unsigned *)((uint8_t *)a->cq_ptr + p.cq_off.head);
+    a->cq_tail  = (unsigned *)((uint8_t *)a->cq_ptr + p.cq_off.tail);
+    a->cq_mask  = (unsigned *)((uint8_t *)a->cq_ptr + p.cq_off.ring_mask);
+    a->cqes     = (struct io_uring_cqe *)((uint8_t *)a->cq_ptr + p.cq_off.cqes);
+    a->backend  = FILE_AIO_URING;
+    return 0;
+
+fail:
+    fd = AVERROR(errno);
+    if (a->cq_ptr && a->cq_ptr != MAP_FAILED && a->cq_ptr != a->sq_ptr)
+        munmap(a->cq_ptr, a->cq_size);
+    if (a->sq_ptr && a->sq_ptr != MAP_FAILED)
+        munmap(a->sq_ptr, a->sq_size);
+    a->sq_ptr = a->cq_ptr = NULL;
+    a->sqes   = NULL;
+    close(a->ring_fd);
+    return fd;
+}
+
+static void uring_uninit(FileAIO *a)
+{
+    if (!a->sqes)
+        return;
+    munmap(a->sqes, a->sqes_size);
+    if (a->cq_ptr != a->sq_ptr)
+        munmap(a->cq_ptr, a->cq_size);
+    munmap(a->sq_ptr, a->sq_size);
+    close(a->ring_fd);
+}
+
+static int uring_submit(FileAIO *a, FileAIOBlock *b)
+{
+    unsigned tail = *a->sq_tail, idx = tail & *a->sq_mask;
+    struct io_uring_sqe *sqe = &a->sqes[idx];
+    int ret;
+
+    if (a->ring_error)
+        return a->ring_error;
+
+    /* Only depth requests are ever in flight, so the ring cannot be full. */
+    memset(sqe, 0, sizeof(*sqe));
+    b->iov.iov_base = b->buf + b->done;
+    b->iov.iov_len  = b->len - b->done;
+    sqe->opcode     = a->write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd         = a->fd;
+    sqe->addr       = (uintptr_t)&b->iov;
+    sqe->len        = 1;
+    sqe->off        = b->pos + b->done;
+    sqe->user_data  = b - a->blocks;
+    a->sq_array[idx] = idx;
+    atomic_store_explicit((_Atomic unsigned *)a->sq_tail, tail + 1,
+                          memory_order_release);
+
+    ret = uring_enter(a, 1, 0);
+    /* The kernel only consumes entries in io_uring_enter(), take back the
+     * one it did not accept so that it is not submitted later on. */
+    if (ret < 0 && atomic_load_explicit((_Atomic unsigned *)a->sq_head,
+                                        memory_order_acquire) == tail)
+        atomic_store_explicit((_Atomic unsigned *)a->sq_tail, tail,
+                              memory_order_release);
+    return ret;
+}
+
+#define URING_CANCEL_TAG (1ULL << 63)
+
+/**
+ * Cancel the requests in flight and wait until the kernel is done with all
+ * of them, marking their blocks failed with err.
+ */
+static void uring_cancel(FileAIO *a, int err)
+{
+    unsigned tail = *a->sq_tail;
+    int i, nb_pending = 0, ret = 0;
+
+    for (i = 0; i < a->depth; i++) {
+        unsigned idx = tail & *a->sq_mask;
+        struct io_uring_sqe *sqe = &a->sqes[idx];
+
+        if (a->blocks[i].state != BLOCK_PENDING)
+            continue;
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+        sqe->fd        = -1;
+        sqe->addr      = i;
+        sqe->user_data = URING_CANCEL_TAG | i;
+        a->sq_array[idx] = idx;
+        tail++;
+        nb_pending++;
+    }
+    atomic_store_explicit((_Atomic unsigned *)a->sq_tail, tail,
+                          memory_order_release);
+
+    while (nb_pending) {
+        unsigned head = *a->cq_head;
+        unsigned cq_tail = atomic_load_explicit((_Atomic unsigned *)a->cq_tail,
+                                                memory_order_acquire);
+
+        if (head == cq_tail) {
+            /* Requests that cannot be cancelled still run to completion. */
+            unsigned to_submit = tail - atomic_load_explicit((_Atomic unsigned *)a->sq_head,
+                                                             memory_order_acquire);
+            if ((ret = uring_enter(a, to_submit, 1)) < 0)
+                break;
+            continue;
+        }
+        for (; head != cq_tail; head++) {
+            const struct io_uring_cqe *cqe = &a->cqes[head & *a->cq_mask];
+            FileAIOBlock *c;
+
+            if (cqe->user_data & URING_CANCEL_TAG)
+                continue;
+            c = &a->blocks[cqe->user_data];
+            if (c->state != BLOCK_PENDING)
+                continue;
+            c->result = err;
+            c->state  = BLOCK_DONE;
+            nb_pending--;
+        }
+        atomic_store_explicit((_Atomic unsigned *)a->cq_head, head,
+                              memory_order_release);
+    }
+    if (!nb_pending)
+        return;
+
+    av_log(a->logctx, AV_LOG_ERROR, "Could not wait for %d io_uring requests: %s\n",
+           nb_pending, av_err2str(ret));
+    a->ring_error = err;
+    for (i = 0; i < a->depth; i++) {
+        if (a->blocks[i].state == BLOCK_PENDING) {
+            a->blocks[i].result = err;
+            a->blocks[i].state  = BLOCK_DONE;
+        }
+    }
+}
+
+static void uring_wait(FileAIO *a, FileAIOBlock *b)
+{
+    while (b->state != BLOCK_DONE) {
+        unsigned head = *a->cq_head;
+        unsigned tail = atomic_load_explicit((_Atomic unsigned *)a->cq_tail,
+                                             memory_order_acquire);
+        struct io_uring_cqe *cqe;
+        FileAIOBlock *c;
+        int res;
+
+        if (head == tail) {
+            if ((res = uring_enter(a, 0, 1)) < 0) {
+                av_log(a->logctx, AV_LOG_ERROR, "io_uring_enter() failed: %s\n",
+                       av_err2str(res));
+                /* The buffers must not be reused while requests are in flight. */
+                uring_cancel(a, res);
+                return;
+            }
+            continue;
+        }
+        cqe = &a->cqes[head & *a->cq_mask];
+        c   = &a->blocks[cqe->user_data];
+        res = cqe->res < 0 ? AVERROR(-cqe->res) : cqe->res;
+        atomic_store_explicit((_Atomic unsigned *)a->cq_head, head + 1,
+                              memory_order_release);
+
+        if (block_update(a, c, res)) {
+            c->state = BLOCK_DONE;
+        } else if ((res = uring_submit(a, c)) < 0) {
+            c->result = res;
+            c->state  = BLOCK_DONE;
+        }
+    }
+}
+#endif /* CONFIG_URING */
+
+static void aio_submit(FileAIO *a, FileAIOBlock *b, int64_t pos, int len)
+{
+    b->pos  = pos;
+    b->len  = len;
+    b->done = 0;
+#if CONFIG_URING
+    if (a->backend == FILE_AIO_URING) {
+        int ret;
+        b->state = BLOCK_PENDING;
+        if ((ret = uring_submit(a, b)) < 0) {
+            b->result = ret;
+            b->state  = BLOCK_DONE;
+        }
+        return;
+    }
+#endif
+#if CONFIG_THREAD_POOL
+    thread_submit(a, b);
+#endif
+}
+
+/**
+ * Wait for the request on a block, if any.
+ *
+ * @return bytes transferred or a negative AVERROR code
+ */
+static int aio_wait(FileAIO *a, FileAIOBlock *b)
+{
+    if (b->state == BLOCK_IDLE)
+        return 0;
+#if CONFIG_URING
+    if (a->backend == FILE_AIO_URING)
+        uring_wait(a, b);
+#endif
+#if CONFIG_THREAD_POOL
+    if (a->backend == FILE_AIO_THREAD)
+        thread_wait(a, b);
+#endif
+    if (a->write && b->result < 0 && !a->error)
+        a->error = b->result;
+    return b->result;
+}
+
+static void aio_drain(FileAIO *a)
+{
+    int i;
+    for (i = 0; i < a->depth; i++)
+        aio_wait(a, &a->blocks[i]);
+    a->active = 0;
+}
+
+/* Reading: request the blocks starting with the one holding pos. */
+static void read_start(FileAIO *a)
+{
+    int64_t start = a->pos - a->pos % a->block_size;
+    int i;
+
+    for (i = 0; i < a->depth; i++)
+        aio_submit(a, &a->blocks[i], start + (int64_t)i * a->block_size,
+                   a->block_size);
+    a->head   = 0;
+    a->active = 1;
+}
+
+/* Reading: the head block is used up, request the next one in its place. */
+static void read_advance(FileAIO *a)
+{
+    FileAIOBlock *b = &a->blocks[a->head];
+
+    aio_submit(a, b, b->pos + (int64_t)a->depth * a->block_size, a->block_size);
+    a->head = (a->head + 1) % a->depth;
+}
+
+/* Writing: submit the block being filled. */
+static void write_flush(FileAIO *a)
+{
+    FileAIOBlock *b = &a->blocks[a->head];
+
+    if (!a->active)
+        return;
+    if (b->len)
+        aio_submit(a, b, b->pos, b->len);
+    a->head   = (a->head + 1) % a->depth;
+    a->active = 0;
+}
+
+int ff_file_aio_read(FileAIO *a, uint8_t *buf, int size)
+{
+    FileAIOBlock *b;
+    int64_t off;
+    int ret;
+
+    if (!a->active)
+        read_start(a);
+    b   = &a->blocks[a->head];
+    ret = aio_wait(a, b);
+    if (ret < 0) {
+        /* Start over on the next call. */
+        aio_drain(a);
+        return ret;
+    }
+
+    off = a->pos - b->pos;
+    if (off >= ret)
+        return AVERROR_EOF;
+    size = FFMIN(size, ret - off);
+    memcpy(buf, b->buf + off, size);
+    a->pos += size;
+    if (off + size == a->block_size)
+        read_advance(a);
+    return size;
+}
+
+int ff_file_aio_write(FileAIO *a, const uint8_t *buf, int size)
+{
+    int written = 0;
+
+    if (a->error)
+        return a->error;
+
+    while (written < size) {
+        FileAIOBlock *b = &a->blocks[a->head];
+        int n, capacity;
+
+        if (!a->active) {
+            if (aio_wait(a, b) < 0)
+                return a->error;
+            b->pos    = a->pos;
+            b->len    = 0;
+            b->state  = BLOCK_IDLE;
+            a->active = 1;
+        }
+        /* Let blocks end on multiples of block_size. */
+        capacity = a->block_size - b->pos % a->block_size;
+        n = FFMIN(size - written, capacity - b->len);
+        memcpy(b->buf + b->len, buf + written, n);
+        b->len  += n;
+        written += n;
+        a->pos  += n;
+        a->end   = FFMAX(a->end, a->pos);
+        if (b->len == capacity)
+            write_flush(a);
+    }
+    return size;
+}
+
+int64_t ff_file_aio_seek(FileAIO *a, int64_t pos, int whence)
+{
+    int64_t size = -1;
+
+    if (whence == AVSEEK_SIZE || whence == SEEK_END) {
+        struct stat st;
+        if (fstat(a->fd, &st) < 0)
+            return AVERROR(errno);
+        size = a->write ? FFMAX(st.st_size, a->end) : st.st_size;
+    }
+    switch (whence) {
+    case AVSEEK_SIZE: return size;
+    case SEEK_SET:                   break;
+    case SEEK_CUR:    pos += a->pos; break;
+    case SEEK_END:    pos += size;   break;
+    default:          return AVERROR(EINVAL);
+    }
+    if (pos < 0)
+        return AVERROR(EINVAL);
+    if (pos == a->pos)
+        return pos;
+
+    if (a->write) {
+        /* Requests must not overlap data that is rewritten after seeking. */
+        write_flush(a);
+        aio_drain(a);
+    } else if (a->active) {
+        FileAIOBlock *b = &a->blocks[a->head];
+        if (pos >= b->pos && pos < b->pos + (int64_t)a->depth * a->block_size) {
+            /* Keep the blocks that are still ahead of the new position. */
+            while (pos >= a->blocks[a->head].pos + a->block_size) {
+                aio_wait(a, &a->blocks[a->head]);
+                read_advance(a);
+            }
+        } else {
+            aio_drain(a);
+        }
+    }
+    a->pos = pos;
+    return pos;
+}
+
+int ff_file_aio_init(FileAIO **pa, void *logctx, int fd, int write,
+                     enum FileAIOBackend backend, int depth, int block_size,
+                     int64_t pos)
+{
+    FileAIO *a;
+    int i, ret = AVERROR(ENOSYS);
+
+    if (backend == FILE_AIO_NONE || depth <= 0 || block_size <= 0)
+        return AVERROR(EINVAL);
+
+    a = av_mallocz(sizeof(*a));
+    if (!a)
+        return AVERROR(ENOMEM);
+    a->logctx     = logctx;
+    a->fd         = fd;
+    a->write      = write;
+    a->depth      = depth;
+    a->block_size = block_size;
+    a->backend    = FILE_AIO_NONE;
+    a->pos        = pos;
+    a->end        = pos;
+
+    a->blocks = av_calloc(depth, sizeof(*a->blocks));
+    if (!a->blocks) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    for (i = 0; i < depth; i++) {
+        a->blocks[i].buf = av_malloc(block_size);
+        if (!a->blocks[i].buf) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
+#if CONFIG_URING
+    if (backend == FILE_AIO_AUTO || backend == FILE_AIO_URING) {
+        ret = uring_init(a);
+        if (ret < 0 && backend == FILE_AIO_AUTO)
+            av_log(logctx, AV_LOG_VERBOSE, "io_uring unavailable (%s), using threads\n",
+                   av_err2str(ret));
+    }
+#endif
+#if CONFIG_THREAD_POOL
+    if (a->backend == FILE_AIO_NONE &&
+        (backend == FILE_AIO_AUTO || backend == FILE_AIO_THREAD))
+        ret = thread_init(a);
+#endif
+    if (a->backend == FILE_AIO_NONE || ret < 0)
+        goto fail;
+
+    av_log(logctx, AV_LOG_DEBUG, "Asynchronous %s with %s, %d x %d bytes\n",
+           write ? "writes" : "reads",
+           a->backend == FILE_AIO_URING ? "io_uring" : "threads",
+           depth, block_size);
+    *pa = a;
+    return 0;
+
+fail:
+    ff_file_aio_close(&a);
+    return ret;
+}
+
+int ff_file_aio_close(FileAIO **pa)
+{
+    FileAIO *a = *pa;
+    int i, ret;
+
+    if (!a)
+        return 0;
+
+    if (a->backend != FILE_AIO_NONE) {
+        if (a->write)
+            write_flush(a);
+        aio_drain(a);
+    }
+    ret = a->error;
+
+#if CONFIG_URING
+    uring_uninit(a);
+    if (a->ring_error) {
+        /* The kernel may still access the blocks of the lost requests. */
+        av_log(a->logctx, AV_LOG_WARNING, "Leaking the buffers of %d I/O requests\n",
+               a->depth);
+        a->blocks = NULL;
+    }
+#endif
+#if CONFIG_THREAD_POOL
+    thread_uninit(a);
+#endif
+    if (a->blocks) {
+        for (i = 0; i < a->depth; i++)
+            av_freep(&a->blocks[i].buf);
+        av_freep(&a->blocks);
+    }
+    av_freep(pa);
+    return ret;
+}
@@ -0,0 +1,84 @@
+/*
+ * Asynchronous file I/O
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_FILEAIO_H
+#define AVFORMAT_FILEAIO_H
+
+#include <stdint.h>
+
+enum FileAIOBackend {
+    FILE_AIO_NONE,
+    FILE_AIO_AUTO,     ///< io_uring if usable, threads otherwise
+    FILE_AIO_URING,
+    FILE_AIO_THREAD,
+};
+
+typedef struct FileAIO FileAIO;
+
+/**
+ * Start asynchronous I/O on a regular file.
+ *
+ * When reading, up to depth requests of block_size bytes each are kept in
+ * flight ahead of the read position. When writing, data is gathered into
+ * blocks of block_size bytes, aligned to multiples of block_size in the file,
+ * and up to depth of them are written in the background.
+ *
+ * The file descriptor stays owned by the caller, and its file offset is not
+ * used or updated.
+ *
+ * @param logctx  context for logging
+ * @param fd      file descriptor open for reading or writing
+ * @param write   nonzero to write, zero to read
+ * @param pos     initial position in the file
+ * @return 0 on success, AVERROR(ENOSYS) if the requested backend is not
+ *         available, another negative AVERROR code on failure
+ */
+int ff_file_aio_init(FileAIO **pa, void *logctx, int fd, int write,
+                     enum FileAIOBackend backend, int depth, int block_size,
+                     int64_t pos);
+
+/**
+ * @return number of bytes read, AVERROR_EOF at the end of the file or a
+ *         negative AVERROR code on error
+ */
+int ff_file_aio_read(FileAIO *a, uint8_t *buf, int size);
+
+/**
+ * Queue data for writing.
+ *
+ * Errors of earlier background writes are returned by later calls.
+ *
+ * @return size or a negative AVERROR code
+ */
+int ff_file_aio_write(FileAIO *a, const uint8_t *buf, int size);
+
+/**
+ * Same semantics as the url_seek callback, including AVSEEK_SIZE.
+ */
+int64_t ff_file_aio_seek(FileAIO *a, int64_t pos, int whence);
+
+/**
+ * Write out pending data, wait for all requests and free the context.
+ *
+ * @return 0 or the first error of a background write
+ */
+int ff_file_aio_close(FileAIO **pa);
+
+#endif /* AVFORMAT_FILEAIO_H */
@@ -33,6 +33,8 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
+#include "libavutil/fifo.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "internal.h"
@@ -78,6 +80,38 @@ struct segment {
 };
 
 struct rendition;
+struct playlist;
+
+#if HAVE_THREADS
+enum PrefetchState {
+    PREFETCH_IDLE,
+    PREFETCH_QUEUED,
+    PREFETCH_RUNNING,
+    PREFETCH_DONE,
+};
+
+/*
+ * A segment being downloaded ahead of the demuxer by its own thread.
+ * The data is passed on through a FIFO that grows up to
+ * prefetch_buffer_size; beyond that the download waits for the reader.
+ * Everything but the thread's own I/O is protected by the playlist's
+ * prefetch_mutex.
+ */
+struct prefetch_slot {
+    struct playlist *pls;
+    pthread_t thread;
+    int thread_started;
+    enum PrefetchState state;
+    int abort_request;
+    int64_t seq_no;
+    struct segment seg; /* private copy, owns url and key */
+    AVDictionary *opts;
+    AVFifoBuffer *fifo;
+    int error;          /* download result once PREFETCH_DONE */
+    AVIOContext *pb;    /* kept open between segments for http_persistent */
+    AVIOInterruptCB interrupt_callback;
+};
+#endif
 
 enum PlaylistType {
     PLS_TYPE_UNSPECIFIED,
@@ -160,6 +194,18 @@ struct playlist {
      * playlist, if any. */
     int n_init_sections;
     struct segment **init_sections;
+
+    /* Segments downloaded ahead, if prefetch_segments is set. */
+    int n_prefetch;
+    struct prefetch_slot *prefetch;
+    struct prefetch_slot *input_slot; /* slot the current segment is read from */
+#if HAVE_THREADS
+    pthread_mutex_t prefetch_mutex;
+    pthread_cond_t prefetch_cond;
+#endif
+    int prefetch_quit;
+    char prefetch_key_url[MAX_URL_SIZE];
+    uint8_t prefetch_key[16];
 };
 
 /*
@@ -212,6 +258,8 @@ typedef struct HLSContext {
     int http_persistent;
     int http_multiple;
     int http_seekable;
+    int prefetch_segments;
+    int prefetch_buffer_size;
     AVIOContext *playlist_pb;
 } HLSContext;
 
@@ -621,13 +669,10 @@ static int open_url_keepalive(AVFormatContext *s, AVIOContext **pb,
 #endif
 }
 
-static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out)
+static int check_url(AVFormatContext *s, const char *url, int *is_http_out)
 {
     HLSContext *c = s->priv_data;
-    AVDictionary *tmp = NULL;
     const char *proto_name = NULL;
-    int ret;
     int is_http = 0;
 
     if (av_strstart(url, "crypto", NULL)) {
@@ -669,6 +714,21 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     else if (strcmp(proto_name, "file") || !strncmp(url, "file,", 5))
         return AVERROR_INVALIDDATA;
 
+    *is_http_out = is_http;
+    return 0;
+}
+
+static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
+                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out)
+{
+    HLSContext *c = s->priv_data;
+    AVDictionary *tmp = NULL;
+    int ret;
+    int is_http = 0;
+
+    if ((ret = check_url(s, url, &is_http)) < 0)
+        return ret;
+
     av_dict_copy(&tmp, *opts, 0);
     av_dict_copy(&tmp, opts2, 0);
 
@@ -1012,6 +1072,454 @@ static struct segment *next_segment(struct playlist *pls)
     return pls->segments[n];
 }
 
+#if HAVE_THREADS
+static int prefetch_check_interrupt(void *opaque)
+{
+    struct prefetch_slot *slot = opaque;
+    HLSContext *c = slot->pls->parent->priv_data;
+
+    if (slot->abort_request || slot->pls->prefetch_quit)
+        return 1;
+    return ff_check_interrupt(c->interrupt_callback);
+}
+
+/* Called with prefetch_mutex held. */
+static void prefetch_slot_reset(struct prefetch_slot *slot)
+{
+    slot->state         = PREFETCH_IDLE;
+    slot->abort_request = 0;
+    slot->seq_no        = -1;
+    slot->error         = 0;
+    av_freep(&slot->seg.url);
+    av_freep(&slot->seg.key);
+    av_dict_free(&slot->opts);
+    av_fifo_reset(slot->fifo);
+}
+
+/* Give a slot back; a running download is stopped by its thread.
+ * Called with prefetch_mutex held. */
+static void prefetch_slot_release(struct prefetch_slot *slot)
+{
+    if (slot->state == PREFETCH_RUNNING)
+        slot->abort_request = 1;
+    else if (slot->state != PREFETCH_IDLE)
+        prefetch_slot_reset(slot);
+}
+
+static void prefetch_request_opts(struct prefetch_slot *slot, AVDictionary **opts)
+{
+    HLSContext *c = slot->pls->parent->priv_data;
+
+    av_dict_copy(opts, slot->opts, 0);
+    if (c->http_persistent)
+        av_dict_set(opts, "multiple_requests", "1", 0);
+    if (slot->seg.size >= 0) {
+        av_dict_set_int(opts, "offset", slot->seg.url_offset, 0);
+        av_dict_set_int(opts, "end_offset", slot->seg.url_offset + slot->seg.size, 0);
+    }
+}
+
+static int prefetch_get_key(struct prefetch_slot *slot, uint8_t *key)
+{
+    struct playlist *pls = slot->pls;
+    AVFormatContext *s = pls->parent;
+    AVDictionary *opts = NULL;
+    AVIOContext *pb = NULL;
+    int ret, is_http;
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    ret = strcmp(slot->seg.key, pls->prefetch_key_url);
+    if (!ret)
+        memcpy(key, pls->prefetch_key, sizeof(pls->prefetch_key));
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+    if (!ret)
+        return 0;
+
+    if ((ret = check_url(s, slot->seg.key, &is_http)) < 0)
+        return ret;
+    av_dict_copy(&opts, slot->opts, 0);
+    ret = ffio_open_whitelist(&pb, slot->seg.key, AVIO_FLAG_READ,
+                              &slot->interrupt_callback, &opts,
+                              s->protocol_whitelist, s->protocol_blacklist);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        av_log(s, AV_LOG_ERROR, "Unable to open key file %s\n", slot->seg.key);
+        return ret;
+    }
+    ret = avio_read(pb, key, sizeof(pls->prefetch_key));
+    avio_closep(&pb);
+    if (ret != sizeof(pls->prefetch_key)) {
+        av_log(s, AV_LOG_ERROR, "Unable to read key file %s\n", slot->seg.key);
+        return ret < 0 ? ret : AVERROR_INVALIDDATA;
+    }
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    av_strlcpy(pls->prefetch_key_url, slot->seg.key, sizeof(pls->prefetch_key_url));
+    memcpy(pls->prefetch_key, key, sizeof(pls->prefetch_key));
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+    return 0;
+}
+
+/**
+ * The prefetch counterpart of open_input(), run by the slot's thread.
+ * Returns 1 if the connection may be reused for the next segment.
+ */
+static int prefetch_open(struct prefetch_slot *slot)
+{
+    struct playlist *pls = slot->pls;
+    AVFormatContext *s = pls->parent;
+    HLSContext *c = s->priv_data;
+    struct segment *seg = &slot->seg;
+    AVDictionary *opts = NULL;
+    char url[MAX_URL_SIZE];
+    int ret, is_http;
+
+    av_log(s, AV_LOG_VERBOSE, "HLS prefetch for url '%s', offset %"PRId64", playlist %d\n",
+           seg->url, seg->url_offset, pls->index);
+
+    prefetch_request_opts(slot, &opts);
+    if (seg->key_type == KEY_NONE) {
+        av_strlcpy(url, seg->url, sizeof(url));
+    } else if (seg->key_type == KEY_AES_128) {
+        char iv[33], key_hex[33];
+        uint8_t key[16];
+        if ((ret = prefetch_get_key(slot, key)) < 0)
+            goto end;
+        ff_data_to_hex(iv, seg->iv, sizeof(seg->iv), 0);
+        ff_data_to_hex(key_hex, key, sizeof(key), 0);
+        iv[32] = key_hex[32] = '\0';
+        if (strstr(seg->url, "://"))
+            snprintf(url, sizeof(url), "crypto+%s", seg->url);
+        else
+            snprintf(url, sizeof(url), "crypto:%s", seg->url);
+        av_dict_set(&opts, "key", key_hex, 0);
+        av_dict_set(&opts, "iv", iv, 0);
+    } else {
+        av_log(s, AV_LOG_ERROR, "SAMPLE-AES encryption is not supported yet\n");
+        ret = AVERROR_PATCHWELCOME;
+        goto end;
+    }
+
+    if ((ret = check_url(s, url, &is_http)) < 0)
+        goto end;
+
+#if CONFIG_HTTP_PROTOCOL
+    /* A connection is only kept after an unencrypted http segment. */
+    if (slot->pb) {
+        slot->pb->eof_reached = 0;
+        ret = ff_http_do_new_request2(ffio_geturlcontext(slot->pb), url, &opts);
+        if (ret >= 0 || ret == AVERROR_EXIT)
+            goto end;
+        avio_closep(&slot->pb);
+        av_dict_free(&opts);
+        prefetch_request_opts(slot, &opts);
+    }
+#endif
+    ret = ffio_open_whitelist(&slot->pb, url, AVIO_FLAG_READ,
+                              &slot->interrupt_callback, &opts,
+                              s->protocol_whitelist, s->protocol_blacklist);
+
+    /* See open_input() for why this is not done for HTTP. */
+    if (ret >= 0 && !is_http && seg->url_offset) {
+        int64_t seekret = avio_seek(slot->pb, seg->url_offset, SEEK_SET);
+        if (seekret < 0)
+            ret = seekret;
+    }
+
+end:
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+    return c->http_persistent && is_http && seg->key_type == KEY_NONE;
+}
+
+/* Append data to the FIFO of a slot, waiting for the reader if it is full.
+ * Called with prefetch_mutex held. */
+static int prefetch_write(struct prefetch_slot *slot, const uint8_t *buf, int size)
+{
+    struct playlist *pls = slot->pls;
+    HLSContext *c = pls->parent->priv_data;
+
+    while (av_fifo_space(slot->fifo) < size) {
+        int used  = av_fifo_size(slot->fifo);
+        int alloc = used + av_fifo_space(slot->fifo);
+
+        if (slot->abort_request || pls->prefetch_quit)
+            return AVERROR_EXIT;
+        if (alloc < c->prefetch_buffer_size) {
+            int grow = FFMIN(FFMAX(2 * alloc, used + size), c->prefetch_buffer_size) - alloc;
+            if (av_fifo_grow(slot->fifo, grow) < 0)
+                return AVERROR(ENOMEM);
+            continue;
+        }
+        pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_mutex);
+    }
+    av_fifo_generic_write(slot->fifo, (void *)buf, size, NULL);
+    pthread_cond_broadcast(&pls->prefetch_cond);
+    return 0;
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct prefetch_slot *slot = arg;
+    struct playlist *pls = slot->pls;
+    uint8_t buf[INITIAL_BUFFER_SIZE];
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    for (;;) {
+        int64_t offset = 0;
+        int ret, reuse;
+
+        while (!pls->prefetch_quit && slot->state != PREFETCH_QUEUED)
+            pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_mutex);
+        if (pls->prefetch_quit)
+            break;
+        slot->state = PREFETCH_RUNNING;
+        pthread_mutex_unlock(&pls->prefetch_mutex);
+
+        ret = reuse = prefetch_open(slot);
+        while (ret >= 0) {
+            int size = sizeof(buf);
+            /* limit read if the segment was only a part of a file */
+            if (slot->seg.size >= 0)
+                size = FFMIN(size, slot->seg.size - offset);
+            ret = size > 0 ? avio_read(slot->pb, buf, size) : AVERROR_EOF;
+            if (ret <= 0)
+                break;
+            offset += ret;
+            pthread_mutex_lock(&pls->prefetch_mutex);
+            ret = prefetch_write(slot, buf, ret);
+            pthread_mutex_unlock(&pls->prefetch_mutex);
+        }
+        if (ret == AVERROR_EOF || ret == 0)
+            ret = 0;
+        else
+            reuse = 0;
+        if (!reuse || slot->abort_request)
+            avio_closep(&slot->pb);
+
+        pthread_mutex_lock(&pls->prefetch_mutex);
+        if (slot->abort_request) {
+            prefetch_slot_reset(slot);
+        } else {
+            slot->state = PREFETCH_DONE;
+            slot->error = ret;
+        }
+        pthread_cond_broadcast(&pls->prefetch_cond);
+    }
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+
+    avio_closep(&slot->pb);
+    return NULL;
+}
+
+static int prefetch_init(HLSContext *c, struct playlist *pls)
+{
+    int i, ret;
+
+    pls->prefetch = av_calloc(c->prefetch_segments + 1, sizeof(*pls->prefetch));
+    if (!pls->prefetch)
+        return AVERROR(ENOMEM);
+    if ((ret = pthread_mutex_init(&pls->prefetch_mutex, NULL))) {
+        av_freep(&pls->prefetch);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&pls->prefetch_cond, NULL))) {
+        pthread_mutex_destroy(&pls->prefetch_mutex);
+        av_freep(&pls->prefetch);
+        return AVERROR(ret);
+    }
+    pls->n_prefetch = c->prefetch_segments + 1;
+
+    for (i = 0; i < pls->n_prefetch; i++) {
+        struct prefetch_slot *slot = &pls->prefetch[i];
+        slot->pls    = pls;
+        slot->seq_no = -1;
+        slot->interrupt_callback.callback = prefetch_check_interrupt;
+        slot->interrupt_callback.opaque   = slot;
+        slot->fifo = av_fifo_alloc(INITIAL_BUFFER_SIZE);
+        if (!slot->fifo)
+            return AVERROR(ENOMEM);
+        if ((ret = pthread_create(&slot->thread, NULL, prefetch_thread, slot))) {
+            av_log(pls->parent, AV_LOG_ERROR, "Failed to start the prefetch thread: %s\n",
+                   av_err2str(AVERROR(ret)));
+            return AVERROR(ret);
+        }
+        slot->thread_started = 1;
+    }
+    return 0;
+}
+
+static void prefetch_free(struct playlist *pls)
+{
+    int i;
+
+    if (!pls->n_prefetch)
+        return;
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    pls->prefetch_quit = 1;
+    pthread_cond_broadcast(&pls->prefetch_cond);
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+
+    for (i = 0; i < pls->n_prefetch; i++) {
+        struct prefetch_slot *slot = &pls->prefetch[i];
+        if (slot->thread_started)
+            pthread_join(slot->thread, NULL);
+        av_freep(&slot->seg.url);
+        av_freep(&slot->seg.key);
+        av_dict_free(&slot->opts);
+        av_fifo_freep(&slot->fifo);
+    }
+    pthread_cond_destroy(&pls->prefetch_cond);
+    pthread_mutex_destroy(&pls->prefetch_mutex);
+    av_freep(&pls->prefetch);
+    pls->n_prefetch = 0;
+    pls->input_slot = NULL;
+}
+
+/* Drop all prefetched data, e.g. when seeking. */
+static void prefetch_reset(struct playlist *pls)
+{
+    int i;
+
+    if (!pls->n_prefetch)
+        return;
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    for (i = 0; i < pls->n_prefetch; i++)
+        prefetch_slot_release(&pls->prefetch[i]);
+    pls->input_slot = NULL;
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+}
+
+static struct prefetch_slot *prefetch_find(struct playlist *pls, int64_t seq_no)
+{
+    int i;
+
+    for (i = 0; i < pls->n_prefetch; i++) {
+        struct prefetch_slot *slot = &pls->prefetch[i];
+        if (slot->state != PREFETCH_IDLE && !slot->abort_request &&
+            slot->seq_no == seq_no)
+            return slot;
+    }
+    return NULL;
+}
+
+/* Queue the current segment and the ones following it on free slots.
+ * Called with prefetch_mutex held. */
+static int prefetch_schedule(HLSContext *c, struct playlist *pls)
+{
+    int64_t seq_no, last = FFMIN(pls->cur_seq_no + c->prefetch_segments,
+                                 pls->start_seq_no + pls->n_segments - 1);
+    int i, j = 0;
+
+    for (i = 0; i < pls->n_prefetch; i++) {
+        struct prefetch_slot *slot = &pls->prefetch[i];
+        if (slot != pls->input_slot &&
+            (slot->seq_no < pls->cur_seq_no || slot->seq_no > last))
+            prefetch_slot_release(slot);
+    }
+
+    for (seq_no = pls->cur_seq_no; seq_no <= last; seq_no++) {
+        struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+        struct prefetch_slot *slot;
+
+        if (prefetch_find(pls, seq_no))
+            continue;
+        while (j < pls->n_prefetch && pls->prefetch[j].state != PREFETCH_IDLE)
+            j++;
+        if (j == pls->n_prefetch)
+            break;
+        slot = &pls->prefetch[j];
+
+        slot->seg = *seg;
+        slot->seg.init_section = NULL;
+        slot->seg.url = av_strdup(seg->url);
+        slot->seg.key = seg->key ? av_strdup(seg->key) : NULL;
+        if (!slot->seg.url || (seg->key && !slot->seg.key) ||
+            av_dict_copy(&slot->opts, c->avio_opts, 0) < 0) {
+            prefetch_slot_reset(slot);
+            return AVERROR(ENOMEM);
+        }
+        slot->seq_no = seq_no;
+        slot->state  = PREFETCH_QUEUED;
+    }
+    pthread_cond_broadcast(&pls->prefetch_cond);
+    return 0;
+}
+
+/**
+ * Start reading the current segment from its prefetch slot, once the
+ * first data or the download result is available.
+ */
+static int prefetch_open_input(HLSContext *c, struct playlist *pls)
+{
+    struct prefetch_slot *slot;
+    int ret = 0;
+
+    if (!pls->n_prefetch && (ret = prefetch_init(c, pls)) < 0) {
+        prefetch_free(pls);
+        return ret;
+    }
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    for (;;) {
+        if ((ret = prefetch_schedule(c, pls)) < 0)
+            break;
+        slot = prefetch_find(pls, pls->cur_seq_no);
+        if (slot && (av_fifo_size(slot->fifo) || slot->state == PREFETCH_DONE))
+            break;
+        if (ff_check_interrupt(c->interrupt_callback)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_mutex);
+    }
+    if (ret >= 0) {
+        if (!av_fifo_size(slot->fifo) && slot->error < 0) {
+            ret = slot->error;
+            prefetch_slot_reset(slot);
+        } else {
+            pls->input_slot = slot;
+        }
+    }
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+
+    pls->cur_seg_offset = 0;
+    return ret;
+}
+
+static int prefetch_read(struct playlist *pls, uint8_t *buf, int buf_size)
+{
+    struct prefetch_slot *slot = pls->input_slot;
+    int ret;
+
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    while (!av_fifo_size(slot->fifo) && slot->state != PREFETCH_DONE)
+        pthread_cond_wait(&pls->prefetch_cond, &pls->prefetch_mutex);
+    if (av_fifo_size(slot->fifo)) {
+        ret = FFMIN(buf_size, av_fifo_size(slot->fifo));
+        av_fifo_generic_read(slot->fifo, buf, ret, NULL);
+        pthread_cond_broadcast(&pls->prefetch_cond);
+    } else {
+        ret = slot->error < 0 ? slot->error : AVERROR_EOF;
+    }
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+
+    return ret;
+}
+
+/* Done with the current segment; let its slot fetch another one. */
+static void prefetch_close_input(struct playlist *pls)
+{
+    pthread_mutex_lock(&pls->prefetch_mutex);
+    prefetch_slot_release(pls->input_slot);
+    pls->input_slot = NULL;
+    pthread_mutex_unlock(&pls->prefetch_mutex);
+}
+#endif
+
 static int read_from_url(struct playlist *pls, struct segment *seg,
                          uint8_t *buf, int buf_size)
 {
@@ -1021,6 +1529,11 @@ static int read_from_url(struct playlist *pls, struct segment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
+#if HAVE_THREADS
+    if (pls->input_slot)
+        ret = buf_size > 0 ? prefetch_read(pls, buf, buf_size) : 0;
+    else
+#endif
     ret = avio_read(pls->input, buf, buf_size);
     if (ret > 0)
         pls->cur_seg_offset += ret;
@@ -1436,7 +1949,7 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input || (c->http_persistent && v->input_read_done)) {
+    if ((!v->input && !v->input_slot) || (c->http_persistent && v->input_read_done)) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1507,6 +2020,11 @@ reload:
         if (ret)
             return ret;
 
+#if HAVE_THREADS
+        if (c->prefetch_segments) {
+            ret = prefetch_open_input(c, v);
+        } else
+#endif
         if (c->http_multiple == 1 && v->input_next_requested) {
             FFSWAP(AVIOContext *, v->input, v->input_next);
             v->cur_seg_offset = 0;
@@ -1527,7 +2045,7 @@ reload:
         just_opened = 1;
     }
 
-    if (c->http_multiple == -1) {
+    if (c->http_multiple == -1 && v->input) {
         uint8_t *http_version_opt = NULL;
         int r = av_opt_get(v->input, "http_version", AV_OPT_SEARCH_CHILDREN, &http_version_opt);
         if (r >= 0) {
@@ -1537,7 +2055,7 @@ reload:
     }
 
     seg = next_segment(v);
-    if (c->http_multiple == 1 && !v->input_next_requested &&
+    if (c->http_multiple == 1 && !v->input_next_requested && !v->input_slot &&
         seg && seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         ret = open_input(c, v, seg, &v->input_next);
         if (ret < 0) {
@@ -1570,6 +2088,11 @@ reload:
 
         return ret;
     }
+#if HAVE_THREADS
+    if (v->input_slot) {
+        prefetch_close_input(v);
+    } else
+#endif
     if (c->http_persistent &&
         seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         v->input_read_done = 1;
@@ -1845,6 +2368,10 @@ static int hls_close(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
 
+#if HAVE_THREADS
+    for (int i = 0; i < c->n_playlists; i++)
+        prefetch_free(c->playlists[i]);
+#endif
     free_playlist_list(c);
     free_variant_list(c);
     free_rendition_list(c);
@@ -1868,6 +2395,13 @@ static int hls_read_header(AVFormatContext *s)
     c->first_timestamp = AV_NOPTS_VALUE;
     c->cur_timestamp = AV_NOPTS_VALUE;
 
+#if !HAVE_THREADS
+    if (c->prefetch_segments) {
+        av_log(s, AV_LOG_WARNING, "Segment prefetch requires threads, disabling it\n");
+        c->prefetch_segments = 0;
+    }
+#endif
+
     if ((ret = save_avio_options(s)) < 0)
         goto fail;
 
@@ -2094,6 +2628,9 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             }
             av_log(s, AV_LOG_INFO, "Now receiving playlist %d, segment %"PRId64"\n", i, pls->cur_seq_no);
         } else if (first && !cur_needed && pls->needed) {
+#if HAVE_THREADS
+            prefetch_reset(pls);
+#endif
             ff_format_io_close(pls->parent, &pls->input);
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
@@ -2334,6 +2871,9 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
     for (i = 0; i < c->n_playlists; i++) {
         /* Reset reading */
         struct playlist *pls = c->playlists[i];
+#if HAVE_THREADS
+        prefetch_reset(pls);
+#endif
         ff_format_io_close(pls->parent, &pls->input);
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
@@ -2399,6 +2939,10 @@ static const AVOption hls_options[] = {
         OFFSET(http_multiple), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, FLAGS},
     {"http_seekable", "Use HTTP partial requests, 0 = disable, 1 = enable, -1 = auto",
         OFFSET(http_seekable), AV_OPT_TYPE_BOOL, { .i64 = -1}, -1, 1, FLAGS},
+    {"prefetch_segments", "Number of segments to download ahead of the one being read",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 32, FLAGS},
+    {"prefetch_buffer_size", "Maximum amount of data buffered for each prefetched segment",
+        OFFSET(prefetch_buffer_size), AV_OPT_TYPE_INT, {.i64 = 8 << 20}, 65536, INT_MAX, FLAGS},
     {NULL}
 };
 
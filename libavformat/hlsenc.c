@@ -73,6 +73,11 @@ typedef enum {
 #define BUFSIZE (16 * 1024)
 #define POSTFIX_PATTERN "_%d"
 
+typedef struct HLSPart {
+    double duration; /* in seconds */
+    int independent;
+} HLSPart;
+
 typedef struct HLSSegment {
     char filename[MAX_URL_SIZE];
     char sub_filename[MAX_URL_SIZE];
@@ -87,6 +92,9 @@ typedef struct HLSSegment {
     char key_uri[LINE_BUFFER_SIZE + 1];
     char iv_string[KEYSIZE*2 + 1];
 
+    HLSPart *parts;
+    int nb_parts;
+
     struct HLSSegment *next;
     double discont_program_date_time;
 } HLSSegment;
@@ -153,6 +161,13 @@ typedef struct VariantStream {
     HLSSegment *last_segment;
     HLSSegment *old_segments;
 
+    HLSPart *parts;         // completed parts of the segment being written
+    int nb_parts;
+    int part_pos;           // start of the current part in the segment buffer
+    int64_t part_start_pts; // in AV_TIME_BASE units
+    int64_t part_end_pts;
+    int part_independent;
+
     char *basename_tmp;
     char *basename;
     char *vtt_basename;
@@ -197,6 +212,8 @@ typedef struct HLSContext {
     uint32_t start_sequence_source_type;  // enum StartSequenceSourceType
 
     int64_t time;          // Set by a private option.
+    int64_t part_time;     // Set by a private option.
+    int can_block_reload;  // Set by a private option.
     int64_t init_time;     // Set by a private option.
     int max_nb_segments;   // Set by a private option.
     int hls_delete_threshold; // Set by a private option.
@@ -523,6 +540,36 @@ static int replace_int_data_in_filename(char **s, const char *filename, char pla
     return found_count;
 }
 
+/* Name parts after their segment, e.g. "out12.ts" -> "out12.part3.ts" */
+static char *get_part_filename(const char *filename, int part)
+{
+    const char *base = strrchr(filename, '/');
+    const char *ext  = strrchr(base ? base : filename, '.');
+
+    if (!ext)
+        return av_asprintf("%s.part%d", filename, part);
+    return av_asprintf("%.*s.part%d%s", (int)(ext - filename), filename, part, ext);
+}
+
+/* Name of a part of the segment currently being written, either as the
+ * output path or as it is referenced from the playlist. */
+static char *get_part_url(HLSContext *hls, VariantStream *vs, int part, int playlist)
+{
+    const char *url = vs->avf->url;
+    size_t len = strlen(url);
+    char *segment, *filename;
+
+    if ((hls->flags & HLS_TEMP_FILE) && len > 4 && !strcmp(url + len - 4, ".tmp"))
+        len -= 4;
+    segment = av_strndup(url, len);
+    if (!segment)
+        return NULL;
+    filename = get_part_filename(playlist && !hls->use_localtime_mkdir ?
+                                 av_basename(segment) : segment, part);
+    av_free(segment);
+    return filename;
+}
+
 static void write_styp(AVIOContext *pb)
 {
     avio_wb32(pb, 24);
@@ -551,6 +598,7 @@ static int flush_dynbuf(VariantStream *vs, int *range_length)
     avio_flush(vs->out);
 
     // re-open buffer
+    vs->part_pos = 0;
     return avio_open_dyn_buf(&ctx->pb);
 }
 
@@ -592,7 +640,7 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
 
     HLSSegment *segment, *previous_segment = NULL;
     float playlist_duration = 0.0f;
-    int ret = 0;
+    int ret = 0, i;
     int segment_cnt = 0;
     AVBPrint path;
     const char *dirname = NULL;
@@ -666,6 +714,18 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
         if (ret = hls_delete_file(hls, vs->avf, path.str, proto))
             goto fail;
 
+        for (i = 0; i < segment->nb_parts; i++) {
+            char *part = get_part_filename(path.str, i);
+            if (!part) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            ret = hls_delete_file(hls, vs->avf, part, proto);
+            av_free(part);
+            if (ret)
+                goto fail;
+        }
+
         if ((segment->sub_filename[0] != '\0')) {
             vtt_dirname_r = av_strdup(vs->vtt_avf->url);
             vtt_dirname = av_dirname(vtt_dirname_r);
@@ -686,6 +746,7 @@ static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
         av_bprint_clear(&path);
         previous_segment = segment;
         segment = previous_segment->next;
+        av_freep(&previous_segment->parts);
         av_freep(&previous_segment);
     }
 
@@ -1149,6 +1210,10 @@ static int hls_append_segment(struct AVFormatContext *s, HLSContext *hls,
     en->next     = NULL;
     en->discont  = 0;
     en->discont_program_date_time = 0;
+    en->parts    = vs->parts;
+    en->nb_parts = vs->nb_parts;
+    vs->parts    = NULL;
+    vs->nb_parts = 0;
 
     if (vs->discontinuity) {
         en->discont = 1;
@@ -1186,8 +1251,10 @@ static int hls_append_segment(struct AVFormatContext *s, HLSContext *hls,
             vs->old_segments = en;
             if ((ret = hls_delete_old_segments(s, hls, vs)) < 0)
                 return ret;
-        } else
+        } else {
+            av_freep(&en->parts);
             av_freep(&en);
+        }
     } else
         vs->nb_entries++;
 
@@ -1317,6 +1384,7 @@ static void hls_free_segments(HLSSegment *p)
     while (p) {
         en = p;
         p = p->next;
+        av_freep(&en->parts);
         av_freep(&en);
     }
 }
@@ -1543,7 +1611,8 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
     HLSContext *hls = s->priv_data;
     HLSSegment *en;
     int target_duration = 0;
-    int ret = 0;
+    double parts_duration = 0;
+    int ret = 0, i;
     char temp_filename[MAX_URL_SIZE];
     char temp_vtt_filename[MAX_URL_SIZE];
     int64_t sequence = FFMAX(hls->start_sequence, vs->sequence - vs->nb_entries);
@@ -1576,6 +1645,10 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
         hls->version = 7;
     }
 
+    if (hls->part_time > 0) {
+        hls->version = FFMAX(hls->version, 6);
+    }
+
     if (!is_file_proto && (hls->flags & HLS_TEMP_FILE) && !warned_non_file++)
         av_log(s, AV_LOG_ERROR, "Cannot use rename on non file protocol, this may lead to races and temporary partial files\n");
 
@@ -1590,6 +1663,12 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
     for (en = vs->segments; en; en = en->next) {
         if (target_duration <= en->duration)
             target_duration = lrint(en->duration);
+        parts_duration += en->duration;
+    }
+    if (hls->part_time > 0) {
+        target_duration = FFMAX(target_duration, lrint(hls->time / (double)AV_TIME_BASE));
+        /* Only the parts of the last three target durations are listed */
+        parts_duration -= 3 * target_duration;
     }
 
     vs->discontinuity_set = 0;
@@ -1603,7 +1682,12 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
     if (vs->has_video && (hls->flags & HLS_INDEPENDENT_SEGMENTS)) {
         avio_printf(byterange_mode ? hls->m3u8_out : vs->out, "#EXT-X-INDEPENDENT-SEGMENTS\n");
     }
+    if (hls->part_time > 0)
+        ff_hls_write_part_info(vs->out, hls->part_time / (double)AV_TIME_BASE,
+                               hls->can_block_reload);
     for (en = vs->segments; en; en = en->next) {
+        int discont = en->discont;
+
         if ((hls->encrypt || hls->key_info_file) && (!key_uri || strcmp(en->key_uri, key_uri) ||
                                     av_strcasecmp(en->iv_string, iv_string))) {
             avio_printf(byterange_mode ? hls->m3u8_out : vs->out, "#EXT-X-KEY:METHOD=AES-128,URI=\"%s\"", en->key_uri);
@@ -1619,7 +1703,24 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
                                    hls->flags & HLS_SINGLE_FILE, vs->init_range_length, 0);
         }
 
-        ret = ff_hls_write_file_entry(byterange_mode ? hls->m3u8_out : vs->out, en->discont, byterange_mode,
+        parts_duration -= en->duration;
+        if (en->nb_parts && parts_duration < 0) {
+            if (discont)
+                avio_printf(vs->out, "#EXT-X-DISCONTINUITY\n");
+            discont = 0;
+            for (i = 0; i < en->nb_parts; i++) {
+                char *filename = get_part_filename(en->filename, i);
+                if (!filename) {
+                    ret = AVERROR(ENOMEM);
+                    goto fail;
+                }
+                ff_hls_write_part(vs->out, en->parts[i].duration, hls->baseurl,
+                                  filename, en->parts[i].independent);
+                av_free(filename);
+            }
+        }
+
+        ret = ff_hls_write_file_entry(byterange_mode ? hls->m3u8_out : vs->out, discont, byterange_mode,
                                       en->duration, hls->flags & HLS_ROUND_DURATIONS,
                                       en->size, en->pos, hls->baseurl,
                                       en->filename,
@@ -1632,6 +1733,29 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
         }
     }
 
+    if (hls->part_time > 0 && !last) {
+        char *filename;
+
+        if (vs->nb_parts) {
+            if (hls->segment_type == SEGMENT_TYPE_FMP4 && !vs->segments)
+                ff_hls_write_init_file(vs->out, vs->fmp4_init_filename, 0, 0, 0);
+            if (vs->discontinuity)
+                avio_printf(vs->out, "#EXT-X-DISCONTINUITY\n");
+        }
+        for (i = 0; i <= vs->nb_parts; i++) {
+            if (!(filename = get_part_url(hls, vs, i, 1))) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            if (i < vs->nb_parts)
+                ff_hls_write_part(vs->out, vs->parts[i].duration, hls->baseurl,
+                                  filename, vs->parts[i].independent);
+            else
+                ff_hls_write_preload_hint(vs->out, hls->baseurl, filename);
+            av_free(filename);
+        }
+    }
+
     if (last && (hls->flags & HLS_OMIT_ENDLIST)==0)
         ff_hls_write_end_list(byterange_mode ? hls->m3u8_out : vs->out);
 
@@ -2415,6 +2539,107 @@ static int64_t append_single_file(AVFormatContext *s, VariantStream *vs)
 
     return ret;
 }
+
+/* Write the header buffered so far as the fmp4 init file */
+static int hls_init_file_flush(AVFormatContext *s, VariantStream *vs)
+{
+    HLSContext *hls = s->priv_data;
+    AVFormatContext *oc = vs->avf;
+    int byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
+    int range_length;
+
+    range_length = avio_close_dyn_buf(oc->pb, &vs->init_buffer);
+    if (range_length <= 0)
+        return AVERROR(EINVAL);
+    avio_write(vs->out, vs->init_buffer, range_length);
+    if (!hls->resend_init_file)
+        av_freep(&vs->init_buffer);
+    vs->init_range_length = range_length;
+    avio_open_dyn_buf(&oc->pb);
+    vs->part_pos = 0;
+    vs->packets_written = 0;
+    vs->start_pos = range_length;
+    if (!byterange_mode) {
+        hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
+    }
+    return 0;
+}
+
+/* Write out everything muxed since the last part boundary as a part file */
+static int hls_write_part(AVFormatContext *s, VariantStream *vs, int64_t end_pts)
+{
+    HLSContext *hls = s->priv_data;
+    AVFormatContext *oc = vs->avf;
+    AVDictionary *options = NULL;
+    const char *proto;
+    char *filename, *temp_filename;
+    uint8_t *buffer;
+    int size, use_temp_file, ret;
+
+    if (vs->part_start_pts == AV_NOPTS_VALUE)
+        return 0;
+
+    av_write_frame(oc, NULL); /* Flush any buffered data */
+    size = avio_get_dyn_buf(oc->pb, &buffer);
+
+    filename = get_part_url(hls, vs, vs->nb_parts, 0);
+    if (!filename)
+        return AVERROR(ENOMEM);
+    proto = avio_find_protocol_name(filename);
+    use_temp_file = proto && !strcmp(proto, "file") && (hls->flags & HLS_TEMP_FILE);
+    temp_filename = use_temp_file ? av_asprintf("%s.tmp", filename) : av_strdup(filename);
+    if (!temp_filename) {
+        av_free(filename);
+        return AVERROR(ENOMEM);
+    }
+
+    set_http_options(s, &options, hls);
+    ret = hlsenc_io_open(s, &vs->out, temp_filename, &options);
+    av_dict_free(&options);
+    if (ret >= 0) {
+        if (hls->segment_type == SEGMENT_TYPE_FMP4)
+            write_styp(vs->out);
+        avio_write(vs->out, buffer + vs->part_pos, size - vs->part_pos);
+        ret = hlsenc_io_close(s, &vs->out, temp_filename);
+        if (ret >= 0 && use_temp_file)
+            ret = ff_rename(temp_filename, filename, s);
+    }
+    if (ret < 0) {
+        av_log(s, hls->ignore_io_errors ? AV_LOG_WARNING : AV_LOG_ERROR,
+               "Failed to write part '%s'\n", filename);
+        ff_format_io_close(s, &vs->out);
+    }
+    av_free(temp_filename);
+    av_free(filename);
+    if (ret < 0 && !hls->ignore_io_errors)
+        return ret;
+
+    ret = av_reallocp_array(&vs->parts, vs->nb_parts + 1, sizeof(*vs->parts));
+    if (ret < 0) {
+        vs->nb_parts = 0;
+        return ret;
+    }
+    vs->parts[vs->nb_parts].duration    = (end_pts - vs->part_start_pts) / (double)AV_TIME_BASE;
+    vs->parts[vs->nb_parts].independent = vs->part_independent;
+    vs->nb_parts++;
+    vs->part_pos       = size;
+    vs->part_start_pts = AV_NOPTS_VALUE;
+
+    return 0;
+}
+
+static int hls_update_playlist(AVFormatContext *s, VariantStream *vs)
+{
+    int ret;
+
+    if ((ret = hls_window(s, 0, vs)) < 0) {
+        av_log(s, AV_LOG_WARNING, "upload playlist failed, will retry with a new http session.\n");
+        ff_format_io_close(s, &vs->out);
+        ret = hls_window(s, 0, vs);
+    }
+    return ret;
+}
+
 static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     HLSContext *hls = s->priv_data;
@@ -2506,25 +2731,21 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         int64_t new_start_pos;
         int byterange_mode = (hls->flags & HLS_SINGLE_FILE) || (hls->max_seg_size > 0);
 
+        if (hls->part_time > 0) {
+            ret = hls_write_part(s, vs, av_rescale_q(pkt->pts, st->time_base, AV_TIME_BASE_Q));
+            if (ret < 0)
+                return ret;
+        }
+
         av_write_frame(oc, NULL); /* Flush any buffered data */
         new_start_pos = avio_tell(oc->pb);
         vs->size = new_start_pos - vs->start_pos;
         avio_flush(oc->pb);
         if (hls->segment_type == SEGMENT_TYPE_FMP4) {
             if (!vs->init_range_length) {
-                range_length = avio_close_dyn_buf(oc->pb, &vs->init_buffer);
-                if (range_length <= 0)
-                    return AVERROR(EINVAL);
-                avio_write(vs->out, vs->init_buffer, range_length);
-                if (!hls->resend_init_file)
-                    av_freep(&vs->init_buffer);
-                vs->init_range_length = range_length;
-                avio_open_dyn_buf(&oc->pb);
-                vs->packets_written = 0;
-                vs->start_pos = range_length;
-                if (!byterange_mode) {
-                    hlsenc_io_close(s, &vs->out, vs->base_output_dirname);
-                }
+                ret = hls_init_file_flush(s, vs);
+                if (ret < 0)
+                    return ret;
             }
         }
         if (!byterange_mode) {
@@ -2622,14 +2843,11 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
         }
 
         // if we're building a VOD playlist, skip writing the manifest multiple times, and just wait until the end
-        if (hls->pl_type != PLAYLIST_TYPE_VOD) {
-            if ((ret = hls_window(s, 0, vs)) < 0) {
-                av_log(s, AV_LOG_WARNING, "upload playlist failed, will retry with a new http session.\n");
-                ff_format_io_close(s, &vs->out);
-                if ((ret = hls_window(s, 0, vs)) < 0) {
-                    av_freep(&old_filename);
-                    return ret;
-                }
+        // with parts, wait until the next segment is opened so its first part can be hinted
+        if (hls->pl_type != PLAYLIST_TYPE_VOD && !hls->part_time) {
+            if ((ret = hls_update_playlist(s, vs)) < 0) {
+                av_freep(&old_filename);
+                return ret;
             }
         }
 
@@ -2668,12 +2886,43 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
             return ret;
         }
 
+        if (hls->part_time > 0 && (ret = hls_update_playlist(s, vs)) < 0)
+            return ret;
+    }
+
+    if (hls->part_time > 0 && is_ref_pkt) {
+        int64_t pts = av_rescale_q(pkt->pts, st->time_base, AV_TIME_BASE_Q);
+        int64_t end = pts + av_rescale_q(pkt->duration, st->time_base, AV_TIME_BASE_Q);
+
+        /* Close the part before this packet if it would overrun the part target */
+        if (vs->part_start_pts != AV_NOPTS_VALUE && pts > vs->part_start_pts &&
+            (pkt->duration ? end - vs->part_start_pts > hls->part_time
+                           : pts - vs->part_start_pts >= hls->part_time)) {
+            if ((ret = hls_write_part(s, vs, pts)) < 0)
+                return ret;
+            if ((ret = hls_update_playlist(s, vs)) < 0)
+                return ret;
+        }
+        if (vs->part_start_pts == AV_NOPTS_VALUE) {
+            vs->part_start_pts   = pts;
+            vs->part_end_pts     = end;
+            vs->part_independent = !vs->has_video || (pkt->flags & AV_PKT_FLAG_KEY);
+        }
+        vs->part_end_pts = FFMAX(vs->part_end_pts, end);
     }
 
     vs->packets_written++;
     if (oc->pb) {
         int64_t keyframe_pre_pos = avio_tell(oc->pb);
         ret = ff_write_chained(oc, stream_index, pkt, s, 0);
+        /* Cut the init file as soon as the moov is out, so that it does
+         * not take the first fragment along with it */
+        if (ret >= 0 && hls->segment_type == SEGMENT_TYPE_FMP4 && !vs->init_range_length) {
+            av_write_frame(oc, NULL); /* Write the moov */
+            if ((ret = hls_init_file_flush(s, vs)) < 0)
+                return ret;
+            keyframe_pre_pos = 0;
+        }
         if ((st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) &&
             (pkt->flags & AV_PKT_FLAG_KEY) && !keyframe_pre_pos) {
             av_write_frame(oc, NULL); /* Flush any buffered data */
@@ -2698,6 +2947,7 @@ static void hls_deinit(AVFormatContext *s)
 
         av_freep(&vs->basename);
         av_freep(&vs->base_output_dirname);
+        av_freep(&vs->parts);
         av_freep(&vs->fmp4_init_filename);
         av_freep(&vs->vtt_basename);
         av_freep(&vs->vtt_m3u8_name);
@@ -2739,6 +2989,8 @@ static int hls_write_trailer(struct AVFormatContext *s)
         vs = &hls->var_streams[i];
         oc = vs->avf;
         vtt_oc = vs->vtt_avf;
+        if (hls->part_time > 0 && (ret = hls_write_part(s, vs, vs->part_end_pts)) < 0)
+            return ret;
         old_filename = av_strdup(oc->url);
         use_temp_file = 0;
 
@@ -2955,6 +3207,24 @@ static int hls_init(AVFormatContext *s)
                "enabled together. Disabling 'independent_segments' flag\n");
     }
 
+    if (hls->part_time > 0) {
+        if (hls->part_time > hls->time) {
+            av_log(s, AV_LOG_ERROR, "hls_part_time must not exceed hls_time\n");
+            return AVERROR(EINVAL);
+        }
+        if (hls->pl_type == PLAYLIST_TYPE_VOD) {
+            av_log(s, AV_LOG_ERROR, "hls_part_time cannot be used with VOD playlists\n");
+            return AVERROR(EINVAL);
+        }
+        if ((hls->flags & HLS_SINGLE_FILE) || hls->max_seg_size > 0 ||
+            hls->key_info_file || hls->encrypt ||
+            (hls->flags & (HLS_SECOND_LEVEL_SEGMENT_DURATION | HLS_SECOND_LEVEL_SEGMENT_SIZE))) {
+            av_log(s, AV_LOG_ERROR, "hls_part_time is not supported with byte range, "
+                   "encrypted or renamed segments\n");
+            return AVERROR_PATCHWELCOME;
+        }
+    }
+
     for (i = 0; i < hls->nb_varstreams; i++) {
         vs = &hls->var_streams[i];
 
@@ -2965,6 +3235,7 @@ static int hls_init(AVFormatContext *s)
         vs->sequence  = hls->start_sequence;
         vs->start_pts = AV_NOPTS_VALUE;
         vs->end_pts   = AV_NOPTS_VALUE;
+        vs->part_start_pts = AV_NOPTS_VALUE;
         vs->current_segment_final_filename_fmt[0] = '\0';
         vs->initial_prog_date_time = initial_program_date_time;
 
@@ -3116,6 +3387,8 @@ static const AVOption options[] = {
     {"start_number",  "set first number in the sequence",        OFFSET(start_sequence),AV_OPT_TYPE_INT64,  {.i64 = 0},     0, INT64_MAX, E},
     {"hls_time",      "set segment length",                      OFFSET(time),          AV_OPT_TYPE_DURATION, {.i64 = 2000000}, 0, INT64_MAX, E},
     {"hls_init_time", "set segment length at init list",         OFFSET(init_time),     AV_OPT_TYPE_DURATION, {.i64 = 0},       0, INT64_MAX, E},
+    {"hls_part_time", "set partial segment length for low-latency HLS", OFFSET(part_time), AV_OPT_TYPE_DURATION, {.i64 = 0},  0, INT64_MAX, E},
+    {"hls_can_block_reload", "announce that the server supports blocking playlist reloads", OFFSET(can_block_reload), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, E},
     {"hls_list_size", "set maximum number of playlist entries",  OFFSET(max_nb_segments),    AV_OPT_TYPE_INT,    {.i64 = 5},     0, INT_MAX, E},
     {"hls_delete_threshold", "set number of unreferenced segments to keep before deleting",  OFFSET(hls_delete_threshold),    AV_OPT_TYPE_INT,    {.i64 = 1},     1, INT_MAX, E},
     {"hls_ts_options","set hls mpegts list of options for the container format used for hls", OFFSET(format_options), AV_OPT_TYPE_DICT, {.str = NULL},  0, 0,    E},
@@ -165,6 +165,11 @@ struct AVFormatInternal {
      * Set if chapter ids are strictly monotonic.
      */
     int chapter_ids_monotonic;
+
+    /**
+     * Sidecar seek index, see AVFormatContext.seek_index.
+     */
+    struct SeekIndex *seek_index;
 };
 
 struct AVStreamInternal {
@@ -615,6 +620,37 @@ int ff_seek_frame_binary(AVFormatContext *s, int stream_index,
  */
 void ff_update_cur_dts(AVFormatContext *s, AVStream *ref_st, int64_t timestamp);
 
+typedef struct SeekIndex SeekIndex;
+
+/**
+ * Load the sidecar seek index named by s->seek_index, or prepare to build it
+ * while the input is read if it cannot be loaded.
+ */
+int ff_seek_index_open(AVFormatContext *s);
+
+/**
+ * Account for a packet returned by av_read_frame(), or its error code ret.
+ */
+void ff_seek_index_add(AVFormatContext *s, const AVPacket *pkt, int ret);
+
+/**
+ * Stop building the seek index, as a seek leaves parts of the input unread.
+ */
+void ff_seek_index_abort(AVFormatContext *s);
+
+/**
+ * Seek to the indexed keyframe closest to timestamp.
+ *
+ * @return >= 0 on success, < 0 if the index cannot serve the request
+ */
+int ff_seek_index_seek(AVFormatContext *s, int stream_index,
+                       int64_t timestamp, int flags);
+
+/**
+ * Write the seek index if it was built from the whole input, and free it.
+ */
+void ff_seek_index_close(AVFormatContext *s);
+
 int ff_find_last_ts(AVFormatContext *s, int stream_index, int64_t *ts, int64_t *pos,
                     int64_t (*read_timestamp)(struct AVFormatContext *, int , int64_t *, int64_t ));
 
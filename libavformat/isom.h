@@ -155,6 +155,20 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/**
+ * Position of one sample in the sample tables of a lazily indexed track.
+ */
+typedef struct MOVSampleCursor {
+    unsigned int sample;        ///< sample the cursor points to
+    unsigned int chunk;         ///< chunk containing the sample
+    unsigned int chunk_sample;  ///< index of the sample within its chunk
+    unsigned int stsc_index;    ///< stsc entry describing the chunk
+    unsigned int stts_index;    ///< stts entry describing the sample
+    unsigned int stts_sample;   ///< index of the sample within its stts entry
+    int64_t pos;                ///< file offset of the sample
+    int64_t dts;                ///< decoding timestamp of the sample
+} MOVSampleCursor;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int pb_is_copied;
@@ -235,6 +249,12 @@ typedef struct MOVStreamContext {
     uint32_t format;
 
     int has_sidx;  // If there is an sidx entry for this stream.
+
+    int lazy_index;                 ///< samples are resolved from the sample tables on demand
+    unsigned int lazy_sample_count; ///< number of samples reachable through the cursor
+    int64_t lazy_start_dts;         ///< decoding timestamp of the first sample
+    MOVSampleCursor cursor;
+    AVIndexEntry lazy_entry;        ///< the sample the cursor points to
     struct {
         struct AVAESCTR* aes_ctr;
         unsigned int per_sample_iv_size;  // Either 0, 8, or 16.
@@ -267,6 +287,7 @@ typedef struct MOVContext {
     int use_absolute_path;
     int ignore_editlist;
     int advanced_editlist;
+    int lazy_index;
     int ignore_chapters;
     int seek_individually;
     int64_t next_root_atom; ///< offset of the next root atom
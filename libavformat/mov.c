@@ -3377,6 +3377,345 @@ static int64_t add_ctts_entry(MOVStts** ctts_data, unsigned int* ctts_count, uns
 }
 
 #define MAX_REORDER_DELAY 16
+static void mov_check_stsz_sample_size(MOVContext *mov, MOVStreamContext *sc,
+                                       unsigned int chunk, unsigned int stsc_index)
+{
+    int64_t current_offset = sc->chunk_offsets[chunk];
+    int64_t next_offset = chunk + 1 < sc->chunk_count ? sc->chunk_offsets[chunk + 1] : INT64_MAX;
+
+    if (next_offset > current_offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
+        sc->stsc_data[stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - current_offset) {
+        av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
+        sc->stsz_sample_size = sc->sample_size;
+    }
+    if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
+        av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
+        sc->stsz_sample_size = sc->sample_size;
+    }
+}
+
+static void mov_free_sample_tables(MOVStreamContext *sc)
+{
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stts_data);
+    av_freep(&sc->stps_data);
+    av_freep(&sc->elst_data);
+    av_freep(&sc->rap_group);
+}
+
+/* Return the first chunk past the run of chunks described by an stsc entry. */
+static unsigned int mov_stsc_run_end(MOVStreamContext *sc, unsigned int index)
+{
+    return mov_stsc_index_valid(index, sc->stsc_count) ?
+           sc->stsc_data[index + 1].first - 1 : sc->chunk_count;
+}
+
+/* Check whether a sorted stss or stps table contains the given sample number. */
+static int mov_sync_table_has(const unsigned int *tab, unsigned int count, unsigned int n)
+{
+    unsigned int a = 0, b = count;
+
+    while (a < b) {
+        unsigned int m = a + (b - a) / 2;
+        if (tab[m] < n)
+            a = m + 1;
+        else
+            b = m;
+    }
+    return a < count && tab[a] == n;
+}
+
+static int mov_lazy_is_keyframe(AVStream *st, unsigned int sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int key_off = (sc->keyframe_count && sc->keyframes[0] > 0) || (sc->stps_count && sc->stps_data[0] > 0);
+
+    if (!sc->keyframe_absent &&
+        (!sc->keyframe_count ||
+         mov_sync_table_has((const unsigned int *)sc->keyframes, sc->keyframe_count, sample + key_off)))
+        return 1;
+    if (sc->stps_count && mov_sync_table_has(sc->stps_data, sc->stps_count, sample + key_off))
+        return 1;
+    return sc->keyframe_absent && !sc->stps_count &&
+           (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || !sample);
+}
+
+static void mov_lazy_cursor_reset(MOVStreamContext *sc)
+{
+    MOVSampleCursor *cur = &sc->cursor;
+
+    memset(cur, 0, sizeof(*cur));
+    cur->pos = sc->chunk_offsets[0];
+    cur->dts = sc->lazy_start_dts;
+}
+
+/**
+ * Move the cursor of a lazily indexed track to the given sample.
+ * Stepping to the next sample is O(1); longer jumps walk whole stts entries
+ * and runs of equally sized chunks, then the sample sizes within the target
+ * chunk. Moving backwards restarts from the first sample.
+ */
+static void mov_lazy_cursor_seek(MOVStreamContext *sc, unsigned int sample)
+{
+    MOVSampleCursor *cur = &sc->cursor;
+    unsigned int left;
+
+    if (sample < cur->sample)
+        mov_lazy_cursor_reset(sc);
+
+    for (left = sample - cur->sample; left; ) {
+        const MOVStts *e = &sc->stts_data[cur->stts_index];
+        int last = cur->stts_index + 1 >= sc->stts_count;
+        unsigned int n = last ? left : FFMIN(left, e->count - cur->stts_sample);
+
+        cur->dts         += (int64_t)n * e->duration;
+        cur->stts_sample += n;
+        left             -= n;
+        if (!last && cur->stts_sample == e->count) {
+            cur->stts_index++;
+            cur->stts_sample = 0;
+        }
+    }
+
+    while (sample - cur->sample >= sc->stsc_data[cur->stsc_index].count - cur->chunk_sample) {
+        unsigned int count = sc->stsc_data[cur->stsc_index].count;
+        unsigned int end   = mov_stsc_run_end(sc, cur->stsc_index);
+        unsigned int skip;
+
+        cur->sample += count - cur->chunk_sample;
+        cur->chunk++;
+        skip = FFMIN(end - cur->chunk, (sample - cur->sample) / count);
+        cur->chunk  += skip;
+        cur->sample += skip * count;
+        cur->chunk_sample = 0;
+        if (cur->chunk == end && mov_stsc_index_valid(cur->stsc_index, sc->stsc_count))
+            cur->stsc_index++;
+        cur->pos = sc->chunk_offsets[cur->chunk];
+    }
+
+    cur->chunk_sample += sample - cur->sample;
+    if (sc->stsz_sample_size > 0) {
+        cur->pos += (int64_t)(sample - cur->sample) * sc->stsz_sample_size;
+        cur->sample = sample;
+    }
+    for (; cur->sample < sample; cur->sample++)
+        cur->pos += (unsigned)sc->sample_sizes[cur->sample];
+}
+
+static void mov_lazy_fill_entry(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    const MOVSampleCursor *cur = &sc->cursor;
+    AVIndexEntry *e = &sc->lazy_entry;
+
+    e->pos          = cur->pos;
+    e->timestamp    = cur->dts;
+    e->size         = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[cur->sample];
+    e->min_distance = 0;
+    e->flags        = mov_lazy_is_keyframe(st, cur->sample) ? AVINDEX_KEYFRAME : 0;
+}
+
+static int mov_nb_samples(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    return sc->lazy_index ? sc->lazy_sample_count : st->internal->nb_index_entries;
+}
+
+/**
+ * Return the index entry of a sample, or NULL if there is no such sample.
+ * For lazily indexed tracks the entry is resolved from the sample tables and
+ * stays valid until the next call for the same stream.
+ */
+static AVIndexEntry *mov_get_sample(AVStream *st, int sample)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (sample < 0 || sample >= mov_nb_samples(st))
+        return NULL;
+    if (!sc->lazy_index)
+        return &st->internal->index_entries[sample];
+    if (sample != sc->cursor.sample) {
+        mov_lazy_cursor_seek(sc, sample);
+        mov_lazy_fill_entry(st);
+    }
+    return &sc->lazy_entry;
+}
+
+/* Number of samples with a dts below ts, or not above it if inclusive. */
+static unsigned int mov_lazy_count_samples(MOVStreamContext *sc, int64_t ts, int inclusive)
+{
+    int64_t dts = sc->lazy_start_dts;
+    unsigned int sample = 0, i;
+
+    for (i = 0; i < sc->stts_count && sample < sc->lazy_sample_count; i++) {
+        unsigned int count = sc->lazy_sample_count - sample;
+        int64_t duration = sc->stts_data[i].duration;
+        int64_t last;
+
+        if (i + 1 < sc->stts_count)
+            count = FFMIN(count, sc->stts_data[i].count);
+        last = dts + (count - 1) * duration;
+        if (ts < dts || (ts == dts && !inclusive))
+            break;
+        if (ts > last || (ts == last && inclusive)) {
+            sample += count;
+            dts    += count * duration;
+            continue;
+        }
+        // dts < ts <= last, so duration is positive here
+        return sample + (ts - dts) / duration + (inclusive || (ts - dts) % duration);
+    }
+    return sample;
+}
+
+/**
+ * Equivalent of av_index_search_timestamp() for lazily indexed tracks.
+ */
+static int mov_lazy_search_timestamp(AVStream *st, int64_t timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int backward = flags & AVSEEK_FLAG_BACKWARD;
+    int nb = sc->lazy_sample_count;
+    int m = backward ? (int)mov_lazy_count_samples(sc, timestamp, 1) - 1 :
+                       (int)mov_lazy_count_samples(sc, timestamp, 0);
+
+    if (!(flags & AVSEEK_FLAG_ANY))
+        while (m >= 0 && m < nb && !mov_lazy_is_keyframe(st, m))
+            m += backward ? -1 : 1;
+
+    return m == nb ? -1 : m;
+}
+
+static int mov_sync_table_is_sorted(const unsigned int *tab, unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 1; i < count; i++)
+        if (tab[i] <= tab[i - 1])
+            return 0;
+    return 1;
+}
+
+/**
+ * Check whether mov_fix_index() would leave the samples of a track untouched,
+ * i.e. whether the edit list has a single edit that starts at media time 0
+ * and covers the presentation time of every sample.
+ */
+static int mov_editlist_is_identity(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t dts = 0, max_pts = INT64_MIN, duration;
+    unsigned int stts_index = 0, stts_sample = 0;
+    unsigned int ctts_index = 0, ctts_sample = 0;
+    unsigned int i;
+
+    if (!sc->elst_count)
+        return 1;
+    if (sc->elst_count != 1 || sc->elst_data[0].time || mov->time_scale <= 0)
+        return 0;
+    duration = av_rescale(sc->elst_data[0].duration, sc->time_scale, mov->time_scale);
+
+    for (i = 0; i < sc->sample_count && stts_index < sc->stts_count; i++) {
+        int64_t pts = dts + sc->dts_shift;
+
+        if (ctts_index < sc->ctts_count) {
+            pts += sc->ctts_data[ctts_index].duration;
+            if (++ctts_sample >= sc->ctts_data[ctts_index].count) {
+                ctts_index++;
+                ctts_sample = 0;
+            }
+        }
+        if (pts < 0)
+            return 0;
+        max_pts = FFMAX(max_pts, pts);
+
+        dts += sc->stts_data[stts_index].duration;
+        if (++stts_sample >= sc->stts_data[stts_index].count) {
+            stts_index++;
+            stts_sample = 0;
+        }
+    }
+    return max_pts < duration;
+}
+
+/**
+ * Set up a track to resolve its samples from the sample tables on demand
+ * instead of expanding them into index entries.
+ *
+ * @return 1 on success, 0 if the track needs a full index
+ */
+static int mov_init_lazy_index(MOVContext *mov, AVStream *st, int64_t start_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    uint64_t stream_size = 0, total = 0;
+    unsigned int stsc_index = 0, i;
+
+    if (!mov->lazy_index || st->internal->nb_index_entries ||
+        (st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
+         st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO) ||
+        !sc->sample_count || sc->sample_count > INT_MAX ||
+        !sc->chunk_count || !sc->stts_count || !sc->stsc_count ||
+        (!sc->stsz_sample_size && !sc->sample_sizes) ||
+        (sc->rap_group_count && sc->rap_group) ||
+        !mov_sync_table_is_sorted((const unsigned int *)sc->keyframes, sc->keyframe_count) ||
+        !mov_sync_table_is_sorted(sc->stps_data, sc->stps_count))
+        return 0;
+    /* old uncompressed audio chunk demuxing */
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+        sc->stts_count == 1 && sc->stts_data[0].duration == 1)
+        return 0;
+    /* samples of other sample descriptions are left out of the index */
+    if (sc->pseudo_stream_id != -1)
+        for (i = 0; i < sc->stsc_count; i++)
+            if (sc->stsc_data[i].id - 1 != sc->pseudo_stream_id)
+                return 0;
+    /* negative durations need dts correction, empty entries stall the stts walk */
+    for (i = 0; i < sc->stts_count; i++)
+        if (sc->stts_data[i].duration < 0 ||
+            (!sc->stts_data[i].count && i + 1 < sc->stts_count))
+            return 0;
+
+    for (i = 0; i < sc->chunk_count; i++) {
+        while (mov_stsc_index_valid(stsc_index, sc->stsc_count) &&
+            i + 1 == sc->stsc_data[stsc_index + 1].first)
+            stsc_index++;
+        mov_check_stsz_sample_size(mov, sc, i, stsc_index);
+        total += sc->stsc_data[stsc_index].count;
+    }
+    if (total > sc->sample_count) {
+        av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+        total = sc->sample_count;
+    }
+
+    for (i = 0; i < total; i++) {
+        unsigned int sample_size = sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[i];
+        if (sample_size > 0x3FFFFFFF) {
+            av_log(mov->fc, AV_LOG_ERROR, "Sample size %u is too large\n", sample_size);
+            break;
+        }
+        stream_size += sample_size;
+    }
+
+    sc->lazy_index        = 1;
+    sc->lazy_sample_count = i;
+    sc->lazy_start_dts    = start_dts;
+    mov_lazy_cursor_reset(sc);
+    mov_lazy_fill_entry(st);
+
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+        for (i = 0; i < FFMIN(sc->lazy_sample_count, 99); i++)
+            ff_rfps_add_frame(mov->fc, st, mov_get_sample(st, i)->timestamp);
+
+    if (st->duration > 0)
+        st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
+
+    av_log(mov->fc, AV_LOG_DEBUG, "stream %d: %u samples indexed lazily\n",
+           st->index, sc->lazy_sample_count);
+    return 1;
+}
+
 static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
 {
     MOVStreamContext *msc = st->priv_data;
@@ -3392,15 +3731,16 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
 
     if (st->codecpar->video_delay <= 0 && msc->ctts_data &&
         st->codecpar->codec_id == AV_CODEC_ID_H264) {
+        int nb_samples = mov_nb_samples(st);
         st->codecpar->video_delay = 0;
-        for (ind = 0; ind < st->internal->nb_index_entries && ctts_ind < msc->ctts_count; ++ind) {
+        for (ind = 0; ind < nb_samples && ctts_ind < msc->ctts_count; ++ind) {
             // Point j to the last elem of the buffer and insert the current pts there.
             j = buf_start;
             buf_start = (buf_start + 1);
             if (buf_start == MAX_REORDER_DELAY + 1)
                 buf_start = 0;
 
-            pts_buf[j] = st->internal->index_entries[ind].timestamp + msc->ctts_data[ctts_ind].duration;
+            pts_buf[j] = mov_get_sample(st, ind)->timestamp + msc->ctts_data[ctts_ind].duration;
 
             // The timestamps that are already in the sorted buffer, and are greater than the
             // current pts, are exactly the timestamps that need to be buffered to output PTS
@@ -3789,11 +4129,10 @@ static void mov_fix_index(MOVContext *mov, AVStream *st)
     msc->current_index = msc->index_ranges[0].start;
 }
 
-static void mov_build_index(MOVContext *mov, AVStream *st)
+static void mov_build_index_entries(MOVContext *mov, AVStream *st, int64_t current_dts)
 {
     MOVStreamContext *sc = st->priv_data;
     int64_t current_offset;
-    int64_t current_dts = 0;
     unsigned int stts_index = 0;
     unsigned int stsc_index = 0;
     unsigned int stss_index = 0;
@@ -3803,45 +4142,6 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     MOVStts *ctts_data_old = sc->ctts_data;
     unsigned int ctts_count_old = sc->ctts_count;
 
-    if (sc->elst_count) {
-        int i, edit_start_index = 0, multiple_edits = 0;
-        int64_t empty_duration = 0; // empty duration of the first edit list entry
-        int64_t start_time = 0; // start time of the media
-
-        for (i = 0; i < sc->elst_count; i++) {
-            const MOVElst *e = &sc->elst_data[i];
-            if (i == 0 && e->time == -1) {
-                /* if empty, the first entry is the start time of the stream
-                 * relative to the presentation itself */
-                empty_duration = e->duration;
-                edit_start_index = 1;
-            } else if (i == edit_start_index && e->time >= 0) {
-                start_time = e->time;
-            } else {
-                multiple_edits = 1;
-            }
-        }
-
-        if (multiple_edits && !mov->advanced_editlist)
-            av_log(mov->fc, AV_LOG_WARNING, "multiple edit list entries, "
-                   "Use -advanced_editlist to correctly decode otherwise "
-                   "a/v desync might occur\n");
-
-        /* adjust first dts according to edit list */
-        if ((empty_duration || start_time) && mov->time_scale > 0) {
-            if (empty_duration)
-                empty_duration = av_rescale(empty_duration, sc->time_scale, mov->time_scale);
-            sc->time_offset = start_time - empty_duration;
-            sc->min_corrected_pts = start_time;
-            if (!mov->advanced_editlist)
-                current_dts = -sc->time_offset;
-        }
-
-        if (!multiple_edits && !mov->advanced_editlist &&
-            st->codecpar->codec_id == AV_CODEC_ID_AAC && start_time > 0)
-            sc->start_pad = start_time;
-    }
-
     /* only use old uncompressed audio chunk demuxing when stts specifies it */
     if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
           sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
@@ -3897,21 +4197,12 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
 
         for (i = 0; i < sc->chunk_count; i++) {
-            int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
             current_offset = sc->chunk_offsets[i];
             while (mov_stsc_index_valid(stsc_index, sc->stsc_count) &&
                 i + 1 == sc->stsc_data[stsc_index + 1].first)
                 stsc_index++;
 
-            if (next_offset > current_offset && sc->sample_size>0 && sc->sample_size < sc->stsz_sample_size &&
-                sc->stsc_data[stsc_index].count * (int64_t)sc->stsz_sample_size > next_offset - current_offset) {
-                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
-            if (sc->stsz_sample_size>0 && sc->stsz_sample_size < sc->sample_size) {
-                av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", sc->stsz_sample_size);
-                sc->stsz_sample_size = sc->sample_size;
-            }
+            mov_check_stsz_sample_size(mov, sc, i, stsc_index);
 
             for (j = 0; j < sc->stsc_data[stsc_index].count; j++) {
                 int keyframe = 0;
@@ -4100,15 +4391,95 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
             }
         }
     }
+}
+
+/**
+ * Expand the sample tables of a lazily indexed track into index entries,
+ * for code that edits the index.
+ */
+static void mov_materialize_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (!sc->lazy_index)
+        return;
+
+    sc->lazy_index = 0;
+    mov_build_index_entries(mov, st, sc->lazy_start_dts + sc->dts_shift);
+    mov_free_sample_tables(sc);
+
+    /* ctts now has one entry per sample */
+    if (sc->ctts_data) {
+        sc->ctts_index  = sc->current_sample;
+        sc->ctts_sample = 0;
+    }
+}
+
+static void mov_build_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    AVIndexEntry *first;
+    int64_t current_dts = 0;
+    int64_t start_time = 0; // start time of the media
+    int multiple_edits = 0;
+
+    if (sc->elst_count) {
+        int i, edit_start_index = 0;
+        int64_t empty_duration = 0; // empty duration of the first edit list entry
+
+        for (i = 0; i < sc->elst_count; i++) {
+            const MOVElst *e = &sc->elst_data[i];
+            if (i == 0 && e->time == -1) {
+                /* if empty, the first entry is the start time of the stream
+                 * relative to the presentation itself */
+                empty_duration = e->duration;
+                edit_start_index = 1;
+            } else if (i == edit_start_index && e->time >= 0) {
+                start_time = e->time;
+            } else {
+                multiple_edits = 1;
+            }
+        }
+
+        if (multiple_edits && !mov->advanced_editlist)
+            av_log(mov->fc, AV_LOG_WARNING, "multiple edit list entries, "
+                   "Use -advanced_editlist to correctly decode otherwise "
+                   "a/v desync might occur\n");
+
+        /* adjust first dts according to edit list */
+        if ((empty_duration || start_time) && mov->time_scale > 0) {
+            if (empty_duration)
+                empty_duration = av_rescale(empty_duration, sc->time_scale, mov->time_scale);
+            sc->time_offset = start_time - empty_duration;
+            sc->min_corrected_pts = start_time;
+            if (!mov->advanced_editlist)
+                current_dts = -sc->time_offset;
+        }
+
+        if (!multiple_edits && !mov->advanced_editlist &&
+            st->codecpar->codec_id == AV_CODEC_ID_AAC && start_time > 0)
+            sc->start_pad = start_time;
+    }
+
+    /* samples trimmed by the edit list are only dropped from a full index */
+    if (multiple_edits ||
+        (!mov->ignore_editlist && mov->advanced_editlist &&
+         !mov_editlist_is_identity(mov, st)) ||
+        !mov_init_lazy_index(mov, st, -sc->time_offset - sc->dts_shift)) {
+        mov_build_index_entries(mov, st, current_dts);
 
-    if (!mov->ignore_editlist && mov->advanced_editlist) {
-        // Fix index according to edit lists.
-        mov_fix_index(mov, st);
+        if (!mov->ignore_editlist && mov->advanced_editlist) {
+            // Fix index according to edit lists.
+            mov_fix_index(mov, st);
+        }
+    } else if (st->codecpar->codec_id == AV_CODEC_ID_AAC && start_time > 0) {
+        sc->start_pad = start_time;
     }
 
     // Update start time of the stream.
-    if (st->start_time == AV_NOPTS_VALUE && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->internal->nb_index_entries > 0) {
-        st->start_time = st->internal->index_entries[0].timestamp + sc->dts_shift;
+    if (st->start_time == AV_NOPTS_VALUE && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO &&
+        (first = mov_get_sample(st, 0))) {
+        st->start_time = first->timestamp + sc->dts_shift;
         if (sc->ctts_data) {
             st->start_time += sc->ctts_data[0].duration;
         }
@@ -4345,14 +4716,9 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             st->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
-    av_freep(&sc->elst_data);
-    av_freep(&sc->rap_group);
+    /* Do not need those anymore, unless samples are looked up on demand. */
+    if (!sc->lazy_index)
+        mov_free_sample_tables(sc);
 
     return 0;
 }
@@ -4800,6 +5166,8 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
 
+    mov_materialize_index(c, st);
+
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
     //
@@ -7220,10 +7588,10 @@ static void mov_read_chapters(AVFormatContext *s)
         cur_pos = avio_tell(sc->pb);
 
         if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            AVIndexEntry *sample = mov_get_sample(st, 0);
             st->disposition |= AV_DISPOSITION_ATTACHED_PIC | AV_DISPOSITION_TIMED_THUMBNAILS;
-            if (st->internal->nb_index_entries) {
+            if (sample) {
                 // Retrieve the first frame, if possible
-                AVIndexEntry *sample = &st->internal->index_entries[0];
                 if (avio_seek(sc->pb, sample->pos, SEEK_SET) != sample->pos) {
                     av_log(s, AV_LOG_ERROR, "Failed to retrieve first frame\n");
                     goto finish;
@@ -7236,6 +7604,7 @@ static void mov_read_chapters(AVFormatContext *s)
                 st->attached_pic.flags       |= AV_PKT_FLAG_KEY;
             }
         } else {
+            mov_materialize_index(mov, st);
             st->codecpar->codec_type = AVMEDIA_TYPE_DATA;
             st->codecpar->codec_id = AV_CODEC_ID_BIN_DATA;
             st->discard = AVDISCARD_ALL;
@@ -7807,8 +8176,8 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->internal->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->internal->index_entries[msc->current_sample];
+        AVIndexEntry *current_sample = mov_get_sample(avst, msc->current_sample);
+        if (msc->pb && current_sample) {
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!(s->pb->seekable & AVIO_SEEKABLE_NORMAL) && current_sample->pos < sample->pos) ||
@@ -7916,7 +8285,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    AVIndexEntry *sample, lazy_sample;
     AVStream *st = NULL;
     int64_t current_index;
     int ret;
@@ -7931,6 +8300,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         goto retry;
     }
     sc = st->priv_data;
+    /* the entry of a lazily indexed track is overwritten by the next lookup */
+    if (sc->lazy_index) {
+        lazy_sample = *sample;
+        sample = &lazy_sample;
+    }
     /* must be done just before reading, to avoid infinite loop on sample */
     current_index = sc->current_index;
     mov_current_sample_inc(sc);
@@ -8011,8 +8385,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             sc->ctts_sample = 0;
         }
     } else {
-        int64_t next_dts = (sc->current_sample < st->internal->nb_index_entries) ?
-            st->internal->index_entries[sc->current_sample].timestamp : st->duration;
+        AVIndexEntry *next = mov_get_sample(st, sc->current_sample);
+        int64_t next_dts = next ? next->timestamp : st->duration;
 
         if (next_dts >= pkt->dts)
             pkt->duration = next_dts - pkt->dts;
@@ -8080,6 +8454,7 @@ static int mov_seek_fragment(AVFormatContext *s, AVStream *st, int64_t timestamp
 static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp, int flags)
 {
     MOVStreamContext *sc = st->priv_data;
+    AVIndexEntry *first;
     int sample, time_sample, ret;
     unsigned int i;
 
@@ -8091,9 +8466,12 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     if (ret < 0)
         return ret;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sc->lazy_index)
+        sample = mov_lazy_search_timestamp(st, timestamp, flags);
+    else
+        sample = av_index_search_timestamp(st, timestamp, flags);
     av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->internal->nb_index_entries && timestamp < st->internal->index_entries[0].timestamp)
+    if (sample < 0 && (first = mov_get_sample(st, 0)) && timestamp < first->timestamp)
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -8134,13 +8512,14 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
 static int64_t mov_get_skip_samples(AVStream *st, int sample)
 {
     MOVStreamContext *sc = st->priv_data;
-    int64_t first_ts = st->internal->index_entries[0].timestamp;
-    int64_t ts = st->internal->index_entries[sample].timestamp;
-    int64_t off;
+    int64_t first_ts, ts, off;
 
     if (st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
         return 0;
 
+    first_ts = mov_get_sample(st, 0)->timestamp;
+    ts       = mov_get_sample(st, sample)->timestamp;
+
     /* compute skip samples according to stream start_pad, seek ts and first ts */
     off = av_rescale_q(ts - first_ts, st->time_base,
                        (AVRational){1, st->codecpar->sample_rate});
@@ -8164,7 +8543,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = st->internal->index_entries[sample].timestamp;
+        int64_t seek_timestamp = mov_get_sample(st, sample)->timestamp;
         st->internal->skip_samples = mov_get_skip_samples(st, sample);
 
         for (i = 0; i < s->nb_streams; i++) {
@@ -8217,6 +8596,10 @@ static const AVOption mov_options[] = {
         "Modify the AVIndex according to the editlists. Use this option to decode in the order specified by the edits.",
         OFFSET(advanced_editlist), AV_OPT_TYPE_BOOL, {.i64 = 1},
         0, 1, FLAGS},
+    {"lazy_index",
+        "Resolve samples from the sample tables on demand instead of building a full index.",
+        OFFSET(lazy_index), AV_OPT_TYPE_BOOL, {.i64 = 0},
+        0, 1, FLAGS},
     {"ignore_chapters", "", OFFSET(ignore_chapters), AV_OPT_TYPE_BOOL, {.i64 = 0},
         0, 1, FLAGS},
     {"use_mfra_for",
@@ -42,7 +42,10 @@
 #include "libavcodec/vc1_common.h"
 #include "libavcodec/raw.h"
 #include "internal.h"
+#include "os_support.h"
 #include "libavutil/avstring.h"
+#include "libavutil/internal.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/intfloat.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/libm.h"
@@ -57,6 +60,12 @@
 #include "rtpenc.h"
 #include "mov_chan.h"
 #include "vpcc.h"
+#if HAVE_IO_H
+#include <io.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 static const AVOption options[] = {
     { "movflags", "MOV muxer flags", offsetof(MOVMuxContext, flags), AV_OPT_TYPE_FLAGS, {.i64 = 0}, INT_MIN, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM, "movflags" },
@@ -107,6 +116,7 @@ static const AVOption options[] = {
     { "wallclock", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = MOV_PRFT_SRC_WALLCLOCK}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "prft"},
     { "pts", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = MOV_PRFT_SRC_PTS}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "prft"},
     { "empty_hdlr_name", "write zero-length name string in hdlr atoms within mdia and minf atoms", offsetof(MOVMuxContext, empty_hdlr_name), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
+    { "spill_sample_table", "keep the sample tables in a temporary file instead of memory", offsetof(MOVMuxContext, spill_sample_table), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
@@ -142,9 +152,118 @@ static int64_t update_size(AVIOContext *pb, int64_t pos)
     return curpos - pos;
 }
 
-static int co64_required(const MOVTrack *track)
+/* Size of an index entry in the spill file: pos, dts, size, cts, entries,
+ * samples_in_chunk, chunkNum and flags. */
+#define MOV_SPILL_ENTRY_SIZE 37
+
+static void spill_write_entry(uint8_t *buf, const MOVIentry *e)
+{
+    AV_WB64(buf,      e->pos);
+    AV_WB64(buf +  8, e->dts);
+    AV_WB32(buf + 16, e->size);
+    AV_WB32(buf + 20, e->cts);
+    AV_WB32(buf + 24, e->entries);
+    AV_WB32(buf + 28, e->samples_in_chunk);
+    AV_WB32(buf + 32, e->chunkNum);
+    buf[36] = e->flags;
+}
+
+static void spill_read_entry(MOVIentry *e, const uint8_t *buf)
+{
+    memset(e, 0, sizeof(*e));
+    e->pos              = AV_RB64(buf);
+    e->dts              = AV_RB64(buf +  8);
+    e->size             = AV_RB32(buf + 16);
+    e->cts              = (int32_t)AV_RB32(buf + 20);
+    e->entries          = AV_RB32(buf + 24);
+    e->samples_in_chunk = AV_RB32(buf + 28);
+    e->chunkNum         = AV_RB32(buf + 32);
+    e->flags            = buf[36];
+    e->pts              = e->dts + e->cts;
+}
+
+/**
+ * Get index entry idx of a track. Entries that have been moved to the
+ * spill file are read back in windows of MOV_INDEX_CLUSTER_SIZE entries;
+ * the returned pointer is only valid until the next call.
+ */
+static MOVIentry *get_cluster(MOVTrack *track, int idx)
+{
+    int i, start, count;
+
+    if (idx >= track->entries_spilled)
+        return &track->cluster[idx - track->entries_spilled];
+
+    if (idx >= track->spill_window_start &&
+        idx <  track->spill_window_start + track->spill_window_count)
+        return &track->spill_window[idx - track->spill_window_start];
+
+    /* Start one entry early, so that a forward walk which also looks at
+     * the next entry does not reload the window at every boundary. */
+    start = FFMAX(idx - 1, 0);
+    count = FFMIN(track->entries_spilled - start, MOV_INDEX_CLUSTER_SIZE);
+    if (lseek(track->spill_fd, (int64_t)start * MOV_SPILL_ENTRY_SIZE, SEEK_SET) < 0 ||
+        read(track->spill_fd, track->spill_buf, count * MOV_SPILL_ENTRY_SIZE) !=
+        count * MOV_SPILL_ENTRY_SIZE) {
+        track->spill_error = AVERROR(EIO);
+        memset(track->spill_buf, 0, count * MOV_SPILL_ENTRY_SIZE);
+    }
+    for (i = 0; i < count; i++)
+        spill_read_entry(&track->spill_window[i],
+                         track->spill_buf + i * MOV_SPILL_ENTRY_SIZE);
+    track->spill_window_start = start;
+    track->spill_window_count = count;
+
+    return &track->spill_window[idx - start];
+}
+
+static void set_chunk_samples(MOVTrack *trk)
+{
+    uint8_t buf[4];
+
+    if (trk->chunk_start >= trk->entries_spilled) {
+        trk->cluster[trk->chunk_start - trk->entries_spilled].samples_in_chunk = trk->chunk_samples;
+        return;
+    }
+
+    AV_WB32(buf, trk->chunk_samples);
+    if (lseek(trk->spill_fd, (int64_t)trk->chunk_start * MOV_SPILL_ENTRY_SIZE + 28, SEEK_SET) < 0 ||
+        write(trk->spill_fd, buf, sizeof(buf)) != sizeof(buf))
+        trk->spill_error = AVERROR(EIO);
+    trk->spill_window_count = 0;
+}
+
+/**
+ * Assign the entries before end to chunks. A chunk is a run of samples
+ * stored back to back, limited to 1 MiB. The sample count of the last
+ * chunk is only set by build_chunks(), since it may still grow.
+ */
+static void update_chunks(MOVTrack *trk, int end)
+{
+    int i;
+
+    for (i = trk->chunk_built; i < end; i++) {
+        MOVIentry *e = &trk->cluster[i - trk->entries_spilled];
+        if (i && trk->chunk_pos + trk->chunk_size == e->pos &&
+            trk->chunk_size + e->size < (1<<20)) {
+            trk->chunk_size    += e->size;
+            trk->chunk_samples += e->entries;
+        } else {
+            if (i)
+                set_chunk_samples(trk);
+            e->chunkNum        = ++trk->chunkCount;
+            trk->chunk_start   = i;
+            trk->chunk_pos     = e->pos;
+            trk->chunk_size    = e->size;
+            trk->chunk_samples = e->samples_in_chunk;
+        }
+    }
+    trk->chunk_built = end;
+}
+
+static int co64_required(MOVTrack *track)
 {
-    if (track->entry > 0 && track->cluster[track->entry - 1].pos + track->data_offset > UINT32_MAX)
+    if (track->entry > 0 && get_cluster(track, track->entry - 1)->pos + track->data_offset > UINT32_MAX)
         return 1;
     return 0;
 }
@@ -179,12 +298,13 @@ static int mov_write_stco_tag(AVIOContext *pb, MOVTrack *track)
     avio_wb32(pb, 0); /* version & flags */
     avio_wb32(pb, track->chunkCount); /* entry count */
     for (i = 0; i < track->entry; i++) {
-        if (!track->cluster[i].chunkNum)
+        MOVIentry *e = get_cluster(track, i);
+        if (!e->chunkNum)
             continue;
         if (mode64 == 1)
-            avio_wb64(pb, track->cluster[i].pos + track->data_offset);
+            avio_wb64(pb, e->pos + track->data_offset);
         else
-            avio_wb32(pb, track->cluster[i].pos + track->data_offset);
+            avio_wb32(pb, e->pos + track->data_offset);
     }
     return update_size(pb, pos);
 }
@@ -201,14 +321,16 @@ static int mov_write_stsz_tag(AVIOContext *pb, MOVTrack *track)
     avio_wb32(pb, 0); /* version & flags */
 
     for (i = 0; i < track->entry; i++) {
-        tst = track->cluster[i].size / track->cluster[i].entries;
+        MOVIentry *e = get_cluster(track, i);
+        tst = e->size / e->entries;
         if (oldtst != -1 && tst != oldtst)
             equalChunks = 0;
         oldtst = tst;
-        entries += track->cluster[i].entries;
+        entries += e->entries;
     }
     if (equalChunks && track->entry) {
-        int sSize = track->entry ? track->cluster[0].size / track->cluster[0].entries : 0;
+        MOVIentry *e = get_cluster(track, 0);
+        int sSize = track->entry ? e->size / e->entries : 0;
         sSize = FFMAX(1, sSize); // adpcm mono case could make sSize == 0
         avio_wb32(pb, sSize); // sample size
         avio_wb32(pb, entries); // sample count
@@ -216,9 +338,9 @@ static int mov_write_stsz_tag(AVIOContext *pb, MOVTrack *track)
         avio_wb32(pb, 0); // sample size
         avio_wb32(pb, entries); // sample count
         for (i = 0; i < track->entry; i++) {
-            for (j = 0; j < track->cluster[i].entries; j++) {
-                avio_wb32(pb, track->cluster[i].size /
-                          track->cluster[i].entries);
+            MOVIentry *e = get_cluster(track, i);
+            for (j = 0; j < e->entries; j++) {
+                avio_wb32(pb, e->size / e->entries);
             }
         }
     }
@@ -238,11 +360,12 @@ static int mov_write_stsc_tag(AVIOContext *pb, MOVTrack *track)
     entryPos = avio_tell(pb);
     avio_wb32(pb, track->chunkCount); // entry count
     for (i = 0; i < track->entry; i++) {
-        if (oldval != track->cluster[i].samples_in_chunk && track->cluster[i].chunkNum) {
-            avio_wb32(pb, track->cluster[i].chunkNum); // first chunk
-            avio_wb32(pb, track->cluster[i].samples_in_chunk); // samples per chunk
+        MOVIentry *e = get_cluster(track, i);
+        if (oldval != e->samples_in_chunk && e->chunkNum) {
+            avio_wb32(pb, e->chunkNum); // first chunk
+            avio_wb32(pb, e->samples_in_chunk); // samples per chunk
             avio_wb32(pb, 0x1); // sample description index
-            oldval = track->cluster[i].samples_in_chunk;
+            oldval = e->samples_in_chunk;
             index++;
         }
     }
@@ -266,7 +389,7 @@ static int mov_write_stss_tag(AVIOContext *pb, MOVTrack *track, uint32_t flag)
     entryPos = avio_tell(pb);
     avio_wb32(pb, track->entry); // entry count
     for (i = 0; i < track->entry; i++) {
-        if (track->cluster[i].flags & flag) {
+        if (get_cluster(track, i)->flags & flag) {
             avio_wb32(pb, i + 1);
             index++;
         }
@@ -288,12 +411,13 @@ static int mov_write_sdtp_tag(AVIOContext *pb, MOVTrack *track)
     ffio_wfourcc(pb, "sdtp");
     avio_wb32(pb, 0); // version & flags
     for (i = 0; i < track->entry; i++) {
+        uint32_t flags = get_cluster(track, i)->flags;
         dependent = MOV_SAMPLE_DEPENDENCY_YES;
         leading = reference = redundancy = MOV_SAMPLE_DEPENDENCY_UNKNOWN;
-        if (track->cluster[i].flags & MOV_DISPOSABLE_SAMPLE) {
+        if (flags & MOV_DISPOSABLE_SAMPLE) {
             reference = MOV_SAMPLE_DEPENDENCY_NO;
         }
-        if (track->cluster[i].flags & MOV_SYNC_SAMPLE) {
+        if (flags & MOV_SYNC_SAMPLE) {
             dependent = MOV_SAMPLE_DEPENDENCY_NO;
         }
         avio_w8(pb, (leading << 6)   | (dependent << 4) |
@@ -632,7 +756,7 @@ static unsigned compute_avg_bitrate(MOVTrack *track)
     if (!track->track_duration)
         return 0;
     for (i = 0; i < track->entry; i++)
-        size += track->cluster[i].size;
+        size += get_cluster(track, i)->size;
     return size * 8 * track->timescale / track->track_duration;
 }
 
@@ -1063,9 +1187,12 @@ static int get_cluster_duration(MOVTrack *track, int cluster_idx)
     if (cluster_idx + 1 == track->entry)
         next_dts = track->track_duration + track->start_dts;
     else
-        next_dts = track->cluster[cluster_idx + 1].dts;
+        next_dts = get_cluster(track, cluster_idx + 1)->dts;
+
+    next_dts -= get_cluster(track, cluster_idx)->dts;
 
-    next_dts -= track->cluster[cluster_idx].dts;
+    if (track->spill_error)
+        return 0;
 
     av_assert0(next_dts >= 0);
     av_assert0(next_dts <= INT_MAX);
@@ -2432,87 +2559,83 @@ static int mov_write_stsd_tag(AVFormatContext *s, AVIOContext *pb, MOVMuxContext
 static int mov_write_ctts_tag(AVFormatContext *s, AVIOContext *pb, MOVTrack *track)
 {
     MOVMuxContext *mov = s->priv_data;
-    MOVStts *ctts_entries;
-    uint32_t entries = 0;
-    uint32_t atom_size;
-    int i;
+    uint32_t entries = 0, count = 1;
+    int64_t pos = avio_tell(pb), entryPos, curpos;
+    int i, cts;
 
-    ctts_entries = av_malloc_array((track->entry + 1), sizeof(*ctts_entries)); /* worst case */
-    if (!ctts_entries)
-        return AVERROR(ENOMEM);
-    ctts_entries[0].count = 1;
-    ctts_entries[0].duration = track->cluster[0].cts;
-    for (i = 1; i < track->entry; i++) {
-        if (track->cluster[i].cts == ctts_entries[entries].duration) {
-            ctts_entries[entries].count++; /* compress */
-        } else {
-            entries++;
-            ctts_entries[entries].duration = track->cluster[i].cts;
-            ctts_entries[entries].count = 1;
-        }
-    }
-    entries++; /* last one */
-    atom_size = 16 + (entries * 8);
-    avio_wb32(pb, atom_size); /* size */
+    avio_wb32(pb, 0); /* size */
     ffio_wfourcc(pb, "ctts");
     if (mov->flags & FF_MOV_FLAG_NEGATIVE_CTS_OFFSETS)
         avio_w8(pb, 1); /* version */
     else
         avio_w8(pb, 0); /* version */
     avio_wb24(pb, 0); /* flags */
-    avio_wb32(pb, entries); /* entry count */
-    for (i = 0; i < entries; i++) {
-        avio_wb32(pb, ctts_entries[i].count);
-        avio_wb32(pb, ctts_entries[i].duration);
+    entryPos = avio_tell(pb);
+    avio_wb32(pb, 0); /* entry count */
+    cts = get_cluster(track, 0)->cts;
+    for (i = 1; i < track->entry; i++) {
+        int next_cts = get_cluster(track, i)->cts;
+        if (next_cts == cts) {
+            count++; /* compress */
+        } else {
+            avio_wb32(pb, count);
+            avio_wb32(pb, cts);
+            entries++;
+            cts   = next_cts;
+            count = 1;
+        }
     }
-    av_free(ctts_entries);
-    return atom_size;
+    avio_wb32(pb, count); /* last one */
+    avio_wb32(pb, cts);
+    entries++;
+    curpos = avio_tell(pb);
+    avio_seek(pb, entryPos, SEEK_SET);
+    avio_wb32(pb, entries); // rewrite size
+    avio_seek(pb, curpos, SEEK_SET);
+    return update_size(pb, pos);
 }
 
 /* Time to sample atom */
 static int mov_write_stts_tag(AVIOContext *pb, MOVTrack *track)
 {
-    MOVStts *stts_entries = NULL;
-    uint32_t entries = -1;
-    uint32_t atom_size;
-    int i;
+    uint32_t entries = 0, count = 0;
+    int64_t pos = avio_tell(pb), entryPos, curpos;
+    int i, duration = 0;
 
+    avio_wb32(pb, 0); /* size */
+    ffio_wfourcc(pb, "stts");
+    avio_wb32(pb, 0); /* version & flags */
+    entryPos = avio_tell(pb);
+    avio_wb32(pb, 0); /* entry count */
     if (track->par->codec_type == AVMEDIA_TYPE_AUDIO && !track->audio_vbr) {
-        stts_entries = av_malloc(sizeof(*stts_entries)); /* one entry */
-        if (!stts_entries)
-            return AVERROR(ENOMEM);
-        stts_entries[0].count = track->sample_count;
-        stts_entries[0].duration = 1;
+        avio_wb32(pb, track->sample_count); /* one entry */
+        avio_wb32(pb, 1);
         entries = 1;
     } else {
-        if (track->entry) {
-            stts_entries = av_malloc_array(track->entry, sizeof(*stts_entries)); /* worst case */
-            if (!stts_entries)
-                return AVERROR(ENOMEM);
-        }
         for (i = 0; i < track->entry; i++) {
-            int duration = get_cluster_duration(track, i);
-            if (i && duration == stts_entries[entries].duration) {
-                stts_entries[entries].count++; /* compress */
+            int next_duration = get_cluster_duration(track, i);
+            if (i && next_duration == duration) {
+                count++; /* compress */
             } else {
+                if (i) {
+                    avio_wb32(pb, count);
+                    avio_wb32(pb, duration);
+                }
                 entries++;
-                stts_entries[entries].duration = duration;
-                stts_entries[entries].count = 1;
+                duration = next_duration;
+                count    = 1;
             }
         }
-        entries++; /* last one */
-    }
-    atom_size = 16 + (entries * 8);
-    avio_wb32(pb, atom_size); /* size */
-    ffio_wfourcc(pb, "stts");
-    avio_wb32(pb, 0); /* version & flags */
-    avio_wb32(pb, entries); /* entry count */
-    for (i = 0; i < entries; i++) {
-        avio_wb32(pb, stts_entries[i].count);
-        avio_wb32(pb, stts_entries[i].duration);
+        if (entries) { /* last one */
+            avio_wb32(pb, count);
+            avio_wb32(pb, duration);
+        }
     }
-    av_free(stts_entries);
-    return atom_size;
+    curpos = avio_tell(pb);
+    avio_seek(pb, entryPos, SEEK_SET);
+    avio_wb32(pb, entries); // rewrite size
+    avio_seek(pb, curpos, SEEK_SET);
+    return update_size(pb, pos);
 }
 
 static int mov_write_dref_tag(AVIOContext *pb)
@@ -3185,14 +3308,15 @@ static int mov_write_edts_tag(AVIOContext *pb, MOVMuxContext *mov,
     int64_t start_dts = track->start_dts;
 
     if (track->entry) {
-        if (start_dts != track->cluster[0].dts || start_ct != track->cluster[0].cts) {
+        MOVIentry *first = get_cluster(track, 0);
+        if (start_dts != first->dts || start_ct != first->cts) {
 
             av_log(mov->fc, AV_LOG_DEBUG,
                    "EDTS using dts:%"PRId64" cts:%d instead of dts:%"PRId64" cts:%"PRId64" tid:%d\n",
-                   track->cluster[0].dts, track->cluster[0].cts,
+                   first->dts, first->cts,
                    start_dts, start_ct, track->track_id);
-            start_dts = track->cluster[0].dts;
-            start_ct  = track->cluster[0].cts;
+            start_dts = first->dts;
+            start_ct  = first->cts;
         }
     }
 
@@ -3372,7 +3496,7 @@ static int mov_write_trak_tag(AVFormatContext *s, AVIOContext *pb, MOVMuxContext
     if (track->start_dts != AV_NOPTS_VALUE) {
         if (mov->use_editlist)
             mov_write_edts_tag(pb, mov, track);  // PSP Movies and several other cases require edts box
-        else if ((track->entry && track->cluster[0].dts) || track->mode == MODE_PSP || is_clcp_track(track))
+        else if ((track->entry && get_cluster(track, 0)->dts) || track->mode == MODE_PSP || is_clcp_track(track))
             av_log(mov->fc, AV_LOG_WARNING,
                    "Not writing any edit list even though one would have been required\n");
     }
@@ -4079,25 +4203,8 @@ static int mov_write_uuidusmt_tag(AVIOContext *pb, AVFormatContext *s)
 
 static void build_chunks(MOVTrack *trk)
 {
-    int i;
-    MOVIentry *chunk = &trk->cluster[0];
-    uint64_t chunkSize = chunk->size;
-    chunk->chunkNum = 1;
-    if (trk->chunkCount)
-        return;
-    trk->chunkCount = 1;
-    for (i = 1; i<trk->entry; i++){
-        if (chunk->pos + chunkSize == trk->cluster[i].pos &&
-            chunkSize + trk->cluster[i].size < (1<<20)){
-            chunkSize             += trk->cluster[i].size;
-            chunk->samples_in_chunk += trk->cluster[i].entries;
-        } else {
-            trk->cluster[i].chunkNum = chunk->chunkNum+1;
-            chunk=&trk->cluster[i];
-            chunkSize = chunk->size;
-            trk->chunkCount++;
-        }
-    }
+    update_chunks(trk, trk->entry);
+    set_chunk_samples(trk);
 }
 
 /**
@@ -4211,6 +4318,10 @@ static int mov_write_moov_tag(AVIOContext *pb, MOVMuxContext *mov,
             if (ret < 0)
                 return ret;
         }
+        if (mov->tracks[i].spill_error) {
+            av_log(s, AV_LOG_ERROR, "Failed to access the sample table spill file\n");
+            return mov->tracks[i].spill_error;
+        }
     }
     if (mov->flags & FF_MOV_FLAG_FRAGMENT)
         mov_write_mvex_tag(pb, mov); /* QuickTime requires trak to precede this */
@@ -5255,7 +5366,7 @@ static void mov_parse_truehd_frame(AVPacket *pkt, MOVTrack *trk)
         return;
 
     if (AV_RB32(pkt->data + 4) == 0xF8726FBA) {
-        trk->cluster[trk->entry].flags |= MOV_SYNC_SAMPLE;
+        get_cluster(trk, trk->entry)->flags |= MOV_SYNC_SAMPLE;
         trk->has_keyframes++;
     }
 
@@ -5522,7 +5633,7 @@ static int check_pkt(AVFormatContext *s, AVPacket *pkt)
     uint64_t duration;
 
     if (trk->entry) {
-        ref = trk->cluster[trk->entry - 1].dts;
+        ref = get_cluster(trk, trk->entry - 1)->dts;
     } else if (   trk->start_dts != AV_NOPTS_VALUE
                && !trk->frag_discont) {
         ref = trk->start_dts + trk->track_duration;
@@ -5552,6 +5663,54 @@ static int check_pkt(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+/**
+ * Move all but the last index entry of a track to its spill file.
+ */
+static int spill_clusters(AVFormatContext *s, MOVTrack *trk)
+{
+    int i, nb = trk->entry - trk->entries_spilled - 1;
+
+    if (!trk->spill_buf) {
+        char *filename;
+
+        trk->spill_buf    = av_malloc(MOV_INDEX_CLUSTER_SIZE * MOV_SPILL_ENTRY_SIZE);
+        trk->spill_window = av_malloc_array(MOV_INDEX_CLUSTER_SIZE, sizeof(*trk->spill_window));
+        if (!trk->spill_buf || !trk->spill_window) {
+            av_freep(&trk->spill_buf);
+            av_freep(&trk->spill_window);
+            return AVERROR(ENOMEM);
+        }
+        trk->spill_fd = avpriv_tempfile("movspill", &filename, 0, s);
+        if (trk->spill_fd < 0) {
+            av_log(s, AV_LOG_ERROR, "Failed to create the sample table spill file\n");
+            av_freep(&trk->spill_buf);
+            av_freep(&trk->spill_window);
+            return trk->spill_fd;
+        }
+        /* Try to remove the file right away, so that it does not outlive
+         * us; keep the name to remove it on close if that is not possible. */
+        if (unlink(filename) >= 0)
+            av_freep(&filename);
+        else
+            trk->spill_filename = filename;
+    }
+
+    update_chunks(trk, trk->entry);
+
+    for (i = 0; i < nb; i++)
+        spill_write_entry(trk->spill_buf + i * MOV_SPILL_ENTRY_SIZE, &trk->cluster[i]);
+    if (lseek(trk->spill_fd, (int64_t)trk->entries_spilled * MOV_SPILL_ENTRY_SIZE, SEEK_SET) < 0 ||
+        write(trk->spill_fd, trk->spill_buf, nb * MOV_SPILL_ENTRY_SIZE) != nb * MOV_SPILL_ENTRY_SIZE) {
+        av_log(s, AV_LOG_ERROR, "Failed to write the sample table spill file\n");
+        return AVERROR(EIO);
+    }
+    memmove(trk->cluster, trk->cluster + nb,
+            (trk->entry - trk->entries_spilled - nb) * sizeof(*trk->cluster));
+    trk->entries_spilled += nb;
+
+    return 0;
+}
+
 int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -5559,6 +5718,7 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     MOVTrack *trk = &mov->tracks[pkt->stream_index];
     AVCodecParameters *par = trk->par;
     AVProducerReferenceTime *prft;
+    MOVIentry *sample;
     unsigned int samples_in_chunk = 0;
     int size = pkt->size, ret = 0, offset = 0;
     buffer_size_t prft_size;
@@ -5744,30 +5904,39 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         }
     }
 
-    if (trk->entry >= trk->cluster_capacity) {
-        unsigned new_capacity = trk->entry + MOV_INDEX_CLUSTER_SIZE;
-        if (av_reallocp_array(&trk->cluster, new_capacity,
-                              sizeof(*trk->cluster))) {
-            ret = AVERROR(ENOMEM);
-            goto err;
+    if (trk->entry - trk->entries_spilled >= trk->cluster_capacity) {
+        /* VC-1 may clear the sync flag of all earlier entries, so its
+         * entries have to stay in memory. */
+        if (mov->spill_sample_table && trk->cluster_capacity &&
+            par->codec_id != AV_CODEC_ID_VC1) {
+            if ((ret = spill_clusters(s, trk)) < 0)
+                goto err;
+        } else {
+            unsigned new_capacity = trk->entry - trk->entries_spilled + MOV_INDEX_CLUSTER_SIZE;
+            if (av_reallocp_array(&trk->cluster, new_capacity,
+                                  sizeof(*trk->cluster))) {
+                ret = AVERROR(ENOMEM);
+                goto err;
+            }
+            trk->cluster_capacity = new_capacity;
         }
-        trk->cluster_capacity = new_capacity;
     }
+    sample = &trk->cluster[trk->entry - trk->entries_spilled];
 
-    trk->cluster[trk->entry].pos              = avio_tell(pb) - size;
-    trk->cluster[trk->entry].samples_in_chunk = samples_in_chunk;
-    trk->cluster[trk->entry].chunkNum         = 0;
-    trk->cluster[trk->entry].size             = size;
-    trk->cluster[trk->entry].entries          = samples_in_chunk;
-    trk->cluster[trk->entry].dts              = pkt->dts;
-    trk->cluster[trk->entry].pts              = pkt->pts;
+    sample->pos              = avio_tell(pb) - size;
+    sample->samples_in_chunk = samples_in_chunk;
+    sample->chunkNum         = 0;
+    sample->size             = size;
+    sample->entries          = samples_in_chunk;
+    sample->dts              = pkt->dts;
+    sample->pts              = pkt->pts;
     if (!trk->entry && trk->start_dts != AV_NOPTS_VALUE) {
         if (!trk->frag_discont) {
             /* First packet of a new fragment. We already wrote the duration
              * of the last packet of the previous fragment based on track_duration,
              * which might not exactly match our dts. Therefore adjust the dts
              * of this packet to be what the previous packets duration implies. */
-            trk->cluster[trk->entry].dts = trk->start_dts + trk->track_duration;
+            sample->dts = trk->start_dts + trk->track_duration;
             /* We also may have written the pts and the corresponding duration
              * in sidx/tfrf/tfxd tags; make sure the sidx pts and duration match up with
              * the next fragment. This means the cts of the first sample must
@@ -5776,7 +5945,7 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
             if ((mov->flags & FF_MOV_FLAG_DASH &&
                 !(mov->flags & (FF_MOV_FLAG_GLOBAL_SIDX | FF_MOV_FLAG_SKIP_SIDX))) ||
                 mov->mode == MODE_ISM)
-                pkt->pts = pkt->dts + trk->end_pts - trk->cluster[trk->entry].dts;
+                pkt->pts = pkt->dts + trk->end_pts - sample->dts;
         } else {
             /* New fragment, but discontinuous from previous fragments.
              * Pretend the duration sum of the earlier fragments is
@@ -5794,7 +5963,7 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
          * to signal the difference in starting time without an edit list.
          * Thus move the timestamp for this first sample to 0, increasing
          * its duration instead. */
-        trk->cluster[trk->entry].dts = trk->start_dts = 0;
+        sample->dts = trk->start_dts = 0;
     }
     if (trk->start_dts == AV_NOPTS_VALUE) {
         trk->start_dts = pkt->dts;
@@ -5828,16 +5997,16 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     }
     if (pkt->dts != pkt->pts)
         trk->flags |= MOV_TRACK_CTTS;
-    trk->cluster[trk->entry].cts   = pkt->pts - pkt->dts;
-    trk->cluster[trk->entry].flags = 0;
+    sample->cts   = pkt->pts - pkt->dts;
+    sample->flags = 0;
     if (trk->start_cts == AV_NOPTS_VALUE)
         trk->start_cts = pkt->pts - pkt->dts;
     if (trk->end_pts == AV_NOPTS_VALUE)
-        trk->end_pts = trk->cluster[trk->entry].dts +
-                       trk->cluster[trk->entry].cts + pkt->duration;
+        trk->end_pts = sample->dts +
+                       sample->cts + pkt->duration;
     else
-        trk->end_pts = FFMAX(trk->end_pts, trk->cluster[trk->entry].dts +
-                                           trk->cluster[trk->entry].cts +
+        trk->end_pts = FFMAX(trk->end_pts, sample->dts +
+                                           sample->cts +
                                            pkt->duration);
 
     if (par->codec_id == AV_CODEC_ID_VC1) {
@@ -5847,25 +6016,25 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     } else if (pkt->flags & AV_PKT_FLAG_KEY) {
         if (mov->mode == MODE_MOV && par->codec_id == AV_CODEC_ID_MPEG2VIDEO &&
             trk->entry > 0) { // force sync sample for the first key frame
-            mov_parse_mpeg2_frame(pkt, &trk->cluster[trk->entry].flags);
-            if (trk->cluster[trk->entry].flags & MOV_PARTIAL_SYNC_SAMPLE)
+            mov_parse_mpeg2_frame(pkt, &sample->flags);
+            if (sample->flags & MOV_PARTIAL_SYNC_SAMPLE)
                 trk->flags |= MOV_TRACK_STPS;
         } else {
-            trk->cluster[trk->entry].flags = MOV_SYNC_SAMPLE;
+            sample->flags = MOV_SYNC_SAMPLE;
         }
-        if (trk->cluster[trk->entry].flags & MOV_SYNC_SAMPLE)
+        if (sample->flags & MOV_SYNC_SAMPLE)
             trk->has_keyframes++;
     }
     if (pkt->flags & AV_PKT_FLAG_DISPOSABLE) {
-        trk->cluster[trk->entry].flags |= MOV_DISPOSABLE_SAMPLE;
+        sample->flags |= MOV_DISPOSABLE_SAMPLE;
         trk->has_disposable++;
     }
 
     prft = (AVProducerReferenceTime *)av_packet_get_side_data(pkt, AV_PKT_DATA_PRFT, &prft_size);
     if (prft && prft_size == sizeof(AVProducerReferenceTime))
-        memcpy(&trk->cluster[trk->entry].prft, prft, prft_size);
+        memcpy(&sample->prft, prft, prft_size);
     else
-        memset(&trk->cluster[trk->entry].prft, 0, sizeof(AVProducerReferenceTime));
+        memset(&sample->prft, 0, sizeof(AVProducerReferenceTime));
 
     trk->entry++;
     trk->sample_count += samples_in_chunk;
@@ -6320,6 +6489,16 @@ static void mov_free(AVFormatContext *s)
             av_freep(&mov->tracks[i].par);
         av_freep(&mov->tracks[i].cluster);
         av_freep(&mov->tracks[i].frag_info);
+        if (mov->tracks[i].spill_buf) {
+            close(mov->tracks[i].spill_fd);
+            if (mov->tracks[i].spill_filename &&
+                unlink(mov->tracks[i].spill_filename) < 0)
+                av_log(s, AV_LOG_ERROR, "Could not delete %s.\n",
+                       mov->tracks[i].spill_filename);
+            av_freep(&mov->tracks[i].spill_filename);
+            av_freep(&mov->tracks[i].spill_buf);
+            av_freep(&mov->tracks[i].spill_window);
+        }
         av_packet_free(&mov->tracks[i].cover_image);
 
         if (mov->tracks[i].eac3_priv) {
@@ -6461,6 +6640,11 @@ static int mov_init(AVFormatContext *s)
         mov->reserved_moov_size = -1;
     }
 
+    if (mov->spill_sample_table && mov->flags & FF_MOV_FLAG_FRAGMENT) {
+        av_log(s, AV_LOG_WARNING, "Fragmented output; ignoring spill_sample_table option\n");
+        mov->spill_sample_table = 0;
+    }
+
     if (mov->use_editlist < 0) {
         mov->use_editlist = 1;
         if (mov->flags & FF_MOV_FLAG_FRAGMENT &&
@@ -110,8 +110,21 @@ typedef struct MOVTrack {
 
     int         vos_len;
     uint8_t     *vos_data;
-    MOVIentry   *cluster;
+    MOVIentry   *cluster;           ///< entries from entries_spilled onwards
     unsigned    cluster_capacity;
+    int         entries_spilled;    ///< number of leading entries moved to spill_fd
+    int         spill_fd;           ///< only valid if spill_buf is set
+    char       *spill_filename;     ///< set if the spill file could not be unlinked early
+    uint8_t    *spill_buf;
+    MOVIentry  *spill_window;       ///< spilled entries read back for writing the moov
+    int         spill_window_start;
+    int         spill_window_count;
+    int         spill_error;
+    int         chunk_built;        ///< number of entries already assigned to chunks
+    int         chunk_start;        ///< first entry of the last chunk
+    uint64_t    chunk_pos;
+    uint64_t    chunk_size;
+    unsigned    chunk_samples;
     int         audio_vbr;
     int         height; ///< active picture (w/o VBI) height for D-10/IMX
     uint32_t    tref_tag;
@@ -237,6 +250,7 @@ typedef struct MOVMuxContext {
     int write_tmcd;
     MOVPrftBox write_prft;
     int empty_hdlr_name;
+    int spill_sample_table;
 } MOVMuxContext;
 
 #define FF_MOV_FLAG_RTP_HINT              (1 <<  0)
@@ -99,7 +99,6 @@ struct MpegTSFilter {
     int es_id;
     int last_cc; /* last cc code (-1 if first packet) */
     int64_t last_pcr;
-    int discard;
     enum MpegTSFilterType type;
     union {
         MpegTSPESFilter pes_filter;
@@ -173,12 +172,23 @@ struct MpegTSContext {
     int8_t crc_validity[NB_PID_MAX];
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
+    /** MPEGTS_PID_* flags, so that unwanted PIDs are skipped without
+     *  touching their filter */
+    uint8_t pid_flags[NB_PID_MAX];
+    /** AVProgram.discard == AVDISCARD_ALL as seen by the last discard_pid() calls */
+    uint8_t *prog_discard;
+    int nb_prog_discard;
     int current_pid;
 
     AVStream *epg_stream;
     AVBufferPool* pools[32];
 };
 
+#define MPEGTS_PID_OPEN     0x01 ///< a filter is open on the PID
+#define MPEGTS_PID_DISCARD  0x02 ///< its packets are discarded until the next unit start
+#define MPEGTS_PID_CHECKED  0x04 ///< MPEGTS_PID_UNUSED is up to date
+#define MPEGTS_PID_UNUSED   0x08 ///< cached discard_pid() result
+
 #define MPEGTS_OPTIONS \
     { "resync_size",   "set size limit for looking up a new synchronization", offsetof(MpegTSContext, resync_size), AV_OPT_TYPE_INT,  { .i64 =  MAX_RESYNC_SIZE}, 0, INT_MAX,  AV_OPT_FLAG_DECODING_PARAM }
 
@@ -294,6 +304,18 @@ static void clear_avprogram(MpegTSContext *ts, unsigned int programid)
     prg->nb_stream_indexes = 0;
 }
 
+/**
+ * Forget the cached discard_pid() results, to be called whenever the
+ * PID to program mapping or the discard flag of a program changes.
+ */
+static void invalidate_pid_discard(MpegTSContext *ts)
+{
+    int i;
+
+    for (i = 0; i < NB_PID_MAX; i++)
+        ts->pid_flags[i] &= ~(MPEGTS_PID_CHECKED | MPEGTS_PID_UNUSED);
+}
+
 static void clear_program(struct Program *p)
 {
     if (!p)
@@ -307,6 +329,7 @@ static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg = 0;
+    invalidate_pid_discard(ts);
 }
 
 static struct Program * add_program(MpegTSContext *ts, unsigned int programid)
@@ -408,6 +431,30 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+static void check_program_discard(MpegTSContext *ts)
+{
+    AVFormatContext *s = ts->stream;
+    int i, changed = 0;
+
+    if (s->nb_programs != ts->nb_prog_discard) {
+        if (av_reallocp_array(&ts->prog_discard, s->nb_programs,
+                              sizeof(*ts->prog_discard)) < 0) {
+            ts->nb_prog_discard = 0;
+            invalidate_pid_discard(ts);
+            return;
+        }
+        ts->nb_prog_discard = s->nb_programs;
+        changed = 1;
+    }
+    for (i = 0; i < s->nb_programs; i++) {
+        uint8_t discard = s->programs[i]->discard == AVDISCARD_ALL;
+        changed |= ts->prog_discard[i] != discard;
+        ts->prog_discard[i] = discard;
+    }
+    if (changed)
+        invalidate_pid_discard(ts);
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -492,6 +539,7 @@ static MpegTSFilter *mpegts_open_filter(MpegTSContext *ts, unsigned int pid,
     if (!filter)
         return NULL;
     ts->pids[pid] = filter;
+    ts->pid_flags[pid] = (ts->pid_flags[pid] & ~MPEGTS_PID_DISCARD) | MPEGTS_PID_OPEN;
 
     filter->type    = type;
     filter->pid     = pid;
@@ -569,6 +617,7 @@ static void mpegts_close_filter(MpegTSContext *ts, MpegTSFilter *filter)
 
     av_free(filter);
     ts->pids[pid] = NULL;
+    ts->pid_flags[pid] &= ~(MPEGTS_PID_OPEN | MPEGTS_PID_DISCARD);
 }
 
 static int analyze(const uint8_t *buf, int size, int packet_size,
@@ -1318,7 +1367,8 @@ skip:
                                             st = pst;
                                     }
                                 }
-                                if (f->last_pcr != -1 && !f->discard) {
+                                if (f->last_pcr != -1 &&
+                                    !(pes->ts->pid_flags[f->pid] & MPEGTS_PID_DISCARD)) {
                                     // teletext packets do not always have correct timestamps,
                                     // the standard says they should be handled after 40.6 ms at most,
                                     // and the pcr error to this packet should be no more than 100 ms.
@@ -2300,6 +2350,7 @@ static void pmt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
         return;
     if (skip_identical(h, tssf))
         return;
+    invalidate_pid_discard(ts);
 
     av_log(ts->stream, AV_LOG_TRACE, "sid=0x%x sec_num=%d/%d version=%d tid=%d\n",
             h->id, h->sec_num, h->last_sec_num, h->version, h->tid);
@@ -2511,6 +2562,7 @@ static void pat_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
 
     if (skip_identical(h, tssf))
         return;
+    invalidate_pid_discard(ts);
     ts->stream->ts_id = h->id;
 
     for (;;) {
@@ -2723,17 +2775,25 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
 
     pid = AV_RB16(packet + 1) & 0x1fff;
     is_start = packet[1] & 0x40;
-    tss = ts->pids[pid];
-    if (ts->auto_guess && !tss && is_start) {
+    if (!(ts->pid_flags[pid] & MPEGTS_PID_OPEN)) {
+        if (!ts->auto_guess || !is_start)
+            return 0;
         add_pes_stream(ts, pid, -1);
-        tss = ts->pids[pid];
+        if (!ts->pids[pid])
+            return 0;
     }
-    if (!tss)
-        return 0;
-    if (is_start)
-        tss->discard = discard_pid(ts, pid);
-    if (tss->discard)
+    if (is_start) {
+        uint8_t flags = ts->pid_flags[pid];
+        if (!(flags & MPEGTS_PID_CHECKED))
+            flags |= MPEGTS_PID_CHECKED | (discard_pid(ts, pid) ? MPEGTS_PID_UNUSED : 0);
+        flags &= ~MPEGTS_PID_DISCARD;
+        if (flags & MPEGTS_PID_UNUSED)
+            flags |= MPEGTS_PID_DISCARD;
+        ts->pid_flags[pid] = flags;
+    }
+    if (ts->pid_flags[pid] & MPEGTS_PID_DISCARD)
         return 0;
+    tss = ts->pids[pid];
     ts->current_pid = pid;
 
     afc = (packet[3] >> 4) & 3;
@@ -2872,6 +2932,20 @@ static int mpegts_resync(AVFormatContext *s, int seekback, const uint8_t *curren
         c = avio_r8(pb);
         if (avio_feof(pb))
             return AVERROR_EOF;
+        if (c != 0x47) {
+            /* Scan the rest of the I/O buffer at once */
+            int len = FFMIN(pb->buf_end - pb->buf_ptr, ts->resync_size - i - 1);
+            const uint8_t *sync = memchr(pb->buf_ptr, 0x47, len);
+            if (!sync) {
+                avio_skip(pb, len);
+                i += len;
+                continue;
+            }
+            len = sync - pb->buf_ptr + 1;
+            avio_skip(pb, len);
+            i += len;
+            c = 0x47;
+        }
         if (c == 0x47) {
             int new_packet_size, ret;
             avio_seek(pb, -1, SEEK_CUR);
@@ -2931,11 +3005,15 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
+    AVIOContext *pb = s->pb;
     uint8_t packet[TS_PACKET_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
-    const uint8_t *data;
-    int64_t packet_num;
+    const uint8_t *data, *buf = NULL;
+    int64_t packet_num, buf_pos = 0;
+    int buffered = 0, consumed = 0;
     int ret = 0;
 
+    check_program_discard(ts);
+
     if (avio_tell(s->pb) != ts->last_pos) {
         int i;
         av_log(ts->stream, AV_LOG_TRACE, "Skipping after seek\n");
@@ -2969,14 +3047,36 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
-        ret = read_packet(s, packet, ts->raw_packet_size, &data);
-        if (ret != 0)
-            break;
-        ret = handle_packet(ts, data, avio_tell(s->pb));
-        finished_reading_packet(s, ts->raw_packet_size);
+        /* Packets that are already in the I/O buffer are handled in place,
+         * the buffer is only advanced once all of them are done. */
+        if (buffered < ts->raw_packet_size && !pb->direct) {
+            if (consumed)
+                avio_skip(pb, consumed);
+            buf      = pb->buf_ptr;
+            buffered = pb->buf_end - pb->buf_ptr;
+            buf_pos  = avio_tell(pb);
+            consumed = 0;
+        }
+        if (buffered >= ts->raw_packet_size && buf[consumed] == 0x47) {
+            ret = handle_packet(ts, buf + consumed, buf_pos + consumed + TS_PACKET_SIZE);
+            consumed += ts->raw_packet_size;
+            buffered -= ts->raw_packet_size;
+        } else {
+            if (consumed)
+                avio_skip(pb, consumed);
+            buffered = consumed = 0;
+
+            ret = read_packet(s, packet, ts->raw_packet_size, &data);
+            if (ret != 0)
+                break;
+            ret = handle_packet(ts, data, avio_tell(s->pb));
+            finished_reading_packet(s, ts->raw_packet_size);
+        }
         if (ret != 0)
             break;
     }
+    if (consumed)
+        avio_skip(pb, consumed);
     ts->last_pos = avio_tell(s->pb);
     return ret;
 }
@@ -3244,6 +3344,7 @@ static void mpegts_free(MpegTSContext *ts)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->prog_discard);
 
     for (i = 0; i < FF_ARRAY_ELEMS(ts->pools); i++)
         av_buffer_pool_uninit(&ts->pools[i]);
@@ -3363,6 +3464,7 @@ int avpriv_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
 
     len1 = len;
     ts->pkt = pkt;
+    check_program_discard(ts);
     for (;;) {
         ts->stop_parse = 0;
         if (len < TS_PACKET_SIZE)
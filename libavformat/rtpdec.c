@@ -696,6 +696,8 @@ static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
     if (buf[1] & 0x80)
         flags |= RTP_FLAG_MARKER;
     seq       = AV_RB16(buf + 2);
+    if (s->seq_valid && seq != (uint16_t) (s->seq + 1))
+        flags |= RTP_FLAG_LOSS;
     timestamp = AV_RB32(buf + 4);
     ssrc      = AV_RB32(buf + 8);
     /* store the ssrc in the RTPDemuxContext */
@@ -720,7 +722,8 @@ static int rtp_parse_packet_internal(RTPDemuxContext *s, AVPacket *pkt,
             len -= padding;
     }
 
-    s->seq = seq;
+    s->seq       = seq;
+    s->seq_valid = 1;
     len   -= 12;
     buf   += 12;
 
@@ -772,10 +775,46 @@ void ff_rtp_reset_packet_queue(RTPDemuxContext *s)
         s->queue = next;
     }
     s->seq       = 0;
+    s->seq_valid = 0;
     s->queue_len = 0;
     s->prev_ret  = 0;
 }
 
+/**
+ * Get the peak reordering delay, decaying by 1/128 of the time elapsed since
+ * it was last raised.
+ */
+static int64_t rtp_reorder_peak(RTPDemuxContext *s, int64_t now)
+{
+    return FFMAX(s->reorder_delay - (now - s->reorder_delay_time) / 128, 0);
+}
+
+static void rtp_update_reorder_delay(RTPDemuxContext *s, int64_t delay,
+                                     int64_t now)
+{
+    s->reorder_delay      = FFMAX(rtp_reorder_peak(s, now), delay);
+    s->reorder_delay_time = now;
+}
+
+/**
+ * Get the time, in microseconds, that packets following a gap in the
+ * sequence are held back waiting for the missing ones.
+ */
+static int64_t rtp_reorder_delay(RTPDemuxContext *s, int64_t now)
+{
+    int64_t max_delay = FFMAX(s->ic->max_delay, 0), delay, jitter = 0;
+
+    if (s->jitter_buffer != RTP_JITTER_BUFFER_ADAPTIVE)
+        return max_delay;
+
+    /* The RTCP interarrival jitter is kept in 1/16 timestamp units. */
+    if (s->st)
+        jitter = av_rescale_q(s->statistics.jitter >> 4, s->st->time_base,
+                              AV_TIME_BASE_Q);
+    delay = FFMAX(4 * jitter, rtp_reorder_peak(s, now) * 3 / 2);
+    return av_clip64(delay, FFMIN(RTP_MIN_REORDER_DELAY, max_delay), max_delay);
+}
+
 static int enqueue_packet(RTPDemuxContext *s, uint8_t *buf, int len)
 {
     uint16_t seq   = AV_RB16(buf + 2);
@@ -808,9 +847,11 @@ static int has_next_packet(RTPDemuxContext *s)
     return s->queue && s->queue->seq == (uint16_t) (s->seq + 1);
 }
 
-int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s)
+int64_t ff_rtp_queue_deadline(RTPDemuxContext *s)
 {
-    return s->queue ? s->queue->recvtime : 0;
+    if (!s->queue)
+        return 0;
+    return s->queue->recvtime + rtp_reorder_delay(s, av_gettime_relative());
 }
 
 static int rtp_parse_queued_packet(RTPDemuxContext *s, AVPacket *pkt)
@@ -881,23 +922,32 @@ static int rtp_parse_one_packet(RTPDemuxContext *s, AVPacket *pkt,
         rtcp_update_jitter(&s->statistics, timestamp, arrival_ts);
     }
 
-    if ((s->seq == 0 && !s->queue) || s->queue_size <= 1) {
+    if ((!s->seq_valid && !s->queue) || s->queue_size <= 1) {
         /* First packet, or no reordering */
         return rtp_parse_packet_internal(s, pkt, buf, len);
     } else {
         uint16_t seq = AV_RB16(buf + 2);
         int16_t diff = seq - s->seq;
+        int64_t now  = av_gettime_relative();
         if (diff < 0) {
             /* Packet older than the previously emitted one, drop */
             av_log(s->ic, AV_LOG_WARNING,
                    "RTP: dropping old packet received too late\n");
+            /* We gave up on it too early, wait longer from now on. */
+            rtp_update_reorder_delay(s, FFMAX(2 * rtp_reorder_peak(s, now),
+                                              RTP_MIN_REORDER_DELAY), now);
             return -1;
         } else if (diff <= 1) {
             /* Correct packet */
+            if (diff == 1 && s->queue)
+                rtp_update_reorder_delay(s, now - s->queue->recvtime, now);
             rv = rtp_parse_packet_internal(s, pkt, buf, len);
             return rv;
         } else {
             /* Still missing some packet, enqueue this one. */
+            int16_t head_diff = s->queue ? (int16_t) (seq - s->queue->seq) : 0;
+            if (head_diff < 0)
+                rtp_update_reorder_delay(s, now - s->queue->recvtime, now);
             rv = enqueue_packet(s, buf, len);
             if (rv < 0)
                 return rv;
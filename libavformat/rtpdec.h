@@ -37,6 +37,12 @@ typedef struct RTPDynamicProtocolHandler RTPDynamicProtocolHandler;
 
 #define RTP_REORDER_QUEUE_DEFAULT_SIZE 500
 
+/** Lower bound of the adaptive reordering delay, in microseconds */
+#define RTP_MIN_REORDER_DELAY 10000
+
+#define RTP_JITTER_BUFFER_FIXED    0 ///< wait max_delay for missing packets
+#define RTP_JITTER_BUFFER_ADAPTIVE 1 ///< wait based on observed jitter and reordering
+
 #define RTP_NOTS_VALUE ((uint32_t)-1)
 
 typedef struct RTPDemuxContext RTPDemuxContext;
@@ -49,7 +55,14 @@ void ff_rtp_parse_set_crypto(RTPDemuxContext *s, const char *suite,
 int ff_rtp_parse_packet(RTPDemuxContext *s, AVPacket *pkt,
                         uint8_t **buf, int len);
 void ff_rtp_parse_close(RTPDemuxContext *s);
-int64_t ff_rtp_queued_packet_time(RTPDemuxContext *s);
+/**
+ * Get the time at which the first queued packet is due to be returned even
+ * if the packets preceding it are still missing.
+ *
+ * @return the deadline in av_gettime_relative() units, or 0 if no packet is
+ *         queued
+ */
+int64_t ff_rtp_queue_deadline(RTPDemuxContext *s);
 void ff_rtp_reset_packet_queue(RTPDemuxContext *s);
 
 /**
@@ -91,6 +104,7 @@ typedef struct RTPStatistics {
 
 #define RTP_FLAG_KEY    0x1 ///< RTP packet contains a keyframe
 #define RTP_FLAG_MARKER 0x2 ///< RTP marker bit was set for this packet
+#define RTP_FLAG_LOSS   0x4 ///< packets preceding this one were lost
 /**
  * Packet parsing for "private" payloads in the RTP specs.
  *
@@ -150,6 +164,7 @@ struct RTPDemuxContext {
     int payload_type;
     uint32_t ssrc;
     uint16_t seq;
+    int seq_valid;    ///< seq holds the sequence number of a parsed packet
     uint32_t timestamp;
     uint32_t base_timestamp;
     int64_t  unwrapped_timestamp;
@@ -169,6 +184,9 @@ struct RTPDemuxContext {
     RTPPacket* queue; ///< A sorted queue of buffered packets not yet returned
     int queue_len;    ///< The number of packets in queue
     int queue_size;   ///< The size of queue, or 0 if reordering is disabled
+    int jitter_buffer;          ///< RTP_JITTER_BUFFER_* mode
+    int64_t reorder_delay;      ///< peak time missing packets took to arrive, in microseconds
+    int64_t reorder_delay_time; ///< time reorder_delay was last raised
     /*@}*/
 
     /* rtcp sender statistics receive */
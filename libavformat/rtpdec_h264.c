@@ -48,6 +48,7 @@ struct PayloadContext {
     uint8_t profile_iop;
     uint8_t level_idc;
     int packetization_mode;
+    int fu_lost;        ///< skip fragments until the start of the next NAL unit
 #ifdef DEBUG
     int packet_types_received[32];
 #endif
@@ -303,6 +304,11 @@ static int h264_handle_packet_fu_a(AVFormatContext *ctx, PayloadContext *data, A
     buf += 2;
     len -= 2;
 
+    if (start_bit)
+        data->fu_lost = 0;
+    else if (data->fu_lost)
+        return AVERROR(EAGAIN);
+
     if (start_bit && nal_counters)
         nal_counters[nal_type & nal_mask]++;
     return ff_h264_handle_frag_packet(pkt, buf, len, start_bit, &nal, 1);
@@ -325,6 +331,14 @@ static int h264_handle_packet(AVFormatContext *ctx, PayloadContext *data,
     nal  = buf[0];
     type = nal & 0x1f;
 
+    /* A NAL unit missing some of its fragments would only be passed on
+     * truncated or spliced with the next one. */
+    if (flags & RTP_FLAG_LOSS) {
+        if (!data->fu_lost)
+            av_log(ctx, AV_LOG_DEBUG, "Packets lost, dropping partial NAL unit\n");
+        data->fu_lost = 1;
+    }
+
     /* Simplify the case (these are all the NAL types used internally by
      * the H.264 codec). */
     if (type >= 1 && type <= 23)
@@ -39,6 +39,7 @@
 /* SDP out-of-band signaling data */
 struct PayloadContext {
     int using_donl_field;
+    int fu_lost;        ///< skip fragments until the start of the next NAL unit
     int profile_id;
     uint8_t *sps, *pps, *vps, *sei;
     int sps_size, pps_size, vps_size, sei_size;
@@ -230,6 +231,11 @@ static int hevc_handle_packet(AVFormatContext *ctx, PayloadContext *rtp_hevc_ctx
         return AVERROR_INVALIDDATA;
     }
 
+    /* A NAL unit missing some of its fragments would only be passed on
+     * truncated or spliced with the next one. */
+    if (flags & RTP_FLAG_LOSS)
+        rtp_hevc_ctx->fu_lost = 1;
+
     switch (nal_type) {
     /* video parameter set (VPS) */
     case 32:
@@ -320,6 +326,11 @@ static int hevc_handle_packet(AVFormatContext *ctx, PayloadContext *rtp_hevc_ctx
             return AVERROR_INVALIDDATA;
         }
 
+        if (first_fragment)
+            rtp_hevc_ctx->fu_lost = 0;
+        else if (rtp_hevc_ctx->fu_lost)
+            return AVERROR(EAGAIN);
+
         new_nal_header[0] = (rtp_pl[0] & 0x81) | (fu_type << 1);
         new_nal_header[1] = rtp_pl[1];
 
@@ -73,6 +73,9 @@
 
 #define COMMON_OPTS() \
     { "reorder_queue_size", "set number of packets to buffer for handling of reordered packets", OFFSET(reordering_queue_size), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, DEC }, \
+    { "jitter_buffer",      "set how long to wait for missing packets",                      OFFSET(jitter_buffer),         AV_OPT_TYPE_INT, { .i64 = RTP_JITTER_BUFFER_FIXED }, 0, 1, DEC, "jitter_buffer" }, \
+    { "fixed",              "wait up to max_delay",                                          0, AV_OPT_TYPE_CONST, { .i64 = RTP_JITTER_BUFFER_FIXED },    0, 0, DEC, "jitter_buffer" }, \
+    { "adaptive",           "wait based on the observed jitter and reordering, up to max_delay", 0, AV_OPT_TYPE_CONST, { .i64 = RTP_JITTER_BUFFER_ADAPTIVE }, 0, 0, DEC, "jitter_buffer" }, \
     { "buffer_size",        "Underlying protocol send/receive buffer size",                  OFFSET(buffer_size),           AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, DEC|ENC }, \
     { "pkt_size",           "Underlying protocol send packet size",                          OFFSET(pkt_size),              AV_OPT_TYPE_INT, { .i64 = -1 }, -1, INT_MAX, ENC } \
 
@@ -870,6 +873,7 @@ int ff_rtsp_open_transport_ctx(AVFormatContext *s, RTSPStream *rtsp_st)
                s->iformat) {
         RTPDemuxContext *rtpctx = rtsp_st->transport_priv;
         rtpctx->ssrc = rtsp_st->ssrc;
+        rtpctx->jitter_buffer = rt->jitter_buffer;
         if (rtsp_st->dynamic_handler) {
             ff_rtp_parse_set_dynamic_protocol(rtsp_st->transport_priv,
                                               rtsp_st->dynamic_protocol_context,
@@ -2069,11 +2073,16 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
     }
 
     for (;;) {
+        int timeout = POLLING_TIME;
         if (ff_check_interrupt(&s->interrupt_callback))
             return AVERROR_EXIT;
-        if (wait_end && wait_end - av_gettime_relative() < 0)
-            return AVERROR(EAGAIN);
-        n = poll(p, rt->max_p, POLLING_TIME);
+        if (wait_end) {
+            int64_t left = wait_end - av_gettime_relative();
+            if (left < 0)
+                return AVERROR(EAGAIN);
+            timeout = FFMIN(timeout, (left + 999) / 1000);
+        }
+        n = poll(p, rt->max_p, timeout);
         if (n > 0) {
             int j = rt->rtsp_hd ? 1 : 0;
             for (i = 0; i < rt->nb_rtsp_streams; i++) {
@@ -2096,7 +2105,8 @@ static int udp_read_packet(AVFormatContext *s, RTSPStream **prtsp_st,
                 }
             }
 #endif
-        } else if (n == 0 && rt->initial_timeout > 0 && --runs <= 0) {
+        } else if (n == 0 && timeout == POLLING_TIME &&
+                   rt->initial_timeout > 0 && --runs <= 0) {
             return AVERROR(ETIMEDOUT);
         } else if (n < 0 && errno != EINTR)
             return AVERROR(errno);
@@ -2221,21 +2231,21 @@ int ff_rtsp_fetch_packet(AVFormatContext *s, AVPacket *pkt)
 redo:
     if (rt->transport == RTSP_TRANSPORT_RTP) {
         int i;
-        int64_t first_queue_time = 0;
+        int64_t first_deadline = 0;
         for (i = 0; i < rt->nb_rtsp_streams; i++) {
             RTPDemuxContext *rtpctx = rt->rtsp_streams[i]->transport_priv;
-            int64_t queue_time;
+            int64_t deadline;
             if (!rtpctx)
                 continue;
-            queue_time = ff_rtp_queued_packet_time(rtpctx);
-            if (queue_time && (queue_time - first_queue_time < 0 ||
-                               !first_queue_time)) {
-                first_queue_time = queue_time;
-                first_queue_st   = rt->rtsp_streams[i];
+            deadline = ff_rtp_queue_deadline(rtpctx);
+            if (deadline && (deadline - first_deadline < 0 ||
+                             !first_deadline)) {
+                first_deadline = deadline;
+                first_queue_st = rt->rtsp_streams[i];
             }
         }
-        if (first_queue_time) {
-            wait_end = first_queue_time + s->max_delay;
+        if (first_deadline) {
+            wait_end = first_deadline;
         } else {
             wait_end = 0;
             first_queue_st = NULL;
@@ -411,6 +411,11 @@ typedef struct RTSPState {
      */
     int reordering_queue_size;
 
+    /**
+     * RTP jitter buffer mode (RTP_JITTER_BUFFER_*).
+     */
+    int jitter_buffer;
+
     /**
      * User-Agent string
      */
@@ -0,0 +1,427 @@
+/*
+ * Sidecar seek index
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Keyframe index kept in a sidecar file next to inputs without an index of
+ * their own, to seek them without bisecting the file.
+ *
+ * File layout, all numbers but the header being variable length coded:
+ *   'FFSI' version(8) file_size(64 LE) head_crc(32 LE)
+ *   nb_streams
+ *   per stream: id codec_id time_base.num time_base.den nb_entries
+ *               nb_entries x (pos delta, timestamp delta)
+ * head_crc is the CRC of the first SEEK_INDEX_HEAD_SIZE bytes of the input,
+ * so that an index left over from another file of the same size is not used.
+ */
+
+#include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/crc.h"
+#include "libavutil/mathematics.h"
+#include "avformat.h"
+#include "avio_internal.h"
+#include "internal.h"
+
+#define SEEK_INDEX_VERSION 2
+#define SEEK_INDEX_HEAD_SIZE 65536
+
+typedef struct SeekIndexEntry {
+    int64_t pos;
+    int64_t timestamp;
+} SeekIndexEntry;
+
+typedef struct SeekIndexStream {
+    int id;
+    enum AVCodecID codec_id;
+    AVRational time_base;
+    SeekIndexEntry *entries;
+    int nb_entries;
+} SeekIndexStream;
+
+struct SeekIndex {
+    SeekIndexStream *streams;
+    int nb_streams;
+    int building;       ///< gathering entries while the input is read
+    int eof;            ///< the whole input has been read
+    int64_t file_size;
+    uint32_t head_crc;
+};
+
+static void put_v(AVIOContext *pb, int64_t v)
+{
+    uint64_t u = v < 0 ? ~((uint64_t)v << 1) : (uint64_t)v << 1;
+
+    while (u >= 0x80) {
+        avio_w8(pb, (u & 0x7f) | 0x80);
+        u >>= 7;
+    }
+    avio_w8(pb, u);
+}
+
+static int64_t get_v(AVIOContext *pb)
+{
+    uint64_t u = 0;
+    int shift, c;
+
+    for (shift = 0; shift < 64; shift += 7) {
+        c  = avio_r8(pb);
+        u |= (uint64_t)(c & 0x7f) << shift;
+        if (!(c & 0x80))
+            break;
+    }
+    return u & 1 ? ~(u >> 1) : u >> 1;
+}
+
+static void seek_index_free(SeekIndex **psi)
+{
+    SeekIndex *si = *psi;
+    int i;
+
+    if (!si)
+        return;
+    for (i = 0; i < si->nb_streams; i++)
+        av_freep(&si->streams[i].entries);
+    av_freep(&si->streams);
+    av_freep(psi);
+}
+
+static int cmp_entry(const void *a, const void *b)
+{
+    return FFDIFFSIGN(((const SeekIndexEntry *)a)->timestamp,
+                      ((const SeekIndexEntry *)b)->timestamp);
+}
+
+static int read_seek_index(AVFormatContext *s, SeekIndex *si, AVIOContext *pb)
+{
+    int64_t nb_streams, file_size;
+    uint32_t head_crc;
+    int i, j;
+
+    if (avio_rl32(pb) != MKTAG('F','F','S','I'))
+        return AVERROR_INVALIDDATA;
+    if (avio_r8(pb) != SEEK_INDEX_VERSION) {
+        av_log(s, AV_LOG_WARNING, "Seek index %s has another version, rebuilding it\n",
+               s->seek_index);
+        return AVERROR(EINVAL);
+    }
+    file_size = avio_rl64(pb);
+    head_crc  = avio_rl32(pb);
+    if (avio_feof(pb))
+        return AVERROR_INVALIDDATA;
+    if (file_size != si->file_size || head_crc != si->head_crc) {
+        av_log(s, AV_LOG_WARNING, "Seek index %s is for another file, rebuilding it\n",
+               s->seek_index);
+        return AVERROR(EINVAL);
+    }
+
+    nb_streams = get_v(pb);
+    if (nb_streams < 0 || nb_streams > s->max_streams)
+        return AVERROR_INVALIDDATA;
+    si->streams = av_calloc(nb_streams, sizeof(*si->streams));
+    if (!si->streams)
+        return AVERROR(ENOMEM);
+    si->nb_streams = nb_streams;
+
+    for (i = 0; i < si->nb_streams; i++) {
+        SeekIndexStream *sis = &si->streams[i];
+        int64_t pos = 0, timestamp = 0, nb_entries;
+
+        sis->id             = get_v(pb);
+        sis->codec_id       = get_v(pb);
+        sis->time_base.num  = get_v(pb);
+        sis->time_base.den  = get_v(pb);
+        nb_entries          = get_v(pb);
+        /* Every entry takes at least two bytes. */
+        if (nb_entries < 0 || nb_entries > INT_MAX / sizeof(*sis->entries) ||
+            (avio_size(pb) >= 0 && nb_entries > avio_size(pb)))
+            return AVERROR_INVALIDDATA;
+        sis->entries = av_malloc_array(nb_entries, sizeof(*sis->entries));
+        if (nb_entries && !sis->entries)
+            return AVERROR(ENOMEM);
+        for (j = 0; j < nb_entries; j++) {
+            pos       += get_v(pb);
+            timestamp += get_v(pb);
+            sis->entries[j].pos       = pos;
+            sis->entries[j].timestamp = timestamp;
+        }
+        if (avio_feof(pb))
+            return AVERROR_INVALIDDATA;
+        sis->nb_entries = nb_entries;
+        qsort(sis->entries, sis->nb_entries, sizeof(*sis->entries), cmp_entry);
+    }
+    return 0;
+}
+
+static int write_seek_index(AVFormatContext *s, SeekIndex *si)
+{
+    AVIOContext *pb;
+    char *tmp;
+    int i, j, ret;
+
+    tmp = av_asprintf("%s.tmp", s->seek_index);
+    if (!tmp)
+        return AVERROR(ENOMEM);
+    if ((ret = s->io_open(s, &pb, tmp, AVIO_FLAG_WRITE, NULL)) < 0)
+        goto end;
+
+    avio_wl32(pb, MKTAG('F','F','S','I'));
+    avio_w8  (pb, SEEK_INDEX_VERSION);
+    avio_wl64(pb, si->file_size);
+    avio_wl32(pb, si->head_crc);
+    put_v(pb, si->nb_streams);
+    for (i = 0; i < si->nb_streams; i++) {
+        const SeekIndexStream *sis = &si->streams[i];
+        int64_t pos = 0, timestamp = 0;
+
+        put_v(pb, sis->id);
+        put_v(pb, sis->codec_id);
+        put_v(pb, sis->time_base.num);
+        put_v(pb, sis->time_base.den);
+        put_v(pb, sis->nb_entries);
+        for (j = 0; j < sis->nb_entries; j++) {
+            put_v(pb, sis->entries[j].pos       - pos);
+            put_v(pb, sis->entries[j].timestamp - timestamp);
+            pos       = sis->entries[j].pos;
+            timestamp = sis->entries[j].timestamp;
+        }
+    }
+    avio_flush(pb);
+    ret = pb->error;
+    ff_format_io_close(s, &pb);
+    if (ret >= 0)
+        ret = ff_rename(tmp, s->seek_index, s);
+
+end:
+    av_free(tmp);
+    return ret;
+}
+
+/* Identify the input by its size and the CRC of its first bytes. */
+static int seek_index_alloc(AVFormatContext *s, SeekIndex **psi)
+{
+    int64_t pos = avio_tell(s->pb);
+    SeekIndex *si;
+    uint8_t *buf;
+    int ret;
+
+    si  = av_mallocz(sizeof(*si));
+    buf = av_malloc(SEEK_INDEX_HEAD_SIZE);
+    if (!si || !buf) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    si->file_size = avio_size(s->pb);
+    if (si->file_size < 0) {
+        ret = si->file_size;
+        goto fail;
+    }
+    if ((ret = avio_seek(s->pb, 0, SEEK_SET)) < 0)
+        goto fail;
+    ret = avio_read(s->pb, buf, FFMIN(si->file_size, SEEK_INDEX_HEAD_SIZE));
+    if (ret >= 0)
+        si->head_crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE_LE), UINT32_MAX, buf, ret);
+    pos = avio_seek(s->pb, pos, SEEK_SET);
+    if (ret >= 0 && pos < 0)
+        ret = pos;
+    if (ret < 0)
+        goto fail;
+
+    av_free(buf);
+    *psi = si;
+    return 0;
+
+fail:
+    av_free(buf);
+    av_free(si);
+    return ret;
+}
+
+int ff_seek_index_open(AVFormatContext *s)
+{
+    SeekIndex *si = NULL;
+    AVIOContext *pb;
+    int ret;
+
+    /* Seeks through the index need a seekable input. */
+    if (!s->pb || !(s->pb->seekable & AVIO_SEEKABLE_NORMAL))
+        return 0;
+
+    if (s->io_open(s, &pb, s->seek_index, AVIO_FLAG_READ, NULL) >= 0) {
+        ret = seek_index_alloc(s, &si);
+        if (ret >= 0)
+            ret = read_seek_index(s, si, pb);
+        ff_format_io_close(s, &pb);
+        if (ret >= 0) {
+            av_log(s, AV_LOG_VERBOSE, "Loaded seek index %s\n", s->seek_index);
+            s->internal->seek_index = si;
+            return 0;
+        }
+        seek_index_free(&si);
+        if (ret == AVERROR(ENOMEM))
+            return ret;
+        if (ret == AVERROR_INVALIDDATA)
+            av_log(s, AV_LOG_WARNING, "Invalid seek index %s, rebuilding it\n",
+                   s->seek_index);
+    }
+
+    /* Without an index of its own, an input can get one by reading it
+     * through once. */
+    if (s->iformat->read_seek || s->iformat->read_seek2)
+        return 0;
+    if ((ret = seek_index_alloc(s, &si)) < 0)
+        return ret == AVERROR(ENOMEM) ? ret : 0;
+    si->building = 1;
+    s->internal->seek_index = si;
+    return 0;
+}
+
+void ff_seek_index_add(AVFormatContext *s, const AVPacket *pkt, int ret)
+{
+    SeekIndex *si = s->internal->seek_index;
+    SeekIndexStream *sis;
+    SeekIndexEntry entry;
+    AVStream *st;
+
+    if (!si || !si->building)
+        return;
+    if (ret < 0) {
+        if (ret == AVERROR_EOF)
+            si->eof = 1;
+        return;
+    }
+    if (!(pkt->flags & AV_PKT_FLAG_KEY) || pkt->pos < 0)
+        return;
+    entry.pos       = pkt->pos;
+    entry.timestamp = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+    if (entry.timestamp == AV_NOPTS_VALUE)
+        return;
+
+    st = s->streams[pkt->stream_index];
+    if (pkt->stream_index >= si->nb_streams) {
+        SeekIndexStream *streams = av_realloc_array(si->streams, pkt->stream_index + 1,
+                                                    sizeof(*streams));
+        if (!streams)
+            goto fail;
+        memset(streams + si->nb_streams, 0,
+               (pkt->stream_index + 1 - si->nb_streams) * sizeof(*streams));
+        si->streams    = streams;
+        si->nb_streams = pkt->stream_index + 1;
+    }
+    sis = &si->streams[pkt->stream_index];
+    if (!sis->nb_entries) {
+        sis->id        = st->id;
+        sis->codec_id  = st->codecpar->codec_id;
+        sis->time_base = st->time_base;
+    } else {
+        const SeekIndexEntry *last = &sis->entries[sis->nb_entries - 1];
+        if (last->pos == entry.pos)
+            return;
+        /* Streams other than video usually consist of keyframes only, one
+         * entry per second is plenty for them. */
+        if (st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
+            entry.timestamp >= last->timestamp &&
+            av_compare_ts(entry.timestamp - last->timestamp, st->time_base,
+                          1, (AVRational){ 1, 1 }) < 0)
+            return;
+    }
+    if (!av_dynarray2_add((void **)&sis->entries, &sis->nb_entries,
+                          sizeof(entry), (const uint8_t *)&entry))
+        goto fail;
+    return;
+
+fail:
+    av_log(s, AV_LOG_ERROR, "Out of memory, not building seek index\n");
+    seek_index_free(&s->internal->seek_index);
+}
+
+void ff_seek_index_abort(AVFormatContext *s)
+{
+    SeekIndex *si = s->internal->seek_index;
+
+    if (si && si->building) {
+        av_log(s, AV_LOG_VERBOSE, "Input was seeked, not building seek index\n");
+        seek_index_free(&s->internal->seek_index);
+    }
+}
+
+int ff_seek_index_seek(AVFormatContext *s, int stream_index,
+                       int64_t timestamp, int flags)
+{
+    SeekIndex *si = s->internal->seek_index;
+    const SeekIndexStream *sis;
+    const SeekIndexEntry *e;
+    AVStream *st;
+    int lo, hi;
+    int64_t ret;
+
+    if (!si || si->building || stream_index < 0 || stream_index >= si->nb_streams)
+        return -1;
+    st  = s->streams[stream_index];
+    sis = &si->streams[stream_index];
+    if (!sis->nb_entries || sis->id != st->id ||
+        sis->codec_id != st->codecpar->codec_id ||
+        av_cmp_q(sis->time_base, st->time_base))
+        return -1;
+
+    /* Find the first entry after the target. */
+    lo = 0;
+    hi = sis->nb_entries;
+    while (lo < hi) {
+        int mid = (lo + hi) >> 1;
+        if (sis->entries[mid].timestamp <= timestamp)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (flags & AVSEEK_FLAG_BACKWARD) {
+        if (!lo)
+            return -1;
+        e = &sis->entries[lo - 1];
+    } else {
+        if (lo && sis->entries[lo - 1].timestamp == timestamp)
+            lo--;
+        if (lo == sis->nb_entries)
+            return -1;
+        e = &sis->entries[lo];
+    }
+
+    ff_read_frame_flush(s);
+    if ((ret = avio_seek(s->pb, e->pos, SEEK_SET)) < 0)
+        return ret;
+    ff_update_cur_dts(s, st, e->timestamp);
+    return 0;
+}
+
+void ff_seek_index_close(AVFormatContext *s)
+{
+    SeekIndex *si = s->internal->seek_index;
+    int ret;
+
+    if (si && si->building && si->eof) {
+        if ((ret = write_seek_index(s, si)) < 0)
+            av_log(s, AV_LOG_ERROR, "Could not write seek index %s: %s\n",
+                   s->seek_index, av_err2str(ret));
+        else
+            av_log(s, AV_LOG_VERBOSE, "Wrote seek index %s\n", s->seek_index);
+    }
+    seek_index_free(&s->internal->seek_index);
+}
@@ -0,0 +1,129 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+
+#include "libavformat/avformat.h"
+#include "libavformat/rtpdec.h"
+
+#define PAYLOAD_TYPE 96
+
+static int print_packet(AVFormatContext *ctx, PayloadContext *data,
+                        AVStream *st, AVPacket *pkt, uint32_t *timestamp,
+                        const uint8_t *buf, int len, uint16_t seq, int flags)
+{
+    int ret;
+
+    printf("  seq %5u%s\n", seq, flags & RTP_FLAG_LOSS ? " loss" : "");
+    if ((ret = av_new_packet(pkt, len)) < 0)
+        return ret;
+    pkt->stream_index = st->index;
+    return 0;
+}
+
+static const RTPDynamicProtocolHandler test_handler = {
+    .enc_name     = "test",
+    .codec_type   = AVMEDIA_TYPE_DATA,
+    .parse_packet = print_packet,
+};
+
+static int test_sequence(AVFormatContext *ic, int queue_size,
+                         const uint16_t *seqs, int nb_seqs)
+{
+    RTPDemuxContext *s;
+    AVPacket *pkt;
+    int i, ret = 0;
+
+    printf("queue size %d:", queue_size);
+    for (i = 0; i < nb_seqs; i++)
+        printf(" %u", seqs[i]);
+    printf("\n");
+
+    s   = ff_rtp_parse_open(ic, ic->streams[0], PAYLOAD_TYPE, queue_size);
+    pkt = av_packet_alloc();
+    if (!s || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ff_rtp_parse_set_dynamic_protocol(s, NULL, &test_handler);
+
+    for (i = 0; i < nb_seqs; i++) {
+        uint8_t *buf = av_mallocz(RTP_MIN_PACKET_LENGTH + 4);
+        int rv;
+
+        if (!buf) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        buf[0] = RTP_VERSION << 6;
+        buf[1] = PAYLOAD_TYPE;
+        AV_WB16(buf + 2, seqs[i]);
+        AV_WB32(buf + 4, 3000 * seqs[i]);
+        AV_WB32(buf + 8, 0x12345678);
+
+        /* the packet is kept by the context if it is queued */
+        rv = ff_rtp_parse_packet(s, pkt, &buf, RTP_MIN_PACKET_LENGTH + 4);
+        av_free(buf);
+        av_packet_unref(pkt);
+        while (rv > 0) {
+            rv = ff_rtp_parse_packet(s, pkt, NULL, 0);
+            av_packet_unref(pkt);
+        }
+    }
+
+end:
+    av_packet_free(&pkt);
+    if (s)
+        ff_rtp_parse_close(s);
+    return ret;
+}
+
+int main(void)
+{
+    /* a packet is lost right after the sequence number wraps to 0 */
+    static const uint16_t gap_after_wrap[] = { 65534, 65535, 0, 2, 3 };
+    /* the packet following 0 arrives late */
+    static const uint16_t late_after_wrap[] = { 65534, 65535, 0, 2, 1, 3 };
+    /* packet 0 is lost */
+    static const uint16_t gap_at_wrap[] = { 65534, 65535, 1, 2 };
+    AVFormatContext *ic;
+    AVStream *st;
+    int ret = 1;
+
+    ic = avformat_alloc_context();
+    if (!ic)
+        return 1;
+    st = avformat_new_stream(ic, NULL);
+    if (!st)
+        goto end;
+    st->time_base = (AVRational){ 1, 90000 };
+
+    if (test_sequence(ic, 0,  gap_after_wrap,  FF_ARRAY_ELEMS(gap_after_wrap))  < 0 ||
+        test_sequence(ic, 0,  gap_at_wrap,     FF_ARRAY_ELEMS(gap_at_wrap))     < 0 ||
+        test_sequence(ic, 10, late_after_wrap, FF_ARRAY_ELEMS(late_after_wrap)) < 0)
+        goto end;
+    ret = 0;
+
+end:
+    avformat_free_context(ic);
+    return ret;
+}
@@ -26,6 +26,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() with glibc */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -79,6 +80,24 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_MAX_BATCH_SIZE 64
+#define UDP_DEFAULT_RX_BATCH_SIZE 16
+/* A batch of outgoing datagrams must fit into a single GSO send, which is
+ * limited by the 16 bit IP total length field. */
+#define UDP_MAX_BATCH_BYTES 65000
+
+#if defined(__linux__) && !defined(UDP_SEGMENT)
+#define UDP_SEGMENT 103
+#endif
+
+#if HAVE_RECVMMSG
+typedef struct UDPRxBatch {
+    struct mmsghdr msgs[UDP_MAX_BATCH_SIZE];
+    struct iovec iov[UDP_MAX_BATCH_SIZE];
+    struct sockaddr_storage addr[UDP_MAX_BATCH_SIZE];
+    uint8_t *buf;
+} UDPRxBatch;
+#endif
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -87,6 +106,9 @@ typedef struct UDPContext {
     int udplite_coverage;
     int buffer_size;
     int pkt_size;
+    int batch_size;
+    int tx_batch;       /* number of pkt_size datagrams per write, 0 if not batching */
+    int gso;            /* UDP_SEGMENT is enabled on the socket */
     int is_multicast;
     int is_broadcast;
     int local_port;
@@ -110,6 +132,10 @@ typedef struct UDPContext {
     int thread_started;
 #endif
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
+#if HAVE_RECVMMSG
+    UDPRxBatch *rx_batch;
+    int rx_batch_size;
+#endif
     int remaining_in_dg;
     char *localaddr;
     int timeout;
@@ -131,6 +157,7 @@ static const AVOption options[] = {
     { "localaddr",      "Local address",                                   OFFSET(localaddr),      AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "udplite_coverage", "choose UDPLite head size which should be validated by checksum", OFFSET(udplite_coverage), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, D|E },
     { "pkt_size",       "Maximum UDP packet size",                         OFFSET(pkt_size),       AV_OPT_TYPE_INT,    { .i64 = 1472 },  -1, INT_MAX, .flags = D|E },
+    { "batch_size",     "Number of datagrams to receive or send per system call", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, UDP_MAX_BATCH_SIZE, .flags = D|E },
     { "reuse",          "explicitly allow reusing UDP sockets",            OFFSET(reuse_socket),   AV_OPT_TYPE_BOOL,   { .i64 = -1 },    -1, 1,       D|E },
     { "reuse_socket",   "explicitly allow reusing UDP sockets",            OFFSET(reuse_socket),   AV_OPT_TYPE_BOOL,   { .i64 = -1 },    -1, 1,       .flags = D|E },
     { "broadcast", "explicitly allow or disallow broadcast destination",   OFFSET(is_broadcast),   AV_OPT_TYPE_BOOL,   { .i64 = 0  },     0, 1,       E },
@@ -459,6 +486,123 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+static int udp_send(UDPContext *s, const uint8_t *buf, int size)
+{
+    if (!s->is_connected)
+        return sendto(s->udp_fd, buf, size, 0,
+                      (struct sockaddr *) &s->dest_addr, s->dest_addr_len);
+    return send(s->udp_fd, buf, size, 0);
+}
+
+/**
+ * Send buf as a sequence of datagrams of at most pkt_size bytes each, using
+ * a single GSO send or sendmmsg() where available.
+ *
+ * @return number of bytes sent, which is a multiple of pkt_size unless all
+ *         of buf was sent, or a negative AVERROR if nothing was sent
+ */
+static int udp_send_batch(URLContext *h, const uint8_t *buf, int size)
+{
+    UDPContext *s = h->priv_data;
+    int ret, sent = 0;
+
+#ifdef UDP_SEGMENT
+    if (s->gso) {
+        ret = udp_send(s, buf, size);
+        if (ret >= 0 || ff_neterrno() != AVERROR(EIO))
+            return ret < 0 ? ff_neterrno() : ret;
+        /* The route does not support checksum offload, which GSO requires. */
+        av_log(h, AV_LOG_VERBOSE, "UDP GSO unavailable, sending datagrams separately\n");
+        ret = 0;
+        setsockopt(s->udp_fd, IPPROTO_UDP, UDP_SEGMENT, &ret, sizeof(ret));
+        s->gso = 0;
+    }
+#endif
+
+#if HAVE_SENDMMSG
+    while (sent < size) {
+        struct mmsghdr msgs[UDP_MAX_BATCH_SIZE];
+        struct iovec iov[UDP_MAX_BATCH_SIZE];
+        int i, nb_msgs = 0, pos = sent;
+
+        memset(msgs, 0, sizeof(msgs));
+        while (pos < size && nb_msgs < UDP_MAX_BATCH_SIZE) {
+            iov[nb_msgs].iov_base = (uint8_t *)buf + pos;
+            iov[nb_msgs].iov_len  = FFMIN(s->pkt_size, size - pos);
+            msgs[nb_msgs].msg_hdr.msg_iov    = &iov[nb_msgs];
+            msgs[nb_msgs].msg_hdr.msg_iovlen = 1;
+            if (!s->is_connected) {
+                msgs[nb_msgs].msg_hdr.msg_name    = &s->dest_addr;
+                msgs[nb_msgs].msg_hdr.msg_namelen = s->dest_addr_len;
+            }
+            pos += iov[nb_msgs++].iov_len;
+        }
+
+        ret = sendmmsg(s->udp_fd, msgs, nb_msgs, 0);
+        if (ret < 0)
+            return sent ? sent : ff_neterrno();
+        for (i = 0; i < ret; i++)
+            sent += iov[i].iov_len;
+        if (ret < nb_msgs)
+            break;
+    }
+#else
+    while (sent < size) {
+        ret = udp_send(s, buf + sent, FFMIN(s->pkt_size, size - sent));
+        if (ret < 0)
+            return sent ? sent : ff_neterrno();
+        sent += ret;
+    }
+#endif
+    return sent;
+}
+
+static int udp_write_packet(URLContext *h, const uint8_t *buf, int size)
+{
+    UDPContext *s = h->priv_data;
+    int ret;
+
+    if (s->tx_batch && size > s->pkt_size)
+        return udp_send_batch(h, buf, size);
+
+    ret = udp_send(s, buf, size);
+    return ret < 0 ? ff_neterrno() : ret;
+}
+
+#if HAVE_RECVMMSG
+static void udp_free_rx_batch(UDPContext *s)
+{
+    if (s->rx_batch)
+        av_freep(&s->rx_batch->buf);
+    av_freep(&s->rx_batch);
+}
+
+static int udp_alloc_rx_batch(UDPContext *s, int nb_msgs)
+{
+    UDPRxBatch *b;
+    int i;
+
+    if (!(b = av_mallocz(sizeof(*b))))
+        return AVERROR(ENOMEM);
+    s->rx_batch = b;
+    if (!(b->buf = av_malloc_array(nb_msgs, UDP_MAX_PKT_SIZE + 4))) {
+        udp_free_rx_batch(s);
+        return AVERROR(ENOMEM);
+    }
+    /* Each slot keeps 4 bytes in front of the datagram for the fifo length
+     * prefix, so that it can be written to the fifo in one go. */
+    for (i = 0; i < nb_msgs; i++) {
+        b->iov[i].iov_base = b->buf + i * (UDP_MAX_PKT_SIZE + 4) + 4;
+        b->iov[i].iov_len  = UDP_MAX_PKT_SIZE;
+        b->msgs[i].msg_hdr.msg_iov  = &b->iov[i];
+        b->msgs[i].msg_hdr.msg_iovlen = 1;
+        b->msgs[i].msg_hdr.msg_name = &b->addr[i];
+    }
+    s->rx_batch_size = nb_msgs;
+    return 0;
+}
+#endif
+
 #if HAVE_PTHREAD_CANCEL
 static void *circular_buffer_task_rx( void *_URLContext)
 {
@@ -474,7 +618,7 @@ static void *circular_buffer_task_rx( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int i, len, nb_msgs;
         struct sockaddr_storage addr;
         socklen_t addr_len = sizeof(addr);
 
@@ -483,35 +627,58 @@ static void *circular_buffer_task_rx( void *_URLContext)
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
-        len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
+#if HAVE_RECVMMSG
+        if (s->rx_batch) {
+            for (i = 0; i < s->rx_batch_size; i++)
+                s->rx_batch->msgs[i].msg_hdr.msg_namelen = sizeof(s->rx_batch->addr[i]);
+            nb_msgs = recvmmsg(s->udp_fd, s->rx_batch->msgs, s->rx_batch_size,
+                               MSG_WAITFORONE, NULL);
+        } else
+#endif
+        {
+            len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
+            nb_msgs = len < 0 ? len : 1;
+        }
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
-        if (len < 0) {
+        if (nb_msgs < 0) {
             if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
                 s->circular_buffer_error = ff_neterrno();
                 goto end;
             }
             continue;
         }
-        if (ff_ip_check_source_lists(&addr, &s->filters))
-            continue;
-        AV_WL32(s->tmp, len);
-
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+        for (i = 0; i < nb_msgs; i++) {
+            uint8_t *dg = s->tmp;
+            struct sockaddr_storage *src = &addr;
+
+#if HAVE_RECVMMSG
+            if (s->rx_batch) {
+                dg  = (uint8_t *)s->rx_batch->iov[i].iov_base - 4;
+                src = &s->rx_batch->addr[i];
+                len = s->rx_batch->msgs[i].msg_len;
+            }
+#endif
+            if (ff_ip_check_source_lists(src, &s->filters))
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
+            AV_WL32(dg, len);
+
+            if(av_fifo_space(s->fifo) < len + 4) {
+                /* No Space left */
+                if (s->overrun_nonfatal) {
+                    av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                            "Surviving due to overrun_nonfatal option\n");
+                    continue;
+                } else {
+                    av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                            "To avoid, increase fifo_size URL option. "
+                            "To survive in such case, use overrun_nonfatal option\n");
+                    s->circular_buffer_error = AVERROR(EIO);
+                    goto end;
+                }
             }
+            av_fifo_generic_write(s->fifo, dg, len+4, NULL);
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
         pthread_cond_signal(&s->cond);
     }
 
@@ -590,17 +757,11 @@ static void *circular_buffer_task_tx( void *_URLContext)
         while (len) {
             int ret;
             av_assert0(len > 0);
-            if (!s->is_connected) {
-                ret = sendto (s->udp_fd, p, len, 0,
-                            (struct sockaddr *) &s->dest_addr,
-                            s->dest_addr_len);
-            } else
-                ret = send(s->udp_fd, p, len, 0);
+            ret = udp_write_packet(h, p, len);
             if (ret >= 0) {
                 len -= ret;
                 p   += ret;
             } else {
-                ret = ff_neterrno();
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR)) {
                     pthread_mutex_lock(&s->mutex);
                     s->circular_buffer_error = ret;
@@ -683,6 +844,9 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "pkt_size", p)) {
             s->pkt_size = strtol(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p)) {
+            s->batch_size = strtol(buf, NULL, 10);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "buffer_size", p)) {
             s->buffer_size = strtol(buf, NULL, 10);
         }
@@ -729,6 +893,12 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     s->circular_buffer_size *= 188;
     if (flags & AVIO_FLAG_WRITE) {
         h->max_packet_size = s->pkt_size;
+        /* Let the caller hand over several datagrams per write. */
+        if (s->batch_size > 1 && s->pkt_size > 0 &&
+            FFMIN(s->batch_size, UDP_MAX_BATCH_BYTES / s->pkt_size) > 1) {
+            s->tx_batch = FFMIN(s->batch_size, UDP_MAX_BATCH_BYTES / s->pkt_size);
+            h->max_packet_size = s->tx_batch * s->pkt_size;
+        }
     } else {
         h->max_packet_size = UDP_MAX_PKT_SIZE;
     }
@@ -860,6 +1030,14 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             ret = ff_neterrno();
             goto fail;
         }
+#ifdef UDP_SEGMENT
+        /* With a segment size set, the kernel splits every larger send into
+         * datagrams of that size. UDP-Lite does not support it. */
+        if (s->tx_batch && !s->udplite_coverage) {
+            tmp = s->pkt_size;
+            s->gso = !setsockopt(udp_fd, IPPROTO_UDP, UDP_SEGMENT, &tmp, sizeof(tmp));
+        }
+#endif
     } else {
         /* set udp recv buffer size to the requested value (default UDP_RX_BUF_SIZE) */
         tmp = s->buffer_size;
@@ -907,6 +1085,13 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             ret = AVERROR(ENOMEM);
             goto fail;
         }
+#if HAVE_RECVMMSG
+        if (!is_output) {
+            int nb_msgs = s->batch_size < 0 ? UDP_DEFAULT_RX_BATCH_SIZE : s->batch_size;
+            if (nb_msgs > 1 && (ret = udp_alloc_rx_batch(s, nb_msgs)) < 0)
+                goto fail;
+        }
+#endif
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -940,6 +1125,9 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_RECVMMSG
+    udp_free_rx_batch(s);
+#endif
     ff_ip_reset_filters(&s->filters);
     return ret;
 }
@@ -1058,14 +1246,7 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
             return ret;
     }
 
-    if (!s->is_connected) {
-        ret = sendto (s->udp_fd, buf, size, 0,
-                      (struct sockaddr *) &s->dest_addr,
-                      s->dest_addr_len);
-    } else
-        ret = send(s->udp_fd, buf, size, 0);
-
-    return ret < 0 ? ff_neterrno() : ret;
+    return udp_write_packet(h, buf, size);
 }
 
 static int udp_close(URLContext *h)
@@ -1108,6 +1289,9 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_RECVMMSG
+    udp_free_rx_batch(s);
+#endif
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
@@ -648,6 +648,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
     for (i = 0; i < s->nb_streams; i++)
         s->streams[i]->internal->orig_codec_id = s->streams[i]->codecpar->codec_id;
 
+    if (s->seek_index && (ret = ff_seek_index_open(s)) < 0)
+        goto close;
+
     if (options) {
         av_dict_free(options);
         *options = tmp;
@@ -1746,8 +1749,11 @@ int av_read_frame(AVFormatContext *s, AVPacket *pkt)
               ? avpriv_packet_list_get(&s->internal->packet_buffer,
                                         &s->internal->packet_buffer_end, pkt)
               : read_frame_internal(s, pkt);
-        if (ret < 0)
+        if (ret < 0) {
+            if (s->internal->seek_index)
+                ff_seek_index_add(s, NULL, ret);
             return ret;
+        }
         goto return_packet;
     }
 
@@ -1803,8 +1809,11 @@ int av_read_frame(AVFormatContext *s, AVPacket *pkt)
             if (pktl && ret != AVERROR(EAGAIN)) {
                 eof = 1;
                 continue;
-            } else
+            } else {
+                if (s->internal->seek_index)
+                    ff_seek_index_add(s, NULL, ret);
                 return ret;
+            }
         }
 
         ret = avpriv_packet_list_put(&s->internal->packet_buffer,
@@ -1829,6 +1838,9 @@ return_packet:
     if (is_relative(pkt->pts))
         pkt->pts -= RELATIVE_TS_BASE;
 
+    if (s->internal->seek_index)
+        ff_seek_index_add(s, pkt, ret);
+
     return ret;
 }
 
@@ -2471,6 +2483,10 @@ static int seek_frame_internal(AVFormatContext *s, int stream_index,
     if (ret >= 0)
         return 0;
 
+    if (s->internal->seek_index &&
+        ff_seek_index_seek(s, stream_index, timestamp, flags) >= 0)
+        return 0;
+
     if (s->iformat->read_timestamp &&
         !(s->iformat->flags & AVFMT_NOBINSEARCH)) {
         ff_read_frame_flush(s);
@@ -2487,6 +2503,9 @@ int av_seek_frame(AVFormatContext *s, int stream_index,
 {
     int ret;
 
+    if (s->internal->seek_index)
+        ff_seek_index_abort(s);
+
     if (s->iformat->read_seek2 && !s->iformat->read_seek) {
         int64_t min_ts = INT64_MIN, max_ts = INT64_MAX;
         if ((flags & AVSEEK_FLAG_BACKWARD))
@@ -4476,6 +4495,9 @@ void avformat_close_input(AVFormatContext **ps)
 
     flush_packet_queue(s);
 
+    if (s->internal->seek_index)
+        ff_seek_index_close(s);
+
     if (s->iformat)
         if (s->iformat->read_close)
             s->iformat->read_close(s);
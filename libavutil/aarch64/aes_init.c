@@ -0,0 +1,80 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "config.h"
+
+#if HAVE_GETAUXVAL
+#include <sys/auxv.h>
+#endif
+
+#include "libavutil/aes_internal.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "cpu.h"
+
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+
+#define AES_CRYPT_FUNCS(rnd)                                                 \
+void ff_aes_encrypt_ ## rnd ## _armv8(AVAES *a, uint8_t *dst,                \
+                                      const uint8_t *src, int count,         \
+                                      uint8_t *iv, int rounds);              \
+void ff_aes_decrypt_ ## rnd ## _armv8(AVAES *a, uint8_t *dst,                \
+                                      const uint8_t *src, int count,         \
+                                      uint8_t *iv, int rounds);
+
+AES_CRYPT_FUNCS(10)
+AES_CRYPT_FUNCS(12)
+AES_CRYPT_FUNCS(14)
+
+/* The crypto extension is optional in ARMv8-A, so it is not implied by
+ * AV_CPU_FLAG_ARMV8 and has to be probed separately. */
+static av_cold int have_aes(int cpu_flags)
+{
+    if (!have_armv8(cpu_flags))
+        return 0;
+#if defined(__ARM_FEATURE_CRYPTO)
+    return 1;
+#elif HAVE_GETAUXVAL && defined(AT_HWCAP)
+    return !!(getauxval(AT_HWCAP) & HWCAP_AES);
+#else
+    return 0;
+#endif
+}
+
+av_cold void ff_init_aes_aarch64(AVAES *a, int decrypt)
+{
+    int cpu_flags = av_get_cpu_flags();
+
+    if (have_aes(cpu_flags)) {
+        switch (a->rounds) {
+        case 10:
+            a->crypt = decrypt ? ff_aes_decrypt_10_armv8 : ff_aes_encrypt_10_armv8;
+            break;
+        case 12:
+            a->crypt = decrypt ? ff_aes_decrypt_12_armv8 : ff_aes_encrypt_12_armv8;
+            break;
+        case 14:
+            a->crypt = decrypt ? ff_aes_decrypt_14_armv8 : ff_aes_encrypt_14_armv8;
+            break;
+        }
+    }
+}
@@ -263,6 +263,9 @@ int av_aes_init(AVAES *a, const uint8_t *key, int key_bits, int decrypt)
             FFSWAP(av_aes_block, a->round_key[i], a->round_key[rounds - i]);
     }
 
+    if (ARCH_AARCH64)
+        ff_init_aes_aarch64(a, decrypt);
+
     return 0;
 }
 
@@ -25,12 +25,14 @@
 #include "random_seed.h"
 
 #define AES_BLOCK_SIZE (16)
+#define AES_CTR_BATCH  (8)
 
 typedef struct AVAESCTR {
     struct AVAES* aes;
     uint8_t counter[AES_BLOCK_SIZE];
     uint8_t encrypted_counter[AES_BLOCK_SIZE];
     int block_offset;
+    uint8_t keystream[AES_CTR_BATCH * AES_BLOCK_SIZE];
 } AVAESCTR;
 
 struct AVAESCTR *av_aes_ctr_alloc(void)
@@ -114,6 +116,27 @@ void av_aes_ctr_crypt(struct AVAESCTR *a, uint8_t *dst, const uint8_t *src, int
     const uint8_t* cur_end_pos;
     uint8_t* encrypted_counter_pos;
 
+    /* Use up the keystream left over from the previous call first. */
+    while (a->block_offset && src < src_end) {
+        *dst++ = *src++ ^ a->encrypted_counter[a->block_offset++];
+        a->block_offset &= (AES_BLOCK_SIZE - 1);
+    }
+
+    /* Encrypt several counter blocks with a single call, so that
+     * optimized implementations can process them in parallel. */
+    while (src_end - src >= AES_BLOCK_SIZE) {
+        int i, nb_blocks = FFMIN((src_end - src) / AES_BLOCK_SIZE, AES_CTR_BATCH);
+
+        for (i = 0; i < nb_blocks; i++) {
+            memcpy(a->keystream + i * AES_BLOCK_SIZE, a->counter, AES_BLOCK_SIZE);
+            av_aes_ctr_increment_be64(a->counter + 8);
+        }
+        av_aes_crypt(a->aes, a->keystream, a->keystream, nb_blocks, NULL, 0);
+
+        for (i = 0; i < nb_blocks * AES_BLOCK_SIZE; i++)
+            *dst++ = *src++ ^ a->keystream[i];
+    }
+
     while (src < src_end) {
         if (a->block_offset == 0) {
             av_aes_crypt(a->aes, a->encrypted_counter, a->counter, 1, NULL, 0);
@@ -40,4 +40,6 @@ typedef struct AVAES {
     void (*crypt)(struct AVAES *a, uint8_t *dst, const uint8_t *src, int count, uint8_t *iv, int rounds);
 } AVAES;
 
+void ff_init_aes_aarch64(AVAES *a, int decrypt);
+
 #endif /* AVUTIL_AES_INTERNAL_H */
@@ -251,6 +251,7 @@ AVBufferPool *av_buffer_pool_init2(buffer_size_t size, void *opaque,
         return NULL;
 
     ff_mutex_init(&pool->mutex, NULL);
+    atomic_init(&pool->pool, 0);
 
     pool->size      = size;
     pool->opaque    = opaque;
@@ -270,6 +271,7 @@ AVBufferPool *av_buffer_pool_init(buffer_size_t size, AVBufferRef* (*alloc)(buff
         return NULL;
 
     ff_mutex_init(&pool->mutex, NULL);
+    atomic_init(&pool->pool, 0);
 
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
@@ -279,14 +281,67 @@ AVBufferPool *av_buffer_pool_init(buffer_size_t size, AVBufferRef* (*alloc)(buff
     return pool;
 }
 
-static void buffer_pool_flush(AVBufferPool *pool)
+static BufferPoolEntry *pool_entry(AVBufferPool *pool, unsigned index)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    int chunk = av_log2(index + 1);
+
+    return &pool->entries[chunk][index + 1 - ((size_t)1 << chunk)];
+}
 
+static void buffer_pool_push(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    intptr_t head = atomic_load_explicit(&pool->pool, memory_order_relaxed);
+
+    do {
+        atomic_store_explicit(&buf->next, (uintptr_t)head & POOL_INDEX_MASK,
+                              memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->pool, &head,
+                                                    ((uintptr_t)head & ~POOL_INDEX_MASK) |
+                                                    (buf->index + 1),
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static BufferPoolEntry *buffer_pool_pop(AVBufferPool *pool)
+{
+    BufferPoolEntry *buf;
+    intptr_t head = atomic_load_explicit(&pool->pool, memory_order_acquire);
+    uintptr_t next;
+
+    do {
+        unsigned top = (uintptr_t)head & POOL_INDEX_MASK;
+
+        if (!top)
+            return NULL;
+        buf  = pool_entry(pool, top - 1);
+        next = ((uintptr_t)head & ~POOL_INDEX_MASK) + ((uintptr_t)1 << POOL_TAG_SHIFT);
+        next |= atomic_load_explicit(&buf->next, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->pool, &head, next,
+                                                    memory_order_acquire,
+                                                    memory_order_acquire));
+
+    return buf;
+}
+
+static void buffer_pool_flush(AVBufferPool *pool)
+{
+    intptr_t head = atomic_load_explicit(&pool->pool, memory_order_relaxed);
+    unsigned top;
+
+    // taking the whole stack counts as a pop
+    while (!atomic_compare_exchange_weak_explicit(&pool->pool, &head,
+                                                  ((uintptr_t)head & ~POOL_INDEX_MASK) +
+                                                  ((uintptr_t)1 << POOL_TAG_SHIFT),
+                                                  memory_order_acquire,
+                                                  memory_order_relaxed))
+        ;
+
+    top = (uintptr_t)head & POOL_INDEX_MASK;
+    while (top) {
+        BufferPoolEntry *buf = pool_entry(pool, top - 1);
+
+        top = atomic_load_explicit(&buf->next, memory_order_relaxed);
         buf->free(buf->opaque, buf->data);
-        av_freep(&buf);
     }
 }
 
@@ -296,7 +351,11 @@ static void buffer_pool_flush(AVBufferPool *pool)
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
+    int i;
+
     buffer_pool_flush(pool);
+    for (i = 0; i < FF_ARRAY_ELEMS(pool->entries); i++)
+        av_freep(&pool->entries[i]);
     ff_mutex_destroy(&pool->mutex);
 
     if (pool->pool_free)
@@ -314,9 +373,7 @@ void av_buffer_pool_uninit(AVBufferPool **ppool)
     pool   = *ppool;
     *ppool = NULL;
 
-    ff_mutex_lock(&pool->mutex);
     buffer_pool_flush(pool);
-    ff_mutex_unlock(&pool->mutex);
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -330,15 +387,38 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    buffer_pool_push(pool, buf);
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
 }
 
+static BufferPoolEntry *pool_add_entry(AVBufferPool *pool)
+{
+    unsigned index = pool->nb_entries;
+    BufferPoolEntry *buf;
+    int chunk;
+
+    // the stack stores index + 1, which must fit in POOL_INDEX_MASK
+    if (index >= POOL_INDEX_MASK - 1)
+        return NULL;
+
+    chunk = av_log2(index + 1);
+    if (!pool->entries[chunk]) {
+        pool->entries[chunk] = av_mallocz_array((size_t)1 << chunk,
+                                                sizeof(*pool->entries[chunk]));
+        if (!pool->entries[chunk])
+            return NULL;
+    }
+    pool->nb_entries++;
+
+    buf        = pool_entry(pool, index);
+    buf->index = index;
+    atomic_init(&buf->next, 0);
+
+    return buf;
+}
+
 /* allocate a new buffer and override its free() callback so that
  * it is returned to the pool on free */
 static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
@@ -353,7 +433,7 @@ static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
     if (!ret)
         return NULL;
 
-    buf = av_mallocz(sizeof(*buf));
+    buf = pool_add_entry(pool);
     if (!buf) {
         av_buffer_unref(&ret);
         return NULL;
@@ -375,19 +455,17 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     AVBufferRef *ret;
     BufferPoolEntry *buf;
 
-    ff_mutex_lock(&pool->mutex);
-    buf = pool->pool;
+    buf = buffer_pool_pop(pool);
     if (buf) {
         ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
                                buf, 0);
-        if (ret) {
-            pool->pool = buf->next;
-            buf->next = NULL;
-        }
+        if (!ret)
+            buffer_pool_push(pool, buf);
     } else {
+        ff_mutex_lock(&pool->mutex);
         ret = pool_alloc_buffer(pool);
+        ff_mutex_unlock(&pool->mutex);
     }
-    ff_mutex_unlock(&pool->mutex);
 
     if (ret)
         atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
@@ -72,12 +72,38 @@ typedef struct BufferPoolEntry {
     void (*free)(void *opaque, uint8_t *data);
 
     AVBufferPool *pool;
-    struct BufferPoolEntry *next;
+
+    /* position of this entry in AVBufferPool.entries */
+    unsigned index;
+    /* index + 1 of the next free entry, 0 for none */
+    atomic_uint next;
 } BufferPoolEntry;
 
+/* The lower half of AVBufferPool.pool holds the index + 1 of the top entry,
+ * the upper half counts the pops. */
+#define POOL_TAG_SHIFT  (4 * sizeof(intptr_t))
+#define POOL_INDEX_MASK (((uintptr_t)1 << POOL_TAG_SHIFT) - 1)
+
 struct AVBufferPool {
+    /**
+     * Serializes the alloc callbacks and adding entries.
+     * Getting and returning pooled buffers does not take it.
+     */
     AVMutex mutex;
-    BufferPoolEntry *pool;
+
+    /**
+     * Stack of free BufferPoolEntry, changed with a compare-and-swap.
+     * Counting the pops next to the top entry keeps a pop from succeeding
+     * when the top was popped and pushed back since it was read (ABA).
+     */
+    atomic_intptr_t pool;
+
+    /**
+     * All the entries of the pool, in chunks of 1 << i entries that never
+     * move, so that the stack can refer to them by index.
+     */
+    BufferPoolEntry *entries[POOL_TAG_SHIFT];
+    unsigned nb_entries;
 
     /*
      * This is used to track when the pool is to be freed.
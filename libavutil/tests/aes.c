@@ -20,12 +20,72 @@
 
 #include "libavutil/timer.h"
 
+#include <stdio.h>
 #include <string.h>
 
 #include "libavutil/aes.h"
+#include "libavutil/aes_ctr.h"
 #include "libavutil/lfg.h"
 #include "libavutil/log.h"
 #include "libavutil/mem.h"
+#include "libavutil/time.h"
+
+#define BENCH_SIZE  (64 * 1024)
+#define BENCH_LOOPS 256
+
+static void print_throughput(const char *name, int64_t t)
+{
+    printf("%-16s %8.1f MB/s\n", name,
+           (double)BENCH_SIZE * BENCH_LOOPS / FFMAX(t, 1));
+}
+
+static int benchmark(void)
+{
+    static const int key_bits[] = { 128, 192, 256 };
+    static const uint8_t key[32] = "PI=3.141592654..PI=3.1415926535.";
+    uint8_t *buf = av_mallocz(BENCH_SIZE);
+    struct AVAES *a = av_aes_alloc();
+    struct AVAESCTR *ctr = av_aes_ctr_alloc();
+    uint8_t iv[16] = { 0 };
+    char name[32];
+    int i, j, decrypt;
+    int64_t t;
+
+    if (!buf || !a || !ctr || av_aes_ctr_init(ctr, key) < 0) {
+        av_free(buf);
+        av_free(a);
+        av_aes_ctr_free(ctr);
+        return 1;
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(key_bits); i++) {
+        for (decrypt = 0; decrypt < 2; decrypt++) {
+            av_aes_init(a, key, key_bits[i], decrypt);
+
+            t = av_gettime_relative();
+            for (j = 0; j < BENCH_LOOPS; j++)
+                av_aes_crypt(a, buf, buf, BENCH_SIZE / 16, NULL, decrypt);
+            snprintf(name, sizeof(name), "ecb-%d-%s", key_bits[i], decrypt ? "dec" : "enc");
+            print_throughput(name, av_gettime_relative() - t);
+
+            t = av_gettime_relative();
+            for (j = 0; j < BENCH_LOOPS; j++)
+                av_aes_crypt(a, buf, buf, BENCH_SIZE / 16, iv, decrypt);
+            snprintf(name, sizeof(name), "cbc-%d-%s", key_bits[i], decrypt ? "dec" : "enc");
+            print_throughput(name, av_gettime_relative() - t);
+        }
+    }
+
+    t = av_gettime_relative();
+    for (j = 0; j < BENCH_LOOPS; j++)
+        av_aes_ctr_crypt(ctr, buf, buf, BENCH_SIZE);
+    print_throughput("ctr-128", av_gettime_relative() - t);
+
+    av_free(buf);
+    av_free(a);
+    av_aes_ctr_free(ctr);
+    return 0;
+}
 
 int main(int argc, char **argv)
 {
@@ -117,6 +177,10 @@ int main(int argc, char **argv)
         av_free(ae);
         av_free(ad);
     }
+
+    if (argc > 1 && !strcmp(argv[1], "-b"))
+        err |= benchmark();
+
     return err;
 }
 // LCOV_EXCL_STOP
@@ -0,0 +1,170 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Get and release buffers from one pool in several threads at once, check
+ * that no buffer is handed out twice, and optionally measure the throughput.
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/internal.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/lfg.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define BUF_SIZE 4096
+#define NB_HELD  8
+
+typedef struct ThreadContext {
+    pthread_t thread;
+    AVBufferPool *pool;
+    int id;
+    int iterations;
+    int errors;
+} ThreadContext;
+
+static atomic_int nb_allocated;
+
+static AVBufferRef *counting_alloc(void *opaque, buffer_size_t size)
+{
+    atomic_fetch_add(&nb_allocated, 1);
+    return av_buffer_alloc(size);
+}
+
+static void *worker(void *arg)
+{
+    ThreadContext *t = arg;
+    AVBufferRef *held[NB_HELD] = { NULL };
+    AVLFG lfg;
+    int i;
+
+    av_lfg_init(&lfg, t->id);
+
+    for (i = 0; i < t->iterations; i++) {
+        int slot = av_lfg_get(&lfg) % NB_HELD;
+
+        if (held[slot]) {
+            /* Nobody else may have written to the buffer while we held it */
+            if (AV_RN32(held[slot]->data)                != t->id ||
+                AV_RN32(held[slot]->data + BUF_SIZE - 4) != slot)
+                t->errors++;
+            av_buffer_unref(&held[slot]);
+            continue;
+        }
+
+        held[slot] = av_buffer_pool_get(t->pool);
+        if (!held[slot]) {
+            t->errors++;
+            break;
+        }
+        AV_WN32(held[slot]->data,                t->id);
+        AV_WN32(held[slot]->data + BUF_SIZE - 4, slot);
+    }
+
+    for (i = 0; i < NB_HELD; i++)
+        av_buffer_unref(&held[i]);
+
+    return NULL;
+}
+
+static int run(int nb_threads, int iterations, int64_t *elapsed)
+{
+    ThreadContext *threads;
+    AVBufferPool *pool;
+    int64_t start;
+    int i, ret, errors = 0;
+
+    pool    = av_buffer_pool_init2(BUF_SIZE, NULL, counting_alloc, NULL);
+    threads = calloc(nb_threads, sizeof(*threads));
+    if (!pool || !threads) {
+        av_buffer_pool_uninit(&pool);
+        free(threads);
+        return -1;
+    }
+
+    atomic_store(&nb_allocated, 0);
+    start = av_gettime_relative();
+
+    for (i = 0; i < nb_threads; i++) {
+        threads[i].pool       = pool;
+        threads[i].id         = i + 1;
+        threads[i].iterations = iterations;
+        if ((ret = pthread_create(&threads[i].thread, NULL, worker, &threads[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            nb_threads = i;
+            errors++;
+            break;
+        }
+    }
+    for (i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i].thread, NULL);
+        errors += threads[i].errors;
+    }
+
+    *elapsed = av_gettime_relative() - start;
+
+    av_buffer_pool_uninit(&pool);
+    free(threads);
+
+    return errors;
+}
+
+static const char *usage = "buffer_pool [-threads <nb_threads>] [-iterations <n>] [-bench]\n";
+
+int main(int argc, char **argv)
+{
+    int nb_threads = 4, iterations = 100000, bench = 0;
+    int64_t elapsed;
+    int i, errors;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-bench")) {
+            bench = 1;
+        } else if (i + 1 < argc && !strcmp(argv[i], "-threads")) {
+            nb_threads = atoi(argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-iterations")) {
+            iterations = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "%s", usage);
+            return 1;
+        }
+    }
+    if (nb_threads < 1 || iterations < 0) {
+        fprintf(stderr, "%s", usage);
+        return 1;
+    }
+
+    errors = run(nb_threads, iterations, &elapsed);
+    if (errors) {
+        fprintf(stderr, "%d errors\n", errors);
+        return 1;
+    }
+
+    if (bench)
+        printf("%d threads: %.1f ns per operation, %d buffers allocated\n",
+               nb_threads, elapsed * 1000.0 / FFMAX((int64_t)nb_threads * iterations, 1),
+               atomic_load(&nb_allocated));
+
+    return 0;
+}
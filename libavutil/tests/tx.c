@@ -0,0 +1,222 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check the transforms against a direct evaluation of their definition,
+ * and optionally measure their speed (-b) at the sizes codecs use.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavutil/tx.h"
+
+#define MAX_LEN 4096
+
+/* Power of two and 3/5/15-factor sizes used by AAC, AC-3, Opus and others */
+static const int fft_lens[] = {
+    2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096,
+    30, 60, 120, 240, 480, 960, 40, 80, 320, 24, 48, 96, 7,
+};
+
+static const int mdct_lens[] = {
+    64, 128, 256, 512, 1024, 2048, 120, 240, 480, 960, 160, 320, 40, 60,
+};
+
+static const struct {
+    const char *name;
+    enum AVTXType fft, mdct;
+    int size;
+    double tolerance;
+} types[] = {
+    { "float",  AV_TX_FLOAT_FFT,  AV_TX_FLOAT_MDCT,  sizeof(float),   1e-5  },
+    { "double", AV_TX_DOUBLE_FFT, AV_TX_DOUBLE_MDCT, sizeof(double),  1e-12 },
+};
+
+static double get_sample(const void *buf, int type, int idx)
+{
+    return type ? ((const double *)buf)[idx] : ((const float *)buf)[idx];
+}
+
+static void set_sample(void *buf, int type, int idx, double val)
+{
+    if (type)
+        ((double *)buf)[idx] = val;
+    else
+        ((float  *)buf)[idx] = val;
+}
+
+static void ref_fft(double *out, const double *in, int len, int inv)
+{
+    const double phase = (inv ? 2.0 : -2.0) * M_PI / len;
+
+    for (int i = 0; i < len; i++) {
+        double re = 0.0, im = 0.0;
+        for (int j = 0; j < len; j++) {
+            double c = cos(phase * ((int64_t)i * j % len));
+            double s = sin(phase * ((int64_t)i * j % len));
+            re += in[2*j] * c - in[2*j + 1] * s;
+            im += in[2*j] * s + in[2*j + 1] * c;
+        }
+        out[2*i]     = re;
+        out[2*i + 1] = im;
+    }
+}
+
+/* len is the number of output coefficients, the input has 2*len samples */
+static void ref_mdct(double *out, const double *in, int len, double scale)
+{
+    for (int i = 0; i < len; i++) {
+        double sum = 0.0;
+        for (int j = 0; j < 2*len; j++)
+            sum += in[j] * cos(M_PI / len * (j + 0.5 + len / 2.0) * (i + 0.5));
+        out[i] = sum * scale;
+    }
+}
+
+/* Half-length inverse, outputs len of the 2*len samples, in the same order
+ * as the transforms do */
+static void ref_imdct(double *out, const double *in, int len, double scale)
+{
+    const double phase = M_PI / (4.0 * len);
+
+    for (int i = 0; i < len / 2; i++) {
+        double sum_d = 0.0, sum_u = 0.0;
+        for (int j = 0; j < len; j++) {
+            sum_d += in[j] * cos(phase * (2*j + 1) * (2*len - 2*i - 1));
+            sum_u += in[j] * cos(phase * (2*j + 1) * (3*len + 2*i + 1));
+        }
+        out[i]           =  sum_d * scale;
+        out[i + len / 2] = -sum_u * scale;
+    }
+}
+
+static double max_error(const void *out, int type, const double *ref, int len)
+{
+    double err = 0.0, peak = 1.0;
+
+    for (int i = 0; i < len; i++) {
+        err  = FFMAX(err, fabs(get_sample(out, type, i) - ref[i]));
+        peak = FFMAX(peak, fabs(ref[i]));
+    }
+
+    return err / peak;
+}
+
+static int check_tx(int type, int mdct, int inv, int len, int flags,
+                    AVLFG *lfg, int bench)
+{
+    const int nb_in  = mdct ? (inv ? len : 2*len) : 2*len;
+    const int nb_out = mdct ? len : 2*len;
+    const double scale_d = mdct ? (inv ? 1.0 : 1.0 / len) : 1.0;
+    void *in = NULL, *out = NULL;
+    double *ref_in = NULL, *ref_out = NULL;
+    AVTXContext *ctx = NULL;
+    av_tx_fn tx;
+    float scale_f = scale_d;
+    double err;
+    int ret;
+
+    ret = av_tx_init(&ctx, &tx, mdct ? types[type].mdct : types[type].fft, inv,
+                     len, type == 1 ? (void *)&scale_d : (void *)&scale_f, flags);
+    if (ret < 0) {
+        printf("%s %s%s %d: init failed\n", types[type].name, inv ? "i" : "",
+               mdct ? "mdct" : "fft", len);
+        return 1;
+    }
+
+    in      = av_malloc(2*MAX_LEN * types[type].size);
+    out     = av_malloc(2*MAX_LEN * types[type].size);
+    ref_in  = av_malloc(2*MAX_LEN * sizeof(*ref_in));
+    ref_out = av_malloc(2*MAX_LEN * sizeof(*ref_out));
+    if (!in || !out || !ref_in || !ref_out) {
+        ret = 1;
+        goto end;
+    }
+
+    for (int i = 0; i < nb_in; i++) {
+        set_sample(in, type, i, av_lfg_get(lfg) / (double)UINT32_MAX - 0.5);
+        ref_in[i] = get_sample(in, type, i);
+    }
+
+    if (!mdct)
+        ref_fft(ref_out, ref_in, len, inv);
+    else if (inv)
+        ref_imdct(ref_out, ref_in, len, scale_d);
+    else
+        ref_mdct(ref_out, ref_in, len, scale_d);
+
+    if (flags & AV_TX_INPLACE) {
+        memcpy(out, in, nb_in * types[type].size);
+        tx(ctx, out, out, types[type].size);
+    } else {
+        tx(ctx, out, in, types[type].size);
+    }
+
+    err = max_error(out, type, ref_out, nb_out);
+    ret = !(err <= types[type].tolerance);
+    printf("%s %s%s %d%s: %s\n", types[type].name, inv ? "i" : "",
+           mdct ? "mdct" : "fft", len, flags & AV_TX_INPLACE ? " inplace" : "",
+           ret ? "FAIL" : "OK");
+    if (ret)
+        printf("    relative error %g\n", err);
+
+    if (bench > 0) {
+        int64_t t = av_gettime_relative();
+        for (int i = 0; i < bench; i++)
+            tx(ctx, out, in, types[type].size);
+        t = av_gettime_relative() - t;
+        printf("    %.1f ns per transform\n", t * 1000.0 / bench);
+    }
+
+end:
+    av_free(in);
+    av_free(out);
+    av_free(ref_in);
+    av_free(ref_out);
+    av_tx_uninit(&ctx);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int bench = 0, ret = 0;
+    AVLFG lfg;
+
+    if (argc > 1 && !strcmp(argv[1], "-b"))
+        bench = argc > 2 ? atoi(argv[2]) : 10000;
+
+    av_lfg_init(&lfg, 0xC0FFEE);
+
+    for (int type = 0; type < FF_ARRAY_ELEMS(types); type++) {
+        for (int inv = 0; inv < 2; inv++) {
+            for (int i = 0; i < FF_ARRAY_ELEMS(fft_lens); i++)
+                ret |= check_tx(type, 0, inv, fft_lens[i], 0, &lfg, bench);
+            for (int i = 0; i < FF_ARRAY_ELEMS(mdct_lens); i++)
+                ret |= check_tx(type, 1, inv, mdct_lens[i], 0, &lfg, bench);
+        }
+        ret |= check_tx(type, 0, 0, 1024, AV_TX_INPLACE, &lfg, 0);
+    }
+
+    return ret;
+}
@@ -243,6 +243,8 @@ static int swscale(SwsContext *c, const uint8_t *src[],
      * and faster */
     const int dstW                   = c->dstW;
     const int dstH                   = c->dstH;
+    const int scale_dst              = c->dstSliceH > 0;
+    const int dstEnd                 = scale_dst ? c->dstSliceY + c->dstSliceH : dstH;
 
     const enum AVPixelFormat dstFormat = c->dstFormat;
     const int flags                  = c->flags;
@@ -334,7 +336,13 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     /* Note the user might start scaling the picture in the middle so this
      * will not get executed. This is not really intended but works
      * currently, so people might do it. */
-    if (srcSliceY == 0) {
+    if (scale_dst) {
+        /* Slice threads get the whole source picture and output only their
+         * own band of destination lines. */
+        dstY         = c->dstSliceY;
+        lastInLumBuf = -1;
+        lastInChrBuf = -1;
+    } else if (srcSliceY == 0) {
         dstY         = 0;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
@@ -351,9 +359,14 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     ff_init_slice_from_src(src_slice, (uint8_t**)src, srcStride, c->srcW,
             srcSliceY, srcSliceH, chrSrcSliceY, chrSrcSliceH, 1);
 
-    ff_init_slice_from_src(vout_slice, (uint8_t**)dst, dstStride, c->dstW,
-            dstY, dstH, dstY >> c->chrDstVSubSample,
-            AV_CEIL_RSHIFT(dstH, c->chrDstVSubSample), 0);
+    if (scale_dst)
+        ff_init_slice_from_src(vout_slice, (uint8_t**)dst, dstStride, c->dstW,
+                dstY, dstEnd - dstY, dstY >> c->chrDstVSubSample,
+                AV_CEIL_RSHIFT(dstEnd, c->chrDstVSubSample) - (dstY >> c->chrDstVSubSample), 0);
+    else
+        ff_init_slice_from_src(vout_slice, (uint8_t**)dst, dstStride, c->dstW,
+                dstY, dstH, dstY >> c->chrDstVSubSample,
+                AV_CEIL_RSHIFT(dstH, c->chrDstVSubSample), 0);
     if (srcSliceY == 0) {
         hout_slice->plane[0].sliceY = lastInLumBuf + 1;
         hout_slice->plane[1].sliceY = lastInChrBuf + 1;
@@ -367,7 +380,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         hout_slice->width = dstW;
     }
 
-    for (; dstY < dstH; dstY++) {
+    for (; dstY < dstEnd; dstY++) {
         const int chrDstY = dstY >> c->chrDstVSubSample;
         int use_mmx_vfilter= c->use_mmx_vfilter;
 
@@ -738,6 +751,113 @@ static void rgb48Toxyz12(struct SwsContext *c, uint16_t *dst,
     }
 }
 
+static int scale_unscaled_slice(SwsContext *c, const uint8_t *const src[],
+                                const int srcStride[], int srcSliceY,
+                                int srcSliceH, uint8_t *const dst[],
+                                const int dstStride[])
+{
+    const uint8_t *src2[4];
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        int vsub = (i == 1 || i == 2) ? c->chrSrcVSubSample : 0;
+        src2[i] = src[i];
+        if (src[i] && !(i == 1 && usePal(c->srcFormat)))
+            src2[i] += (srcSliceY >> vsub) * srcStride[i];
+    }
+
+    /* the slices of one picture are fed to the slice contexts out of order */
+    c->sliceDir = 1;
+    return sws_scale(c, src2, srcStride, srcSliceY, srcSliceH, dst, dstStride);
+}
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsContext *parent = priv;
+    SwsContext      *c = parent->slice_ctx[threadnr];
+    int align, total, slice_h, start, ret;
+
+    if (c->swscale != swscale) {
+        /* Special converters map source lines directly to destination
+         * lines, so split the picture on the source side. */
+        align = isBayer(c->srcFormat) ? 2 : 1 << c->chrSrcVSubSample;
+        align = FFMAX(align, 1 << c->chrDstVSubSample);
+        total = c->srcH;
+    } else {
+        align = 1 << c->chrDstVSubSample;
+        total = c->dstH;
+    }
+
+    slice_h = FFALIGN((total + nb_jobs - 1) / nb_jobs, align);
+    start   = jobnr * slice_h;
+    if (start >= total)
+        return;
+    slice_h = FFMIN(slice_h, total - start);
+
+    if (c->swscale != swscale) {
+        ret = scale_unscaled_slice(c, parent->slice_src, parent->slice_srcStride,
+                                   start, slice_h,
+                                   parent->slice_dst, parent->slice_dstStride);
+    } else {
+        c->dstSliceY = start;
+        c->dstSliceH = slice_h;
+        ret = sws_scale(c, parent->slice_src, parent->slice_srcStride, 0, c->srcH,
+                        parent->slice_dst, parent->slice_dstStride);
+        c->dstSliceY = 0;
+        c->dstSliceH = 0;
+    }
+
+    if (ret < 0)
+        parent->slice_err[threadnr] = ret;
+    else if (ret != slice_h)
+        parent->slice_err[threadnr] = AVERROR_BUG;
+}
+
+static int scale_threaded(SwsContext *c, const uint8_t *const src[],
+                          const int srcStride[], uint8_t *const dst[],
+                          const int dstStride[])
+{
+    int i, ret = 0;
+
+    c->slice_src       = src;
+    c->slice_srcStride = srcStride;
+    c->slice_dst       = dst;
+    c->slice_dstStride = dstStride;
+    memset(c->slice_err, 0, c->nb_slice_ctx * sizeof(*c->slice_err));
+
+    avpriv_slicethread_execute(c->slicethread, c->nb_slice_ctx, 0);
+
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        if (c->slice_err[i] < 0) {
+            ret = c->slice_err[i];
+            break;
+        }
+    }
+
+    c->slice_src       = NULL;
+    c->slice_srcStride = NULL;
+    c->slice_dst       = NULL;
+    c->slice_dstStride = NULL;
+
+    return ret < 0 ? ret : c->dstH;
+}
+
+/**
+ * Check whether a sws_scale() call on the whole picture can be split
+ * between the slice contexts without changing the output.
+ */
+static int can_scale_threaded(SwsContext *c)
+{
+    return c->slicethread && c->sliceDir == 0 &&
+           !c->cascaded_context[0] && !c->gamma_flag &&
+           !c->srcXYZ && !c->dstXYZ && !c->vChrDrop &&
+           /* error diffusion carries state from one line to the next */
+           c->dither != SWS_DITHER_ED &&
+           /* slice contexts may have set up cascaded scalers of their own */
+           !c->slice_ctx[0]->cascaded_context[0];
+}
+
 /**
  * swscale wrapper, so we don't need to export the SwsContext.
  * Assumes planar YUV to be in YUV order instead of YVU.
@@ -775,6 +895,9 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
         return AVERROR(EINVAL);
     }
 
+    if (srcSliceY == 0 && srcSliceH == c->srcH && can_scale_threaded(c))
+        return scale_threaded(c, srcSlice, srcStride, dst, dstStride);
+
     if (c->gamma_flag && c->cascaded_context[0]) {
         ret = sws_scale(c->cascaded_context[0],
                     srcSlice, srcStride, srcSliceY, srcSliceH,
@@ -983,3 +1106,34 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     av_free(rgb0_tmp);
     return ret;
 }
+
+int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src)
+{
+    int ret;
+
+    if (src->width != c->srcW || src->height != c->srcH) {
+        av_log(c, AV_LOG_ERROR, "Source frame size %dx%d does not match "
+               "the scaler configuration %dx%d\n",
+               src->width, src->height, c->srcW, c->srcH);
+        return AVERROR(EINVAL);
+    }
+
+    if (!dst->buf[0]) {
+        dst->width  = c->dstW;
+        dst->height = c->dstH;
+        dst->format = c->dstFormat;
+
+        ret = av_frame_get_buffer(dst, 0);
+        if (ret < 0)
+            return ret;
+    } else if (dst->width != c->dstW || dst->height != c->dstH) {
+        av_log(c, AV_LOG_ERROR, "Destination frame size %dx%d does not match "
+               "the scaler configuration %dx%d\n",
+               dst->width, dst->height, c->dstW, c->dstH);
+        return AVERROR(EINVAL);
+    }
+
+    ret = sws_scale(c, (const uint8_t * const *)src->data, src->linesize,
+                    0, src->height, dst->data, dst->linesize);
+    return ret < 0 ? ret : 0;
+}
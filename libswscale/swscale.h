@@ -30,6 +30,7 @@
 #include <stdint.h>
 
 #include "libavutil/avutil.h"
+#include "libavutil/frame.h"
 #include "libavutil/log.h"
 #include "libavutil/pixfmt.h"
 #include "version.h"
@@ -218,6 +219,25 @@ int sws_scale(struct SwsContext *c, const uint8_t *const srcSlice[],
               const int srcStride[], int srcSliceY, int srcSliceH,
               uint8_t *const dst[], const int dstStride[]);
 
+/**
+ * Scale source data from src and write the output to dst.
+ *
+ * The whole picture is processed at once; if the context was created with
+ * the "threads" option set to a value other than 1, it is split into
+ * horizontal bands that are scaled in parallel. The output is identical
+ * to the single-threaded one.
+ *
+ * @param c   the scaling context
+ * @param dst the destination frame. If it has no buffers yet, they are
+ *            allocated with the destination width, height and format of
+ *            the context. Otherwise its dimensions must match the
+ *            destination dimensions of the context.
+ * @param src the source frame, its dimensions must match the source
+ *            dimensions of the context
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int sws_scale_frame(struct SwsContext *c, AVFrame *dst, const AVFrame *src);
+
 /**
  * @param dstRange flag indicating the while-black range of the output (1=jpeg / 0=mpeg)
  * @param srcRange flag indicating the while-black range of the input (1=jpeg / 0=mpeg)
@@ -33,6 +33,7 @@
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/ppc/util_altivec.h"
+#include "libavutil/slicethread.h"
 
 #define STR(s) AV_TOSTRING(s) // AV_STRINGIFY is too long
 
@@ -324,6 +325,21 @@ typedef struct SwsContext {
     uint8_t *cascaded1_tmp[4];
     int cascaded_mainindex;
 
+    /* Slice threading: the picture is split into horizontal bands, each
+     * one handled by its own single-threaded context in slice_ctx.
+     */
+    int nb_threads;               ///< Number of threads requested by the user, 0 for automatic.
+    AVSliceThread *slicethread;
+    struct SwsContext **slice_ctx;
+    int *slice_err;
+    int nb_slice_ctx;
+    const uint8_t *const *slice_src; ///< Source planes of the sws_scale() call being executed by the slice threads.
+    const int *slice_srcStride;
+    uint8_t *const *slice_dst;    ///< Destination planes of the sws_scale() call being executed by the slice threads.
+    const int *slice_dstStride;
+    int dstSliceY;                ///< First destination line to output, only set on slice contexts.
+    int dstSliceH;                ///< Number of destination lines to output, 0 for the whole picture.
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
@@ -872,6 +888,13 @@ void ff_get_unscaled_swscale_aarch64(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+/**
+ * Slice thread worker, scales one horizontal band of the picture passed to
+ * sws_scale() using the slice context of the calling thread.
+ */
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
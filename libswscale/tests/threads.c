@@ -0,0 +1,225 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Check that slice threaded scaling produces the same output as the
+ * single-threaded path, and optionally measure the speedup.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/avutil.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/lfg.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+
+#include "libswscale/swscale.h"
+
+static const struct {
+    enum AVPixelFormat src_fmt;
+    int src_w, src_h;
+    enum AVPixelFormat dst_fmt;
+    int dst_w, dst_h;
+    int flags;
+} tests[] = {
+    { AV_PIX_FMT_YUV420P,     1920, 1080, AV_PIX_FMT_YUV420P, 1280, 720, SWS_BICUBIC },
+    { AV_PIX_FMT_YUV420P,     1920, 1080, AV_PIX_FMT_YUV420P,  640, 360, SWS_BILINEAR },
+    { AV_PIX_FMT_YUV422P10LE, 1920, 1080, AV_PIX_FMT_YUV420P, 1280, 720, SWS_LANCZOS },
+    { AV_PIX_FMT_YUV420P,     1280,  720, AV_PIX_FMT_NV12,    1920, 1080, SWS_SPLINE },
+    { AV_PIX_FMT_NV12,        1280,  720, AV_PIX_FMT_YUV420P, 1280, 720, SWS_BICUBIC },
+    { AV_PIX_FMT_YUV420P,      640,  480, AV_PIX_FMT_RGB24,    640, 480, SWS_BICUBIC },
+    { AV_PIX_FMT_RGB24,        640,  480, AV_PIX_FMT_YUV420P,  320, 240, SWS_AREA },
+    { AV_PIX_FMT_YUV420P,      352,  288, AV_PIX_FMT_BGRA,     704, 576, SWS_BICUBIC | SWS_ACCURATE_RND },
+    { AV_PIX_FMT_YUVA420P,     321,  241, AV_PIX_FMT_YUVA444P, 160, 121, SWS_GAUSS },
+    { AV_PIX_FMT_GRAY8,        100,   75, AV_PIX_FMT_YUV444P,  200, 150, SWS_FAST_BILINEAR },
+    { AV_PIX_FMT_PAL8,         320,  240, AV_PIX_FMT_YUV420P,  160, 120, SWS_POINT },
+};
+
+static void fill_random(AVFrame *frame, AVLFG *lfg)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    int p, x, y;
+
+    for (p = 0; p < 4 && frame->data[p]; p++) {
+        int h = frame->height;
+        int w = av_image_get_linesize(frame->format, frame->width, p);
+
+        if (p == 1 && desc->flags & AV_PIX_FMT_FLAG_PAL) {
+            h = 1;
+            w = AVPALETTE_SIZE;
+        } else if (p == 1 || p == 2) {
+            h = AV_CEIL_RSHIFT(h, desc->log2_chroma_h);
+        }
+
+        for (y = 0; y < h; y++)
+            for (x = 0; x < w; x++)
+                frame->data[p][y * frame->linesize[p] + x] = av_lfg_get(lfg);
+    }
+}
+
+static int compare_frames(const AVFrame *a, const AVFrame *b)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(a->format);
+    int p, y;
+
+    for (p = 0; p < 4 && a->data[p]; p++) {
+        int h = a->height;
+        int w = av_image_get_linesize(a->format, a->width, p);
+
+        if (p == 1 || p == 2)
+            h = AV_CEIL_RSHIFT(h, desc->log2_chroma_h);
+
+        for (y = 0; y < h; y++)
+            if (memcmp(a->data[p] + y * a->linesize[p],
+                       b->data[p] + y * b->linesize[p], w))
+                return 1;
+    }
+
+    return 0;
+}
+
+static struct SwsContext *alloc_scaler(int idx, int nb_threads)
+{
+    struct SwsContext *c = sws_alloc_context();
+    if (!c)
+        return NULL;
+
+    av_opt_set_int(c, "srcw",       tests[idx].src_w,   0);
+    av_opt_set_int(c, "srch",       tests[idx].src_h,   0);
+    av_opt_set_int(c, "src_format", tests[idx].src_fmt, 0);
+    av_opt_set_int(c, "dstw",       tests[idx].dst_w,   0);
+    av_opt_set_int(c, "dsth",       tests[idx].dst_h,   0);
+    av_opt_set_int(c, "dst_format", tests[idx].dst_fmt, 0);
+    av_opt_set_int(c, "sws_flags",  tests[idx].flags,   0);
+    av_opt_set_int(c, "threads",    nb_threads,         0);
+
+    if (sws_init_context(c, NULL, NULL) < 0) {
+        sws_freeContext(c);
+        return NULL;
+    }
+
+    return c;
+}
+
+static int64_t bench_scaler(struct SwsContext *c, AVFrame *dst,
+                            const AVFrame *src, int iterations)
+{
+    int64_t start = av_gettime_relative();
+    int i;
+
+    for (i = 0; i < iterations; i++)
+        sws_scale_frame(c, dst, src);
+
+    return av_gettime_relative() - start;
+}
+
+static const char *usage = "threads [-threads <nb_threads>] [-bench <iterations>]\n";
+
+int main(int argc, char **argv)
+{
+    int nb_threads = 4, iterations = 0;
+    int i, ret = 0;
+    AVLFG lfg;
+
+    for (i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "%s", usage);
+            return 1;
+        }
+        if (!strcmp(argv[i], "-threads")) {
+            nb_threads = atoi(argv[i + 1]);
+        } else if (!strcmp(argv[i], "-bench")) {
+            iterations = atoi(argv[i + 1]);
+        } else {
+            fprintf(stderr, "%s", usage);
+            return 1;
+        }
+    }
+
+    av_lfg_init(&lfg, 0xC0FFEE);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        struct SwsContext *ref_ctx = NULL, *mt_ctx = NULL;
+        AVFrame *src = NULL, *ref = NULL, *out = NULL;
+        int err;
+
+        src = av_frame_alloc();
+        ref = av_frame_alloc();
+        out = av_frame_alloc();
+        if (!src || !ref || !out) {
+            ret = 1;
+            goto end;
+        }
+
+        src->width  = tests[i].src_w;
+        src->height = tests[i].src_h;
+        src->format = tests[i].src_fmt;
+        if (av_frame_get_buffer(src, 0) < 0) {
+            ret = 1;
+            goto end;
+        }
+        fill_random(src, &lfg);
+
+        ref_ctx = alloc_scaler(i, 1);
+        mt_ctx  = alloc_scaler(i, nb_threads);
+        if (!ref_ctx || !mt_ctx) {
+            fprintf(stderr, "Failed to create the scalers for test %d\n", i);
+            ret = 1;
+            goto end;
+        }
+
+        if ((err = sws_scale_frame(ref_ctx, ref, src)) < 0 ||
+            (err = sws_scale_frame(mt_ctx,  out, src)) < 0) {
+            fprintf(stderr, "Scaling failed for test %d: %s\n", i, av_err2str(err));
+            ret = 1;
+            goto end;
+        }
+
+        err = compare_frames(ref, out);
+        printf("%s %dx%d -> %s %dx%d: %s\n",
+               av_get_pix_fmt_name(tests[i].src_fmt), tests[i].src_w, tests[i].src_h,
+               av_get_pix_fmt_name(tests[i].dst_fmt), tests[i].dst_w, tests[i].dst_h,
+               err ? "MISMATCH" : "OK");
+        if (err)
+            ret = 1;
+
+        if (iterations > 0) {
+            int64_t t1 = bench_scaler(ref_ctx, ref, src, iterations);
+            int64_t tn = bench_scaler(mt_ctx,  out, src, iterations);
+            printf("    1 thread: %.2f fps, %d threads: %.2f fps, speedup %.2fx\n",
+                   iterations * 1000000.0 / FFMAX(t1, 1), nb_threads,
+                   iterations * 1000000.0 / FFMAX(tn, 1), (double)t1 / FFMAX(tn, 1));
+        }
+
+end:
+        sws_freeContext(ref_ctx);
+        sws_freeContext(mt_ctx);
+        av_frame_free(&src);
+        av_frame_free(&ref);
+        av_frame_free(&out);
+        if (ret)
+            break;
+    }
+
+    return ret;
+}
@@ -0,0 +1,110 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/mem.h"
+#include "libavutil/mem_internal.h"
+#include "libavcodec/aacenc.h"
+
+#include "checkasm.h"
+
+#define BUF_SIZE 1024
+
+#define randomize_float(buf, len)                               \
+    do {                                                        \
+        int i;                                                  \
+        for (i = 0; i < len; i++) {                             \
+            float f = (float)rnd() / (UINT_MAX >> 5) - 16.0f;   \
+            buf[i] = f;                                         \
+        }                                                       \
+    } while (0)
+
+static void test_abs_pow34(AACEncContext *s)
+{
+    LOCAL_ALIGNED_16(float, in,      [BUF_SIZE]);
+    LOCAL_ALIGNED_16(float, out_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(float, out_new, [BUF_SIZE]);
+    static const int sizes[] = { 4, 8, 12, 16, 32, 64, 128, 1024 };
+    int i;
+
+    declare_func(void, float *out, const float *in, const int size);
+
+    randomize_float(in, BUF_SIZE);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        memset(out_ref, 0, BUF_SIZE * sizeof(*out_ref));
+        memset(out_new, 0, BUF_SIZE * sizeof(*out_new));
+        call_ref(out_ref, in, sizes[i]);
+        call_new(out_new, in, sizes[i]);
+        if (!float_near_ulp_array(out_ref, out_new, 1, BUF_SIZE))
+            fail();
+    }
+    bench_new(out_new, in, BUF_SIZE);
+}
+
+static void test_quant_bands(AACEncContext *s)
+{
+    LOCAL_ALIGNED_16(float, in,     [BUF_SIZE]);
+    LOCAL_ALIGNED_16(float, scaled, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(int,   out_ref, [BUF_SIZE]);
+    LOCAL_ALIGNED_16(int,   out_new, [BUF_SIZE]);
+    static const int maxvals[] = { 1, 2, 4, 7, 12, 16, 8191 };
+    const float rounding = (rnd() & 1) ? 0.4054f : 0.1054f;
+    const float q34 = (float)rnd() / (UINT_MAX >> 3) + 0.1f;
+    int i, is_signed;
+
+    declare_func(void, int *out, const float *in, const float *scaled,
+                 int size, int is_signed, int maxval, const float Q34,
+                 const float rounding);
+
+    randomize_float(in, BUF_SIZE);
+    s->abs_pow34(scaled, in, BUF_SIZE);
+
+    for (is_signed = 0; is_signed < 2; is_signed++) {
+        for (i = 0; i < FF_ARRAY_ELEMS(maxvals); i++) {
+            memset(out_ref, 0, BUF_SIZE * sizeof(*out_ref));
+            memset(out_new, 0, BUF_SIZE * sizeof(*out_new));
+            call_ref(out_ref, in, scaled, BUF_SIZE, is_signed, maxvals[i], q34, rounding);
+            call_new(out_new, in, scaled, BUF_SIZE, is_signed, maxvals[i], q34, rounding);
+            if (memcmp(out_ref, out_new, BUF_SIZE * sizeof(*out_ref)))
+                fail();
+        }
+    }
+    bench_new(out_new, in, scaled, BUF_SIZE, 1, 8191, q34, rounding);
+}
+
+void checkasm_check_aacencdsp(void)
+{
+    AACEncContext *s = av_mallocz(sizeof(*s));
+
+    if (!s)
+        return;
+
+    ff_aac_dsp_init(s);
+
+    if (check_func(s->abs_pow34, "abs_pow34"))
+        test_abs_pow34(s);
+    report("abs_pow34");
+
+    if (check_func(s->quant_bands, "quant_bands"))
+        test_quant_bands(s);
+    report("quant_bands");
+
+    av_free(s);
+}
@@ -0,0 +1,88 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavutil/aes.h"
+#include "libavutil/aes_internal.h"
+#include "libavutil/mem_internal.h"
+
+#define MAX_BLOCKS 37
+
+#define randomize_buffer(buf, size)      \
+    do {                                 \
+        int k;                           \
+        for (k = 0; k < size; k++)       \
+            buf[k] = rnd();              \
+    } while (0)
+
+static void check_crypt(AVAES *a, const uint8_t *src, int use_iv)
+{
+    LOCAL_ALIGNED_16(uint8_t, dst_ref, [MAX_BLOCKS * 16]);
+    LOCAL_ALIGNED_16(uint8_t, dst_new, [MAX_BLOCKS * 16]);
+    uint8_t iv_ref[16], iv_new[16];
+    int count;
+
+    declare_func(void, AVAES *a, uint8_t *dst, const uint8_t *src,
+                 int count, uint8_t *iv, int rounds);
+
+    for (count = 1; count <= MAX_BLOCKS; count += 6) {
+        randomize_buffer(iv_ref, 16);
+        memcpy(iv_new, iv_ref, 16);
+        memset(dst_ref, 0, MAX_BLOCKS * 16);
+        memset(dst_new, 0, MAX_BLOCKS * 16);
+
+        call_ref(a, dst_ref, src, count, use_iv ? iv_ref : NULL, a->rounds);
+        call_new(a, dst_new, src, count, use_iv ? iv_new : NULL, a->rounds);
+        if (memcmp(dst_ref, dst_new, MAX_BLOCKS * 16) ||
+            memcmp(iv_ref, iv_new, 16))
+            fail();
+    }
+    bench_new(a, dst_new, src, MAX_BLOCKS, use_iv ? iv_new : NULL, a->rounds);
+}
+
+void checkasm_check_aes(void)
+{
+    static const int key_bits[] = { 128, 192, 256 };
+    LOCAL_ALIGNED_16(uint8_t, src, [MAX_BLOCKS * 16]);
+    uint8_t key[32];
+    AVAES *a = av_aes_alloc();
+    int i, decrypt;
+
+    if (!a)
+        return;
+
+    randomize_buffer(key, 32);
+    randomize_buffer(src, MAX_BLOCKS * 16);
+
+    for (decrypt = 0; decrypt < 2; decrypt++) {
+        for (i = 0; i < FF_ARRAY_ELEMS(key_bits); i++) {
+            av_aes_init(a, key, key_bits[i], decrypt);
+            if (check_func(a->crypt, "aes_%scrypt_ecb_%d",
+                           decrypt ? "de" : "en", key_bits[i]))
+                check_crypt(a, src, 0);
+            if (check_func(a->crypt, "aes_%scrypt_cbc_%d",
+                           decrypt ? "de" : "en", key_bits[i]))
+                check_crypt(a, src, 1);
+        }
+        report(decrypt ? "decrypt" : "encrypt");
+    }
+
+    av_free(a);
+}
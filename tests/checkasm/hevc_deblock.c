@@ -0,0 +1,201 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#include "libavcodec/avcodec.h"
+
+#include "libavcodec/hevcdsp.h"
+
+#include "checkasm.h"
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define BUF_STRIDE 64
+#define BUF_SIZE (BUF_STRIDE * 32)
+/* the edge is in the middle of the buffer */
+#define EDGE_OFFSET (16 * BUF_STRIDE + 16)
+#define NB_ITERATIONS 64
+
+static void set_pixel(uint8_t *buf, ptrdiff_t offset, int v, int bit_depth)
+{
+    if (bit_depth == 8)
+        buf[offset] = v;
+    else
+        AV_WN16A(buf + 2 * offset, v);
+}
+
+static void randomize_buffer(uint8_t *buf, int bit_depth)
+{
+    const int mask = (1 << bit_depth) - 1;
+    int i;
+
+    for (i = 0; i < BUF_SIZE / SIZEOF_PIXEL; i++)
+        set_pixel(buf, i, rnd() & mask, bit_depth);
+}
+
+/**
+ * Fill the 8 lines crossing an edge with content that triggers all the
+ * filter decisions: unfiltered noise, strong and normal filtering of
+ * smooth areas with a step at the edge, and values close to the limits
+ * of the pixel range.
+ *
+ * @param xstride distance in pixels across the edge
+ * @param ystride distance in pixels along the edge
+ */
+static void randomize_edge(uint8_t *buf, ptrdiff_t xstride, ptrdiff_t ystride,
+                           int bit_depth)
+{
+    const int low_mask = (1 << (bit_depth - 8)) - 1;
+    int j, d, k;
+
+    for (j = 0; j < 2; j++) {
+        const int type  = rnd() % 4;
+        const int base  = type == 3 ? (rnd() & 1 ? rnd() % 8 : 255 - rnd() % 8)
+                                    : rnd() % 256;
+        const int step  = type == 0 ? 0 : (int)(rnd() % 33) - 16;
+        const int noise = type == 0 ? 255 : rnd() % 3;
+        int slope[2];
+
+        slope[0] = (int)(rnd() % 3) - 1;
+        slope[1] = (int)(rnd() % 3) - 1;
+
+        for (d = 0; d < 4; d++) {
+            ptrdiff_t pos = (4 * j + d) * ystride;
+
+            for (k = 0; k < 4; k++) {
+                int p = base +        slope[0] * k + (int)(rnd() % (noise + 1)) - noise / 2;
+                int q = base + step + slope[1] * k + (int)(rnd() % (noise + 1)) - noise / 2;
+
+                p = (av_clip_uint8(p) << (bit_depth - 8)) | (rnd() & low_mask);
+                q = (av_clip_uint8(q) << (bit_depth - 8)) | (rnd() & low_mask);
+                set_pixel(buf, pos - (k + 1) * xstride, p, bit_depth);
+                set_pixel(buf, pos +  k      * xstride, q, bit_depth);
+            }
+        }
+    }
+}
+
+static void randomize_params(int32_t *tc, uint8_t *no_p, uint8_t *no_q)
+{
+    int j;
+
+    for (j = 0; j < 2; j++) {
+        tc[j]   = rnd() % 25;
+        no_p[j] = !(rnd() % 4);
+        no_q[j] = !(rnd() % 4);
+    }
+}
+
+static void check_deblock_luma(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    const ptrdiff_t stride = BUF_STRIDE;
+    const ptrdiff_t px_stride = BUF_STRIDE / SIZEOF_PIXEL;
+    int32_t tc[2];
+    uint8_t no_p[2], no_q[2];
+    int dir, i, beta;
+
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, int beta, int32_t *tc,
+                 uint8_t *no_p, uint8_t *no_q);
+
+    for (dir = 0; dir < 2; dir++) {
+        void (*func)(uint8_t *, ptrdiff_t, int, int32_t *, uint8_t *, uint8_t *) =
+            dir ? h->hevc_v_loop_filter_luma : h->hevc_h_loop_filter_luma;
+
+        if (check_func(func, "hevc_%s_loop_filter_luma_%d", dir ? "v" : "h", bit_depth)) {
+            for (i = 0; i < NB_ITERATIONS; i++) {
+                randomize_buffer(buf0, bit_depth);
+                randomize_edge(buf0 + EDGE_OFFSET, dir ? 1 : px_stride,
+                               dir ? px_stride : 1, bit_depth);
+                memcpy(buf1, buf0, BUF_SIZE);
+                randomize_params(tc, no_p, no_q);
+                beta = rnd() % 65;
+
+                call_ref(buf0 + EDGE_OFFSET, stride, beta, tc, no_p, no_q);
+                call_new(buf1 + EDGE_OFFSET, stride, beta, tc, no_p, no_q);
+                if (memcmp(buf0, buf1, BUF_SIZE)) {
+                    fail();
+                    break;
+                }
+            }
+            bench_new(buf1 + EDGE_OFFSET, stride, beta, tc, no_p, no_q);
+        }
+    }
+}
+
+static void check_deblock_chroma(HEVCDSPContext *h, int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    const ptrdiff_t stride = BUF_STRIDE;
+    const ptrdiff_t px_stride = BUF_STRIDE / SIZEOF_PIXEL;
+    int32_t tc[2];
+    uint8_t no_p[2], no_q[2];
+    int dir, i;
+
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, int32_t *tc,
+                 uint8_t *no_p, uint8_t *no_q);
+
+    for (dir = 0; dir < 2; dir++) {
+        void (*func)(uint8_t *, ptrdiff_t, int32_t *, uint8_t *, uint8_t *) =
+            dir ? h->hevc_v_loop_filter_chroma : h->hevc_h_loop_filter_chroma;
+
+        if (check_func(func, "hevc_%s_loop_filter_chroma_%d", dir ? "v" : "h", bit_depth)) {
+            for (i = 0; i < NB_ITERATIONS; i++) {
+                randomize_buffer(buf0, bit_depth);
+                randomize_edge(buf0 + EDGE_OFFSET, dir ? 1 : px_stride,
+                               dir ? px_stride : 1, bit_depth);
+                memcpy(buf1, buf0, BUF_SIZE);
+                randomize_params(tc, no_p, no_q);
+
+                call_ref(buf0 + EDGE_OFFSET, stride, tc, no_p, no_q);
+                call_new(buf1 + EDGE_OFFSET, stride, tc, no_p, no_q);
+                if (memcmp(buf0, buf1, BUF_SIZE)) {
+                    fail();
+                    break;
+                }
+            }
+            bench_new(buf1 + EDGE_OFFSET, stride, tc, no_p, no_q);
+        }
+    }
+}
+
+void checkasm_check_hevc_deblock(void)
+{
+    int bit_depth;
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_deblock_luma(&h, bit_depth);
+    }
+    report("deblock_luma");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_deblock_chroma(&h, bit_depth);
+    }
+    report("deblock_chroma");
+}
@@ -491,6 +491,104 @@ concat(){
     fi
 }
 
+cache_dir(){
+    src=$(target_path $1)
+    cachedir="${outdir}/${test}.dir"
+    logfile="${outdir}/${test}.log"
+    cleanfiles="$cleanfiles $logfile"
+
+    rm -rf "$cachedir"
+    # direct read
+    ffmpeg -i "$src" -c copy -bitexact -f framecrc md5:
+    # partial read, then complete the entry and read it again from the cache
+    ffmpeg -cache_dir "$cachedir" -i "cache:$src" -t 2 -c copy -bitexact -f framecrc md5:
+    ffmpeg -cache_dir "$cachedir" -i "cache:$src" -c copy -bitexact -f framecrc md5:
+    ffmpeg -v info -cache_dir "$cachedir" -i "cache:$src" -c copy -bitexact -f framecrc md5: 2> "$logfile"
+    grep -o "cache misses:[0-9]*" "$logfile"
+    find "$cachedir" -name "*.index" -exec cat {} +
+    rm -rf "$cachedir"
+}
+
+file_aio(){
+    src=$(target_path $1)
+    fmt=$2
+    first="${outdir}/${test}.none.${fmt}"
+
+    for backend in none thread io_uring; do
+        out="${outdir}/${test}.${backend}.${fmt}"
+        cleanfiles="$cleanfiles $out"
+        if test $backend = io_uring &&
+           ! ffmpeg -aio io_uring -i "$src" -f null - 2>/dev/null; then
+            echo "io_uring is unavailable, skipped" >&2
+            continue
+        fi
+        # small blocks, so that several requests are in flight on both ends
+        ffmpeg -aio $backend -aio_block_size 4096 -i "$src" -c copy -bitexact \
+            -aio $backend -aio_block_size 4096 -y $(target_path $out) || return
+        if test $backend = none; then
+            do_md5sum $out | awk '{print $1}'
+        elif ! cmp -s "$first" "$out"; then
+            echo "$backend: output differs"
+        fi
+    done
+}
+
+seek_index(){
+    src=$1
+    index="${outdir}/${test}.idx"
+    cleanfiles="$cleanfiles $index"
+
+    rm -f "$index"
+    # build the index by reading the input through, then seek with it
+    ffmpeg -seek_index "$(target_path "$index")" -i "$src" -map 0 -c copy -f null -
+    run libavformat/tests/seek${EXECSUF} "$src" -seek_index "$(target_path "$index")"
+}
+
+hls_fmp4_parts(){
+    playlist=$(target_path $1)
+    dir=${playlist%/*}
+    payload="${outdir}/${test}.parts"
+    cleanfiles="$cleanfiles $payload"
+
+    # every part carries its own styp, the rest of it is at the printed
+    # offset of the full segment
+    offset=24
+    : > "$payload"
+    while read -r line; do
+        case "$line" in
+        "#EXT-X-PART:"*)
+            part=${line#*URI=\"}
+            part=${part%%\"*}
+            size=$(($(wc -c < "$dir/$part")))
+            test "$(head -c 8 "$dir/$part" | tail -c 4)" = styp || echo "$part: no styp"
+            echo "$part size=$size offset=$offset"
+            tail -c +25 "$dir/$part" >> "$payload"
+            offset=$((offset + size - 24))
+            ;;
+        "#"*)
+            ;;
+        *)
+            echo "$line size=$(($(wc -c < "$dir/$line")))"
+            tail -c +25 "$dir/$line" | cmp -s - "$payload" || echo "$line: parts differ"
+            offset=24
+            : > "$payload"
+            ;;
+        esac
+    done < "$playlist"
+}
+
+enc_threads(){
+    nb_threads=$1
+    shift
+    md5_1=$(ffmpeg "$@" -threads 1 -f md5 -)
+    md5_n=$(ffmpeg "$@" -threads $nb_threads -f md5 -)
+    if [ -z "$md5_1" ] || [ "$md5_1" != "$md5_n" ]; then
+        echo "threads=1: $md5_1 threads=$nb_threads: $md5_n"
+        return 1
+    fi
+    echo "threads=1 and threads=$nb_threads match"
+}
+
 venc_data(){
     file=$1
     stream=$2
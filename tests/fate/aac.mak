@@ -255,9 +255,17 @@ $(FATE_AAC_ALL): FUZZ = 2
 
 FATE_AAC_ENCODE-$(call ENCMUX, AAC, ADTS) += $(FATE_AAC_ENCODE)
 
+# six different channels, so that every element takes its own decisions
+AAC_THREADS_CH = anoisesrc=d=10:c=brown:a=0.$(1):seed=$(1),aresample,aformat=sample_fmts=fltp,highpass=f=3000[a$(1)];
+AAC_THREADS_SRC = $(call AAC_THREADS_CH,1)$(call AAC_THREADS_CH,2)$(call AAC_THREADS_CH,3)$(call AAC_THREADS_CH,4)$(call AAC_THREADS_CH,5)$(call AAC_THREADS_CH,6)[a1][a2][a3][a4][a5][a6]join=inputs=6:channel_layout=5.1
+
+FATE_AAC_THREADS-$(call ALLYES, ANOISESRC_FILTER ARESAMPLE_FILTER AFORMAT_FILTER HIGHPASS_FILTER JOIN_FILTER AAC_ENCODER MD5_MUXER) += fate-aac-threads-encode
+fate-aac-threads-encode: CMD = enc_threads 4 -filter_complex "$(AAC_THREADS_SRC)" -c:a aac -b:a 96k -fflags +bitexact -flags +bitexact
+
 FATE_AAC_BSF-$(call ALLYES, AAC_DEMUXER AAC_ADTSTOASC_BSF MATROSKA_MUXER) += fate-aac-autobsf-adtstoasc
 
 FATE_SAMPLES_FFMPEG += $(FATE_AAC_ALL) $(FATE_AAC_ENCODE-yes) $(FATE_AAC_BSF-yes)
+FATE_FFMPEG += $(FATE_AAC_THREADS-yes)
 
-fate-aac: $(FATE_AAC_ALL) $(FATE_AAC_ENCODE) $(FATE_AAC_BSF-yes)
+fate-aac: $(FATE_AAC_ALL) $(FATE_AAC_ENCODE) $(FATE_AAC_BSF-yes) $(FATE_AAC_THREADS-yes)
 fate-aac-latm: $(FATE_AAC_LATM-yes)
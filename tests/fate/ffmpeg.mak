@@ -41,6 +41,9 @@ fate-ffmpeg-filter_colorkey: CMD = framecrc -auto_conversion_filters -idct simpl
 FATE_FFMPEG-$(CONFIG_COLOR_FILTER) += fate-ffmpeg-lavfi
 fate-ffmpeg-lavfi: CMD = framecrc -lavfi color=d=1:r=5 -fflags +bitexact
 
+FATE_FFMPEG-$(CONFIG_TESTSRC2_FILTER) += fate-ffmpeg-mux-thread
+fate-ffmpeg-mux-thread: CMD = framecrc -lavfi testsrc2=d=1:r=5:s=160x120 -fflags +bitexact -thread_queue_size 2
+
 FATE_SAMPLES_FFMPEG-$(CONFIG_RAWVIDEO_DEMUXER) += fate-force_key_frames
 fate-force_key_frames: tests/data/vsynth_lena.yuv
 fate-force_key_frames: CMD = enc_dec \
@@ -173,3 +176,15 @@ fate-time_base: $(SAMPLES)/mpeg2/dvd_single_frame.vob
 fate-time_base: CMD = md5 -i $(TARGET_SAMPLES)/mpeg2/dvd_single_frame.vob -an -sn -c:v copy -r 25 -time_base 1001:30000 -fflags +bitexact -f mxf
 
 FATE_SAMPLES_FFMPEG-yes += $(FATE_TIME_BASE-yes)
+
+FATE_FFMPEG-$(call ALLYES, CACHE_PROTOCOL FILE_PROTOCOL MD5_PROTOCOL WAV_DEMUXER FRAMECRC_MUXER) += fate-cache-dir
+fate-cache-dir: tests/data/asynth-44100-2.wav
+fate-cache-dir: CMD = cache_dir tests/data/asynth-44100-2.wav
+
+# remux with each file protocol aio backend, they must all write the same file
+FATE_FILE_AIO-$(call ALLYES, FILE_PROTOCOL WAV_DEMUXER MOV_MUXER NULL_MUXER) += fate-file-aio
+FATE_FFMPEG-$(HAVE_PTHREADS) += $(FATE_FILE_AIO-yes)
+fate-file-aio: tests/data/asynth-44100-2.wav
+fate-file-aio: CMD = file_aio tests/data/asynth-44100-2.wav mov
+fate-file-aio: CMP = oneline
+fate-file-aio: REF = b3fb8c6447fd2a956381c4742fe41f9f
@@ -83,6 +83,9 @@ fate-filter-testsrc2-rgb24: CMD = framecrc -lavfi testsrc2=r=7:d=10 -pix_fmt rgb
 FATE_FILTER-$(call ALLYES, LAVFI_INDEV TESTSRC2_FILTER) += fate-filter-testsrc2-rgba
 fate-filter-testsrc2-rgba: CMD = framecrc -lavfi testsrc2=r=7:d=10 -pix_fmt rgba
 
+FATE_FILTER-$(call ALLYES, TESTSRC2_FILTER SPLIT_FILTER SCALE_FILTER HFLIP_FILTER VFLIP_FILTER HSTACK_FILTER VSTACK_FILTER) += fate-filter-sched-threads
+fate-filter-sched-threads: CMD = framecrc -filter_sched_threads 4 -lavfi "testsrc2=r=7:d=5,split=4[a][b][c][d];[a]scale=160:120[a1];[b]hflip,scale=160:120[b1];[c]vflip,scale=160:120[c1];[d]scale=160:120:flags=bilinear[d1];[a1][b1]hstack[t];[c1][d1]hstack[u];[t][u]vstack" -pix_fmt yuv420p
+
 FATE_FILTER-$(call ALLYES, LAVFI_INDEV ALLRGB_FILTER) += fate-filter-allrgb
 fate-filter-allrgb: CMD = framecrc -lavfi allrgb=rate=5:duration=1 -pix_fmt rgb24
 
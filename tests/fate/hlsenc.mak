@@ -41,6 +41,31 @@ fate-hls-live-endlist: CMD = md5 -i $(SRC) -af hdcd=process_stereo=false -t 20 -
 fate-hls-live-endlist: CMP = oneline
 fate-hls-live-endlist: REF = e189ce781d9c87882f58e3929455167b
 
+FATE_HLSENC-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-hls-prefetch
+fate-hls-prefetch: tests/data/live_endlist.m3u8
+fate-hls-prefetch: SRC = $(TARGET_PATH)/tests/data/live_endlist.m3u8
+fate-hls-prefetch: CMD = md5 -prefetch_segments 2 -prefetch_buffer_size 65536 -i $(SRC) -af hdcd=process_stereo=false -t 20 -f s24le
+fate-hls-prefetch: CMP = oneline
+fate-hls-prefetch: REF = e189ce781d9c87882f58e3929455167b
+
+tests/data/hls_parts.m3u8: TAG = GEN
+tests/data/hls_parts.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
+        -f lavfi -i "aevalsrc=cos(2*PI*t)*sin(2*PI*(440+4*t)*t):d=20" -f hls -hls_time 3 -hls_part_time 1 -hls_can_block_reload 1 -map 0 \
+        -hls_list_size 0 -hls_flags temp_file -codec:a mp2fixed -hls_segment_filename $(TARGET_PATH)/tests/data/hls_parts_%d.ts \
+        $(TARGET_PATH)/tests/data/hls_parts.m3u8 2>/dev/null
+
+FATE_HLSENC-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-hls-parts
+fate-hls-parts: tests/data/hls_parts.m3u8
+fate-hls-parts: SRC = $(TARGET_PATH)/tests/data/hls_parts.m3u8
+fate-hls-parts: CMD = md5 -i $(SRC) -af hdcd=process_stereo=false -t 20 -f s24le
+fate-hls-parts: CMP = oneline
+fate-hls-parts: REF = e189ce781d9c87882f58e3929455167b
+
+FATE_HLSENC-$(call ALLYES, HLS_DEMUXER MPEGTS_MUXER MPEGTS_DEMUXER AEVALSRC_FILTER LAVFI_INDEV MP2FIXED_ENCODER) += fate-hls-parts-playlist
+fate-hls-parts-playlist: tests/data/hls_parts.m3u8
+fate-hls-parts-playlist: CMD = cat $(TARGET_PATH)/tests/data/hls_parts.m3u8
+
 tests/data/hls_segment_size.m3u8: TAG = GEN
 tests/data/hls_segment_size.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
 	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
@@ -109,6 +134,19 @@ FATE_HLSENC_PROBE-$(call ALLYES, HLS_DEMUXER EAC3_DEMUXER) += fate-hls-fmp4_ac3
 fate-hls-fmp4_ac3: tests/data/hls_fmp4_ac3.m3u8
 fate-hls-fmp4_ac3: CMD = probeaudiostream $(TARGET_PATH)/tests/data/now_ac3.mp4
 
+tests/data/hls_fmp4_parts.m3u8: TAG = GEN
+tests/data/hls_fmp4_parts.m3u8: ffmpeg$(PROGSSUF)$(EXESUF) | tests/data
+	$(M)$(TARGET_EXEC) $(TARGET_PATH)/$< \
+	-f lavfi -i "testsrc=d=4:s=160x120:r=25" -c:v mpeg4 -g 25 -flags +bitexact -fflags +bitexact \
+	-hls_segment_type fmp4 -hls_fmp4_init_filename hls_fmp4_parts_init.mp4 -hls_time 2 -hls_part_time 0.5 \
+	-hls_list_size 0 -hls_playlist_type event -hls_segment_filename "$(TARGET_PATH)/tests/data/hls_fmp4_parts_%d.m4s" \
+	$(TARGET_PATH)/tests/data/hls_fmp4_parts.m3u8 2>/dev/null
+
+FATE_HLSENC_FFMPEG-$(call ALLYES, HLS_MUXER MP4_MUXER TESTSRC_FILTER LAVFI_INDEV MPEG4_ENCODER) += fate-hls-fmp4-parts
+fate-hls-fmp4-parts: tests/data/hls_fmp4_parts.m3u8
+fate-hls-fmp4-parts: CMD = hls_fmp4_parts tests/data/hls_fmp4_parts.m3u8
+
 FATE_SAMPLES_FFMPEG += $(FATE_HLSENC-yes)
+FATE_FFMPEG += $(FATE_HLSENC_FFMPEG-yes)
 FATE_SAMPLES_FFMPEG_FFPROBE += $(FATE_HLSENC_PROBE-yes)
-fate-hlsenc: $(FATE_HLSENC-yes) $(FATE_HLSENC_PROBE-yes)
+fate-hlsenc: $(FATE_HLSENC-yes) $(FATE_HLSENC_PROBE-yes) $(FATE_HLSENC_FFMPEG-yes)
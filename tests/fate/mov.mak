@@ -33,11 +33,15 @@ FATE_MOV_FFPROBE = fate-mov-neg-firstpts-discard \
 
 FATE_MOV_FASTSTART = fate-mov-faststart-4gb-overflow \
 
+FATE_MOV_LAVF-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-mov-lazy-index
+FATE_MOV_LAVF-$(call FILTERDEMDECENCMUX, ASETNSAMPLES, WAV, PCM_S16LE, PCM_S16LE, MOV) += fate-mov-spill-sample-table
+
 FATE_SAMPLES_AVCONV += $(FATE_MOV)
 FATE_SAMPLES_FFPROBE += $(FATE_MOV_FFPROBE)
 FATE_SAMPLES_FASTSTART += $(FATE_MOV_FASTSTART)
+FATE_AVCONV += $(FATE_MOV_LAVF-yes)
 
-fate-mov: $(FATE_MOV) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART)
+fate-mov: $(FATE_MOV) $(FATE_MOV_FFPROBE) $(FATE_MOV_FASTSTART) $(FATE_MOV_LAVF-yes)
 
 # Make sure we handle edit lists correctly in normal cases.
 fate-mov-1elist-noctts: CMD = framemd5 -i $(TARGET_SAMPLES)/mov/mov-1elist-noctts.mov
@@ -127,3 +131,11 @@ fate-mov-faststart-4gb-overflow: REF = bc875921f151871e787c4b4023269b29
 fate-mov-mp4-with-mov-in24-ver: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -show_entries stream=codec_name -select_streams 1 $(TARGET_SAMPLES)/mov/mp4-with-mov-in24-ver.mp4
 
 fate-mov-mp4-extended-atom: CMD = run ffprobe$(PROGSSUF)$(EXESUF) -show_packets -print_format compact -select_streams v $(TARGET_SAMPLES)/mov/extended_atom_size_probe
+
+# Seek and read with samples resolved from the sample tables on demand.
+fate-mov-lazy-index: fate-lavf-mov
+fate-mov-lazy-index: CMD = framecrc -lazy_index 1 -ss 0.5 -i $(TARGET_PATH)/tests/data/lavf/lavf.mov -c copy
+
+# Write more samples than the muxer keeps in memory with spilled sample tables.
+fate-mov-spill-sample-table: tests/data/asynth-44100-2.wav
+fate-mov-spill-sample-table: CMD = transcode wav $(TARGET_PATH)/tests/data/asynth-44100-2.wav mov "-af asetnsamples=64 -c:a pcm_s16le -spill_sample_table 1" "-c copy -frames:a 8"
@@ -266,6 +266,11 @@ fate-seek-mkv-codec-delay:   CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_
 
 FATE_SEEK_EXTRA += $(FATE_SEEK_EXTRA-yes)
 
+# seeks resolved from a sidecar index, see fate-seek-lavf-ts for bisection
+FATE_SEEK_INDEX-$(call ALLYES, MPEG2VIDEO_ENCODER MP2_ENCODER MPEGTS_MUXER MPEGTS_DEMUXER NULL_MUXER) += fate-seek-index-lavf-ts
+fate-seek-index-lavf-ts: fate-lavf-ts ffmpeg$(PROGSSUF)$(EXESUF) libavformat/tests/seek$(EXESUF)
+fate-lavf-ts: KEEP_OVERRIDE = -keep
+fate-seek-index-lavf-ts: CMD = seek_index $(TARGET_PATH)/tests/data/lavf/lavf.ts
 
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA): libavformat/tests/seek$(EXESUF)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC)
@@ -273,6 +278,6 @@ $(FATE_SEEK) $(FATE_SAMPLES_SEEK): fate-seek-%: fate-%
 $(subst fate-seek-,fate-,$(FATE_SAMPLES_SEEK) $(FATE_SEEK)): KEEP_OVERRIDE = -keep
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
-FATE_AVCONV += $(FATE_SEEK)
+FATE_AVCONV += $(FATE_SEEK) $(FATE_SEEK_INDEX-yes)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
+fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_INDEX-yes)
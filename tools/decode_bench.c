@@ -0,0 +1,498 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Decoder throughput benchmark.
+ *
+ * All packets of one stream are read into memory first, so that only
+ * decoding is timed, then decoded one or more times with a fresh decoder.
+ * The results are frames per second, the latency of each frame from the
+ * sending of its packet to its output, CPU time and peak memory.
+ *
+ * With -f json or -f csv the results can be collected over commits, e.g.
+ *   for f in fate-suite/h264/conformance/SVA*; do
+ *       tools/decode_bench -f csv -t 4 -T frame -r 5 $f; done
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_SYS_RESOURCE_H
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h> /* for getopt */
+#endif
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/ffversion.h"
+#include "libavutil/mem.h"
+#include "libavutil/qsort.h"
+#include "libavutil/time.h"
+
+#include "libavformat/avformat.h"
+
+#include "libavcodec/avcodec.h"
+
+enum OutputFormat {
+    FORMAT_TEXT,
+    FORMAT_JSON,
+    FORMAT_CSV,
+};
+
+typedef struct BenchContext {
+    const char *filename;
+    const char *decoder_name;
+    const char *thread_type;
+    int nb_threads;
+    int nb_runs;
+    int nb_warmup;
+    int stream_idx;
+    enum OutputFormat format;
+
+    const AVCodec *codec;
+    AVCodecParameters *par;
+
+    AVPacket **pkts;
+    int nb_pkts;
+    int64_t pkt_bytes;
+
+    int64_t *send_time;     // per packet, of the run in progress
+    int64_t *latency;       // per frame, of all timed runs
+    int nb_latency, max_latency;
+    int64_t *run_time;      // per timed run
+    int nb_frames;          // per run
+    int64_t user_usec, sys_usec;
+    int64_t maxrss_loaded;
+} BenchContext;
+
+static void get_cpu_time(int64_t *user_usec, int64_t *sys_usec)
+{
+#if HAVE_GETRUSAGE
+    struct rusage rusage;
+
+    getrusage(RUSAGE_SELF, &rusage);
+    *user_usec = (rusage.ru_utime.tv_sec * 1000000LL) + rusage.ru_utime.tv_usec;
+    *sys_usec  = (rusage.ru_stime.tv_sec * 1000000LL) + rusage.ru_stime.tv_usec;
+#else
+    *user_usec = *sys_usec = 0;
+#endif
+}
+
+static int64_t getmaxrss(void)
+{
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+    struct rusage rusage;
+    getrusage(RUSAGE_SELF, &rusage);
+    return (int64_t)rusage.ru_maxrss * 1024;
+#else
+    return 0;
+#endif
+}
+
+static int cmp_int64(const void *a, const void *b)
+{
+    return FFDIFFSIGN(*(const int64_t *)a, *(const int64_t *)b);
+}
+
+/* nearest-rank percentile of a sorted array */
+static int64_t percentile(const int64_t *v, int n, int p)
+{
+    int rank = (n * p + 99) / 100;
+
+    if (!n)
+        return 0;
+    return v[av_clip(rank - 1, 0, n - 1)];
+}
+
+static void print_json_string(const char *str)
+{
+    putchar('"');
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            printf("\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            printf("\\u%04x", *str);
+        else
+            putchar(*str);
+    }
+    putchar('"');
+}
+
+static void print_csv_string(const char *str)
+{
+    if (!strpbrk(str, ",\"\n")) {
+        fputs(str, stdout);
+        return;
+    }
+    putchar('"');
+    for (; *str; str++) {
+        if (*str == '"')
+            putchar('"');
+        putchar(*str);
+    }
+    putchar('"');
+}
+
+static int load_packets(BenchContext *b)
+{
+    AVFormatContext *fmt = NULL;
+    AVPacket *pkt;
+    int ret;
+
+    ret = avformat_open_input(&fmt, b->filename, NULL, NULL);
+    if (ret < 0)
+        return ret;
+    ret = avformat_find_stream_info(fmt, NULL);
+    if (ret < 0)
+        goto end;
+
+    if (b->stream_idx < 0) {
+        ret = av_find_best_stream(fmt, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+        if (ret < 0)
+            ret = av_find_best_stream(fmt, AVMEDIA_TYPE_AUDIO, -1, -1, NULL, 0);
+        if (ret < 0)
+            goto end;
+        b->stream_idx = ret;
+    } else if (b->stream_idx >= fmt->nb_streams) {
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    b->par = avcodec_parameters_alloc();
+    if (!b->par) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avcodec_parameters_copy(b->par, fmt->streams[b->stream_idx]->codecpar);
+    if (ret < 0)
+        goto end;
+
+    b->codec = b->decoder_name ? avcodec_find_decoder_by_name(b->decoder_name)
+                               : avcodec_find_decoder(b->par->codec_id);
+    if (!b->codec) {
+        ret = AVERROR_DECODER_NOT_FOUND;
+        goto end;
+    }
+
+    while (1) {
+        if (!(pkt = av_packet_alloc())) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        ret = av_read_frame(fmt, pkt);
+        if (ret < 0 || pkt->stream_index != b->stream_idx) {
+            av_packet_free(&pkt);
+            if (ret == AVERROR_EOF)
+                break;
+            if (ret < 0)
+                goto end;
+            continue;
+        }
+        ret = av_dynarray_add_nofree(&b->pkts, &b->nb_pkts, pkt);
+        if (ret < 0) {
+            av_packet_free(&pkt);
+            goto end;
+        }
+        b->pkt_bytes += pkt->size;
+    }
+    ret = 0;
+
+end:
+    avformat_close_input(&fmt);
+    return ret;
+}
+
+static int receive_frames(BenchContext *b, AVCodecContext *dec, AVFrame *frame,
+                          int timed)
+{
+    int ret;
+
+    while ((ret = avcodec_receive_frame(dec, frame)) >= 0) {
+        int64_t now = av_gettime_relative();
+        int64_t idx = frame->reordered_opaque;
+
+        if (timed && idx >= 0 && idx < b->nb_pkts && b->nb_latency < b->max_latency)
+            b->latency[b->nb_latency++] = now - b->send_time[idx];
+        b->nb_frames++;
+        av_frame_unref(frame);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int run_decoder(BenchContext *b, int timed)
+{
+    AVCodecContext *dec = NULL;
+    AVDictionary *opts = NULL;
+    AVFrame *frame = NULL;
+    int64_t start, user_usec, sys_usec;
+    int i, ret;
+
+    dec = avcodec_alloc_context3(b->codec);
+    frame = av_frame_alloc();
+    if (!dec || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    ret = avcodec_parameters_to_context(dec, b->par);
+    if (ret < 0)
+        goto end;
+
+    av_dict_set_int(&opts, "threads", b->nb_threads, 0);
+    if (b->thread_type)
+        av_dict_set(&opts, "thread_type", b->thread_type, 0);
+    ret = avcodec_open2(dec, b->codec, &opts);
+    if (ret < 0)
+        goto end;
+
+    b->nb_frames = 0;
+    get_cpu_time(&user_usec, &sys_usec);
+    start = av_gettime_relative();
+
+    for (i = 0; i <= b->nb_pkts; i++) {
+        if (i < b->nb_pkts)
+            b->send_time[i] = av_gettime_relative();
+        dec->reordered_opaque = i;
+        ret = avcodec_send_packet(dec, i < b->nb_pkts ? b->pkts[i] : NULL);
+        if (ret < 0 && ret != AVERROR_INVALIDDATA)
+            goto end;
+        ret = receive_frames(b, dec, frame, timed);
+        if (ret < 0 && ret != AVERROR_INVALIDDATA)
+            goto end;
+    }
+    ret = 0;
+
+    if (timed) {
+        int64_t user_end, sys_end;
+
+        b->run_time[b->nb_runs++] = av_gettime_relative() - start;
+        get_cpu_time(&user_end, &sys_end);
+        b->user_usec += user_end - user_usec;
+        b->sys_usec  += sys_end  - sys_usec;
+    }
+
+end:
+    av_dict_free(&opts);
+    av_frame_free(&frame);
+    avcodec_free_context(&dec);
+    return ret;
+}
+
+static void print_results(BenchContext *b)
+{
+    int64_t median, maxrss = getmaxrss();
+    int64_t *sorted_time = av_memdup(b->run_time, b->nb_runs * sizeof(*b->run_time));
+    double fps, p50, p90, p99, pmax;
+    int i;
+
+    if (!sorted_time)
+        return;
+    AV_QSORT(sorted_time, b->nb_runs, int64_t, cmp_int64);
+    AV_QSORT(b->latency, b->nb_latency, int64_t, cmp_int64);
+    median = sorted_time[b->nb_runs / 2];
+    fps    = median ? b->nb_frames * 1000000.0 / median : 0;
+    p50    = percentile(b->latency, b->nb_latency, 50)  / 1000.0;
+    p90    = percentile(b->latency, b->nb_latency, 90)  / 1000.0;
+    p99    = percentile(b->latency, b->nb_latency, 99)  / 1000.0;
+    pmax   = percentile(b->latency, b->nb_latency, 100) / 1000.0;
+
+    switch (b->format) {
+    case FORMAT_TEXT:
+        printf("file: %s\n"
+               "decoder: %s, threads: %d, thread type: %s\n"
+               "packets: %d (%"PRId64" bytes), frames: %d, runs: %d\n"
+               "time: median %.3f s, min %.3f s, max %.3f s\n"
+               "fps: %.2f\n"
+               "latency: p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n"
+               "cpu: user %.3f s, sys %.3f s per run\n"
+               "maxrss: %"PRId64" kB (%"PRId64" kB after loading packets)\n",
+               b->filename, b->codec->name, b->nb_threads,
+               b->thread_type ? b->thread_type : "default",
+               b->nb_pkts, b->pkt_bytes, b->nb_frames, b->nb_runs,
+               median / 1e6, sorted_time[0] / 1e6, sorted_time[b->nb_runs - 1] / 1e6,
+               fps, p50, p90, p99, pmax,
+               b->user_usec / 1e6 / b->nb_runs, b->sys_usec / 1e6 / b->nb_runs,
+               maxrss / 1024, b->maxrss_loaded / 1024);
+        break;
+    case FORMAT_JSON:
+        printf("{\n"
+               "    \"version\": ");
+        print_json_string(FFMPEG_VERSION);
+        printf(",\n"
+               "    \"file\": ");
+        print_json_string(b->filename);
+        printf(",\n"
+               "    \"decoder\": \"%s\",\n"
+               "    \"threads\": %d,\n"
+               "    \"thread_type\": \"%s\",\n"
+               "    \"packets\": %d,\n"
+               "    \"bytes\": %"PRId64",\n"
+               "    \"frames\": %d,\n"
+               "    \"fps\": %.3f,\n"
+               "    \"run_time_us\": [",
+               b->codec->name, b->nb_threads,
+               b->thread_type ? b->thread_type : "default",
+               b->nb_pkts, b->pkt_bytes, b->nb_frames, fps);
+        for (i = 0; i < b->nb_runs; i++)
+            printf("%s%"PRId64, i ? ", " : "", b->run_time[i]);
+        printf("],\n"
+               "    \"latency_ms\": { \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n"
+               "    \"cpu_user_s\": %.3f,\n"
+               "    \"cpu_sys_s\": %.3f,\n"
+               "    \"maxrss_kb\": %"PRId64",\n"
+               "    \"maxrss_loaded_kb\": %"PRId64"\n"
+               "}\n",
+               p50, p90, p99, pmax,
+               b->user_usec / 1e6 / b->nb_runs, b->sys_usec / 1e6 / b->nb_runs,
+               maxrss / 1024, b->maxrss_loaded / 1024);
+        break;
+    case FORMAT_CSV:
+        printf("version,file,decoder,threads,thread_type,packets,bytes,frames,runs,"
+               "time_median_s,fps,latency_p50_ms,latency_p90_ms,latency_p99_ms,"
+               "latency_max_ms,cpu_user_s,cpu_sys_s,maxrss_kb,maxrss_loaded_kb\n");
+        print_csv_string(FFMPEG_VERSION);
+        putchar(',');
+        print_csv_string(b->filename);
+        printf(",%s,%d,%s,%d,%"PRId64",%d,%d,%.6f,%.3f,%.3f,%.3f,%.3f,%.3f,"
+               "%.3f,%.3f,%"PRId64",%"PRId64"\n",
+               b->codec->name, b->nb_threads,
+               b->thread_type ? b->thread_type : "default",
+               b->nb_pkts, b->pkt_bytes, b->nb_frames, b->nb_runs,
+               median / 1e6, fps, p50, p90, p99, pmax,
+               b->user_usec / 1e6 / b->nb_runs, b->sys_usec / 1e6 / b->nb_runs,
+               maxrss / 1024, b->maxrss_loaded / 1024);
+        break;
+    }
+
+    av_free(sorted_time);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [options] <input file>\n"
+            "  -s index    stream to decode (default: best video, else audio stream)\n"
+            "  -c name     decoder to use (default: by codec id)\n"
+            "  -t count    number of threads, 0 for automatic (default: 1)\n"
+            "  -T type     thread type: frame, slice or frame+slice (default: decoder's)\n"
+            "  -r runs     number of timed runs (default: 1)\n"
+            "  -w runs     number of untimed warm-up runs (default: 0)\n"
+            "  -f format   output format: text, json or csv (default: text)\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    BenchContext b = { .nb_threads = 1, .stream_idx = -1 };
+    int opt, i, runs = 1, ret;
+
+    while ((opt = getopt(argc, argv, "hs:c:t:T:r:w:f:")) != -1) {
+        switch (opt) {
+        case 's':
+            b.stream_idx = strtol(optarg, NULL, 0);
+            break;
+        case 'c':
+            b.decoder_name = optarg;
+            break;
+        case 't':
+            b.nb_threads = strtol(optarg, NULL, 0);
+            break;
+        case 'T':
+            b.thread_type = optarg;
+            break;
+        case 'r':
+            runs = FFMAX(strtol(optarg, NULL, 0), 1);
+            break;
+        case 'w':
+            b.nb_warmup = FFMAX(strtol(optarg, NULL, 0), 0);
+            break;
+        case 'f':
+            if (!strcmp(optarg, "text")) {
+                b.format = FORMAT_TEXT;
+            } else if (!strcmp(optarg, "json")) {
+                b.format = FORMAT_JSON;
+            } else if (!strcmp(optarg, "csv")) {
+                b.format = FORMAT_CSV;
+            } else {
+                fprintf(stderr, "Unknown output format '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h':
+        default:
+            usage(argv[0]);
+            return opt != 'h';
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    b.filename = argv[optind];
+
+    ret = load_packets(&b);
+    if (ret < 0) {
+        fprintf(stderr, "Error loading packets from %s: %s\n", b.filename, av_err2str(ret));
+        goto end;
+    }
+    if (!b.nb_pkts) {
+        fprintf(stderr, "No packets in stream %d\n", b.stream_idx);
+        ret = AVERROR_INVALIDDATA;
+        goto end;
+    }
+    b.maxrss_loaded = getmaxrss();
+
+    b.send_time = av_malloc_array(b.nb_pkts, sizeof(*b.send_time));
+    b.max_latency = FFMIN((int64_t)b.nb_pkts * runs, INT_MAX / sizeof(*b.latency));
+    b.latency   = av_malloc_array(b.max_latency, sizeof(*b.latency));
+    b.run_time  = av_malloc_array(runs, sizeof(*b.run_time));
+    if (!b.send_time || !b.latency || !b.run_time) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    for (i = 0; i < b.nb_warmup + runs; i++) {
+        ret = run_decoder(&b, i >= b.nb_warmup);
+        if (ret < 0) {
+            fprintf(stderr, "Error decoding: %s\n", av_err2str(ret));
+            goto end;
+        }
+    }
+
+    print_results(&b);
+
+end:
+    for (i = 0; i < b.nb_pkts; i++)
+        av_packet_free(&b.pkts[i]);
+    av_freep(&b.pkts);
+    avcodec_parameters_free(&b.par);
+    av_freep(&b.send_time);
+    av_freep(&b.latency);
+    av_freep(&b.run_time);
+
+    return ret < 0;
+}
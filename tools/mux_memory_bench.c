@@ -0,0 +1,216 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Muxer memory benchmark for long recordings.
+ *
+ * A synthetic PCM stream of the given duration is muxed into a file, and
+ * the peak RSS is printed after every tenth of the duration and after the
+ * trailer. With -m the growth of the peak RSS from the first tenth to the
+ * end must stay below the given limit, e.g.
+ *   tools/mux_memory_bench -d 3000 -o spill_sample_table=1 -m 4096 out.mov
+ * fails if the MOV muxer's memory grows by 4 MiB or more over a 3000 s
+ * recording of 1000 packets per second.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_SYS_RESOURCE_H
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h> /* for getopt */
+#endif
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#include "libavutil/channel_layout.h"
+#include "libavutil/common.h"
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+#include "libavutil/time.h"
+
+#include "libavformat/avformat.h"
+
+static int64_t getmaxrss(void)
+{
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+    struct rusage rusage;
+    getrusage(RUSAGE_SELF, &rusage);
+    return (int64_t)rusage.ru_maxrss * 1024;
+#else
+    return 0;
+#endif
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [options] <output file>\n"
+            "  -f format   output format (default: mov)\n"
+            "  -d seconds  duration of the stream (default: 3000)\n"
+            "  -r rate     sample rate (default: 8000)\n"
+            "  -n samples  samples per packet (default: 8)\n"
+            "  -o options  muxer options as key=value:key=value\n"
+            "  -m kB       fail if the peak RSS grows by this much or more\n"
+            "              after the first tenth of the duration\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    const char *format = "mov", *filename;
+    AVFormatContext *oc = NULL;
+    AVDictionary *opts = NULL;
+    AVPacket *pkt = NULL;
+    AVStream *st;
+    int64_t duration = 3000, nb_pkts, i, start;
+    int64_t maxrss, maxrss_first = 0, max_growth = -1;
+    int opt, sample_rate = 8000, nb_samples = 8, checkpoint = 1, ret;
+
+    while ((opt = getopt(argc, argv, "hf:d:r:n:o:m:")) != -1) {
+        switch (opt) {
+        case 'f':
+            format = optarg;
+            break;
+        case 'd':
+            duration = FFMAX(strtoll(optarg, NULL, 0), 1);
+            break;
+        case 'r':
+            sample_rate = FFMAX(strtol(optarg, NULL, 0), 1);
+            break;
+        case 'n':
+            nb_samples = FFMAX(strtol(optarg, NULL, 0), 1);
+            break;
+        case 'o':
+            ret = av_dict_parse_string(&opts, optarg, "=", ":", 0);
+            if (ret < 0) {
+                fprintf(stderr, "Invalid muxer options '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'm':
+            max_growth = strtoll(optarg, NULL, 0);
+            break;
+        case 'h':
+        default:
+            usage(argv[0]);
+            av_dict_free(&opts);
+            return opt != 'h';
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        av_dict_free(&opts);
+        return 1;
+    }
+    filename = argv[optind];
+    nb_pkts  = duration * sample_rate / nb_samples;
+
+    ret = avformat_alloc_output_context2(&oc, NULL, format, filename);
+    if (ret < 0)
+        goto end;
+
+    st = avformat_new_stream(oc, NULL);
+    pkt = av_packet_alloc();
+    if (!st || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    st->time_base                       = (AVRational){ 1, sample_rate };
+    st->codecpar->codec_type            = AVMEDIA_TYPE_AUDIO;
+    st->codecpar->codec_id              = AV_CODEC_ID_PCM_S16LE;
+    st->codecpar->sample_rate           = sample_rate;
+    st->codecpar->channels              = 1;
+    st->codecpar->channel_layout        = AV_CH_LAYOUT_MONO;
+    st->codecpar->bits_per_coded_sample = 16;
+    st->codecpar->block_align           = 2;
+
+    if (!(oc->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&oc->pb, filename, AVIO_FLAG_WRITE);
+        if (ret < 0)
+            goto end;
+    }
+
+    ret = avformat_write_header(oc, &opts);
+    if (ret < 0)
+        goto end;
+    if (av_dict_count(opts)) {
+        fprintf(stderr, "Unknown muxer option '%s'\n",
+                av_dict_get(opts, "", NULL, AV_DICT_IGNORE_SUFFIX)->key);
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+
+    printf("%s, %"PRId64" packets of %d samples at %d Hz\n",
+           format, nb_pkts, nb_samples, sample_rate);
+    start = av_gettime_relative();
+    for (i = 0; i < nb_pkts; i++) {
+        ret = av_new_packet(pkt, nb_samples * 2);
+        if (ret < 0)
+            goto end;
+        memset(pkt->data, i, pkt->size);
+        pkt->pts = pkt->dts = i * nb_samples;
+        pkt->duration       = nb_samples;
+        pkt->flags         |= AV_PKT_FLAG_KEY;
+
+        ret = av_write_frame(oc, pkt);
+        av_packet_unref(pkt);
+        if (ret < 0)
+            goto end;
+
+        if ((i + 1) * 10 >= nb_pkts * checkpoint) {
+            maxrss = getmaxrss();
+            if (checkpoint++ == 1)
+                maxrss_first = maxrss;
+            printf("%3"PRId64"%%: %10"PRId64" packets, maxrss %8"PRId64" kB\n",
+                   (i + 1) * 100 / nb_pkts, i + 1, maxrss / 1024);
+        }
+    }
+
+    ret = av_write_trailer(oc);
+    if (ret < 0)
+        goto end;
+    maxrss = getmaxrss();
+    printf("trailer: maxrss %"PRId64" kB, growth %"PRId64" kB, %.1f s\n",
+           maxrss / 1024, (maxrss - maxrss_first) / 1024,
+           (av_gettime_relative() - start) / 1e6);
+
+    if (max_growth >= 0 && (maxrss - maxrss_first) / 1024 >= max_growth) {
+        fprintf(stderr, "Peak RSS grew by %"PRId64" kB, the limit is %"PRId64" kB\n",
+                (maxrss - maxrss_first) / 1024, max_growth);
+        ret = AVERROR_EXTERNAL;
+    }
+
+end:
+    if (ret < 0 && ret != AVERROR_EXTERNAL)
+        fprintf(stderr, "Error muxing %s: %s\n", filename, av_err2str(ret));
+    if (oc && !(oc->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&oc->pb);
+    avformat_free_context(oc);
+    av_packet_free(&pkt);
+    av_dict_free(&opts);
+
+    return ret < 0;
+}